@@ -50,6 +50,11 @@ struct ImportStatement {
     Location location;
 };
 
+// How the arguments and results of a call are encoded in its transactions.
+// Methods annotated with @flatten or @shm are served in the classic encoding
+// as well, which peers generated without support for them use.
+enum class CallEncoding { CLASSIC, FLATTEN, SHM };
+
 struct AST {
     AST(const Coordinator* coordinator, const Hash* fileHash);
 
@@ -153,6 +158,8 @@ struct AST {
     void generateCppAdapterHeader(Formatter& out) const;
     void generateCppAdapterSource(Formatter& out) const;
 
+    void generateCppBenchmarkSource(Formatter& out) const;
+
     void generateJava(Formatter& out, const std::string& limitToType) const;
     void generateJavaImpl(Formatter& out) const;
     void generateJavaTypes(Formatter& out, const std::string& limitToType) const;
@@ -310,25 +317,52 @@ struct AST {
                          bool includeParents = true) const;
     void generateStubImplMethod(Formatter& out, const std::string& className,
                                 const Method* method) const;
-    void generatePassthroughMethod(Formatter& out, const Method* method, const Interface* superInterface) const;
+    void generatePassthroughMethod(Formatter& out, const Method* method, const Interface* superInterface,
+                                   bool moveArgs = false) const;
+    // If toResultsStruct is set, generates the overload which reads the reply
+    // into a <method>_results struct rather than invoking _hidl_cb. It takes no
+    // instrumentor, since <Interface>::<method>_toResults calls it without a
+    // proxy instance. Encodings
+    // other than CLASSIC generate _hidl_<method>_flat or _hidl_<method>_shm,
+    // which send the call using the @flatten or @shm encoding.
     void generateStaticProxyMethodSource(Formatter& out, const std::string& className,
-                                         const Method* method, const Interface* superInterface) const;
+                                         const Method* method, const Interface* superInterface,
+                                         bool toResultsStruct = false,
+                                         CallEncoding encoding = CallEncoding::CLASSIC) const;
     void generateProxyMethodSource(Formatter& out, const std::string& className,
                                    const Method* method, const Interface* superInterface) const;
+    void generateInterfaceResultsMethodSource(Formatter& out, const Method* method,
+                                              const Interface* superInterface) const;
+    void generateInterfaceAsyncMethodSource(Formatter& out, const Method* method) const;
+    void generateInterfaceAwaitableMethodSource(Formatter& out, const Method* method) const;
+    void generateInterfaceMoveMethodSource(Formatter& out, const Method* method,
+                                           const Interface* superInterface) const;
     void generateAdapterMethod(Formatter& out, const Method* method) const;
 
     void generateFetchSymbol(Formatter &out, const std::string &ifaceName) const;
 
     void generateProxySource(Formatter& out, const FQName& fqName) const;
+    void generateProxyBatchSource(Formatter& out, const std::string& klassName) const;
+    void generateProxyBatchMethodSource(Formatter& out, const Method* method,
+                                        const Interface* superInterface) const;
+    void generateProxyEncodingSource(Formatter& out, const std::string& klassName) const;
 
     void generateStubSource(Formatter& out, const Interface* iface) const;
 
     void generateStubSourceForMethod(Formatter& out, const Method* method,
                                      const Interface* superInterface) const;
+    // Encodings other than CLASSIC generate _hidl_<method>_flat or
+    // _hidl_<method>_shm, which serve calls using the @flatten or @shm
+    // encoding.
     void generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
-                                        const Method* method, const Interface* superInterface) const;
+                                        const Method* method, const Interface* superInterface,
+                                        CallEncoding encoding = CallEncoding::CLASSIC) const;
+    void generateStaticStubBatchMethodSource(Formatter& out, const FQName& fqName,
+                                             const Method* method) const;
 
     void generatePassthroughSource(Formatter& out) const;
+    void generatePassthroughOnewayPoolSource(Formatter& out) const;
+    void generatePassthroughWrapperCache(Formatter& out) const;
 
     void generateInterfaceSource(Formatter& out) const;
 
@@ -365,7 +399,8 @@ struct AST {
 
     void emitJavaReaderWriter(Formatter& out, const std::string& parcelObj,
                               const NamedReference<Type>* arg, bool isReader,
-                              bool addPrefixToName) const;
+                              bool addPrefixToName, bool arrays = false) const;
+    void emitJavaStubReplier(Formatter& out, const Method* method) const;
 
     void emitVtsTypeDeclarations(Formatter& out) const;
 
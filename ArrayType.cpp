@@ -284,6 +284,29 @@ void ArrayType::emitJavaDump(
         << "));\n";
 }
 
+std::string ArrayType::getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const {
+    if (mElementType->resolveToScalarType() == nullptr) {
+        return Type::getJavaEqualsCall(lhs, rhs);
+    }
+    return std::string("java.util.Arrays.") + (countDimensions() > 1 ? "deepEquals" : "equals") +
+           "(" + lhs + ", " + rhs + ")";
+}
+
+std::string ArrayType::getJavaHashCodeCall(const std::string& name) const {
+    if (mElementType->resolveToScalarType() == nullptr) {
+        return Type::getJavaHashCodeCall(name);
+    }
+    return std::string("java.util.Arrays.") + (countDimensions() > 1 ? "deepHashCode" : "hashCode") +
+           "(" + name + ")";
+}
+
+bool ArrayType::isCppTriviallyCopyable() const {
+    return mElementType->isCppTriviallyCopyable();
+}
+
+bool ArrayType::isCppBitwiseComparable() const {
+    return mElementType->isCppBitwiseComparable();
+}
 
 bool ArrayType::needsEmbeddedReadWrite() const {
     return mElementType->needsEmbeddedReadWrite();
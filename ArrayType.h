@@ -84,8 +84,13 @@ struct ArrayType : public Type {
             const std::string &streamName,
             const std::string &name) const override;
 
+    std::string getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const override;
+    std::string getJavaHashCodeCall(const std::string& name) const override;
+
     bool needsEmbeddedReadWrite() const override;
     bool resultNeedsDeref() const override;
+    bool isCppTriviallyCopyable() const override;
+    bool isCppBitwiseComparable() const override;
 
     void emitJavaReaderWriter(
             Formatter &out,
@@ -16,6 +16,7 @@
 
 #include "CompoundType.h"
 
+#include "Annotation.h"
 #include "ArrayType.h"
 #include "Reference.h"
 #include "ScalarType.h"
@@ -23,6 +24,8 @@
 
 #include <android-base/logging.h>
 #include <hidl-util/Formatter.h>
+#include <hidl-util/StringHelper.h>
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <string>
@@ -78,6 +81,68 @@ status_t CompoundType::validate() const {
         }
     }
 
+    for (const Annotation* annotation : annotations()) {
+        if (annotation->name() != "triviallyCopyable") continue;
+
+        if (mStyle != STYLE_SAFE_UNION || !annotation->params().empty()) {
+            std::cerr << "ERROR: @triviallyCopyable takes no parameters and can only be used on "
+                      << "safe_union at " << location() << "\n";
+            return UNKNOWN_ERROR;
+        }
+
+        for (const auto* field : mFields) {
+            if (!field->type().isCppTriviallyCopyable()) {
+                std::cerr << "ERROR: @triviallyCopyable safe_union can only contain scalars, "
+                          << "enums, bitfields, arrays of them, and structs or "
+                          << "@triviallyCopyable safe_unions of them at " << field->location()
+                          << "\n";
+                return UNKNOWN_ERROR;
+            }
+        }
+    }
+
+    for (const Annotation* annotation : annotations()) {
+        if (annotation->name() != "javaView") continue;
+
+        if (mStyle != STYLE_STRUCT || !annotation->params().empty()) {
+            std::cerr << "ERROR: @javaView takes no parameters and can only be used on struct at "
+                      << location() << "\n";
+            return UNKNOWN_ERROR;
+        }
+
+        for (const auto* field : mFields) {
+            if (field->type().resolveToScalarType() == nullptr) {
+                std::cerr << "ERROR: @javaView struct can only contain scalars, enums and "
+                          << "bitfields at " << field->location() << "\n";
+                return UNKNOWN_ERROR;
+            }
+        }
+
+        for (const auto* type : getSubTypes()) {
+            if (type->definedName() == "View") {
+                std::cerr << "ERROR: @javaView struct cannot declare a type named View at "
+                          << type->location() << "\n";
+                return UNKNOWN_ERROR;
+            }
+        }
+    }
+
+    for (const Annotation* annotation : annotations()) {
+        if (annotation->name() != "javaImmutable") continue;
+
+        if (mStyle != STYLE_STRUCT || !annotation->params().empty()) {
+            std::cerr << "ERROR: @javaImmutable takes no parameters and can only be used on "
+                      << "struct at " << location() << "\n";
+            return UNKNOWN_ERROR;
+        }
+
+        if (!canCheckEquality()) {
+            std::cerr << "ERROR: @javaImmutable struct must only contain types that can be "
+                      << "compared with equals() at " << location() << "\n";
+            return UNKNOWN_ERROR;
+        }
+    }
+
     if (mStyle == STYLE_SAFE_UNION && mFields.size() < 2) {
         std::cerr << "ERROR: Safe union must contain at least two types to be useful at "
                   << location() << "\n";
@@ -430,6 +495,25 @@ void CompoundType::emitJavaReaderWriter(
         << (isReader ? "readFromParcel" : "writeToParcel") << "(" << parcelObj << ");\n";
 }
 
+void CompoundType::emitJavaDump(
+        Formatter &out,
+        const std::string &streamName,
+        const std::string &name) const {
+    out.sIf(name + " == null", [&] {
+        out << streamName << ".append(\"null\");\n";
+    }).sElse([&] {
+        out << name << ".appendTo(" << streamName << ");\n";
+    }).endl();
+}
+
+std::string CompoundType::getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const {
+    return "java.util.Objects.equals(" + lhs + ", " + rhs + ")";
+}
+
+std::string CompoundType::getJavaHashCodeCall(const std::string& name) const {
+    return "java.util.Objects.hashCode(" + name + ")";
+}
+
 void CompoundType::emitJavaFieldInitializer(
         Formatter &out, const std::string &fieldName) const {
     const std::string fieldDeclaration = fullJavaName() + " " + fieldName;
@@ -522,12 +606,23 @@ void CompoundType::emitSafeUnionTypeDeclarations(Formatter& out) const {
     });
     out << ";\n\n";
 
-    out << definedName() << "();\n"                                              // Constructor
-        << "~" << definedName() << "();\n"                                       // Destructor
-        << definedName() << "(" << definedName() << "&&);\n"                     // Move constructor
-        << definedName() << "(const " << definedName() << "&);\n"                // Copy constructor
-        << definedName() << "& operator=(" << definedName() << "&&);\n"          // Move assignment
-        << definedName() << "& operator=(const " << definedName() << "&);\n\n";  // Copy assignment
+    if (isTriviallyCopyableSafeUnion()) {
+        // Every alternative is trivially copyable, so copying the discriminator
+        // and the bytes of the union is all the special members need to do.
+        out << definedName() << "();\n"
+            << "~" << definedName() << "() = default;\n"
+            << definedName() << "(" << definedName() << "&&) = default;\n"
+            << definedName() << "(const " << definedName() << "&) = default;\n"
+            << definedName() << "& operator=(" << definedName() << "&&) = default;\n"
+            << definedName() << "& operator=(const " << definedName() << "&) = default;\n\n";
+    } else {
+        out << definedName() << "();\n"                                              // Constructor
+            << "~" << definedName() << "();\n"                                       // Destructor
+            << definedName() << "(" << definedName() << "&&);\n"                     // Move constructor
+            << definedName() << "(const " << definedName() << "&);\n"                // Copy constructor
+            << definedName() << "& operator=(" << definedName() << "&&);\n"          // Move assignment
+            << definedName() << "& operator=(const " << definedName() << "&);\n\n";  // Copy assignment
+    }
 
     for (const auto& field : mFields) {
         // Setter (copy)
@@ -600,7 +695,7 @@ void CompoundType::emitSafeUnionTypeDeclarations(Formatter& out) const {
 
     out << "\n"
         << "hidl_union();\n"
-        << "~hidl_union();\n";
+        << "~hidl_union()" << (isTriviallyCopyableSafeUnion() ? " = default" : "") << ";\n";
 
     out.unindent();
     out << "} hidl_u;\n";
@@ -619,6 +714,11 @@ void CompoundType::emitSafeUnionTypeDeclarations(Formatter& out) const {
         emitLayoutAsserts(out, layout.overall, "");
         out << "\n";
     }
+
+    if (isTriviallyCopyableSafeUnion()) {
+        out << "static_assert(std::is_trivially_copyable<" << fullName()
+            << ">::value, \"" << fullName() << " must be trivially copyable\");\n\n";
+    }
 }
 
 void CompoundType::emitFieldHidlDefinition(Formatter& out, const NamedReference<Type>& ref) const {
@@ -636,6 +736,11 @@ void CompoundType::emitFieldHidlDefinition(Formatter& out, const NamedReference<
 
 void CompoundType::emitInlineHidlDefinition(Formatter& out) const {
     if (getDocComment() != nullptr) getDocComment()->emit(out);
+
+    out.join(annotations().begin(), annotations().end(), "\n",
+             [&](auto annotation) { annotation->dump(out); });
+    if (!annotations().empty()) out << "\n";
+
     out << typeName() << " ";
 
     std::set<FQName> namesDeclaredInScope;
@@ -859,6 +964,12 @@ void CompoundType::emitPackageTypeHeaderDefinitions(Formatter& out) const {
             << (mFields.empty() ? "/* lhs */" : "lhs") << ", " << getCppArgumentType() << " "
             << (mFields.empty() ? "/* rhs */" : "rhs") << ") ";
         out.block([&] {
+            if (isCppBitwiseComparable()) {
+                // No padding and no floating point fields, so the bytes decide.
+                out << "return ::std::memcmp(&lhs, &rhs, sizeof(lhs)) == 0;\n";
+                return;
+            }
+
             if (mStyle == STYLE_SAFE_UNION) {
                 out.sIf("lhs.getDiscriminator() != rhs.getDiscriminator()", [&] {
                     out << "return false;\n";
@@ -914,6 +1025,183 @@ void CompoundType::emitPackageTypeHeaderDefinitions(Formatter& out) const {
     }
 }
 
+// Hashes the bytes of a value, a word at a time.
+static void emitCppHashBytesFunction(Formatter& out) {
+    out << "static size_t hashBytes(const void* data, size_t size, uint64_t seed) ";
+    out.block([&] {
+        out << "const uint8_t* bytes = static_cast<const uint8_t*>(data);\n";
+        out << "uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ULL);\n";
+        out << "size_t i = 0;\n";
+        out << "for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) ";
+        out.block([&] {
+            out << "uint64_t word;\n";
+            out << "::std::memcpy(&word, bytes + i, sizeof(word));\n";
+            out << "h = (h ^ word) * 0xff51afd7ed558ccdULL;\n";
+            out << "h ^= h >> 32;\n";
+        }).endl();
+        out << "for (; i < size; i++) ";
+        out.block([&] { out << "h = (h ^ bytes[i]) * 0x100000001b3ULL;\n"; }).endl();
+        out << "h ^= h >> 29;\n";
+        out << "return static_cast<size_t>(h);\n";
+    }).endl().endl();
+}
+
+// Hash of a field for which isCppHashableField is true.
+static std::string cppFieldHash(const Type& type, const std::string& name) {
+    if (type.resolveToScalarType() != nullptr) {
+        return "::std::hash<" + type.getCppStackType() + ">()(" + name + ")";
+    }
+    if (type.isCppBitwiseComparable()) {
+        return "hashBytes(&" + name + ", sizeof(" + name + "), 0)";
+    }
+    if (type.isString()) {
+        return "hashBytes(" + name + ".c_str(), " + name + ".size(), 0)";
+    }
+    if (type.isVector()) {
+        const Type* elementType = static_cast<const VectorType&>(type).getElementType();
+        return "hashBytes(" + name + ".data(), " + name + ".size() * sizeof(" +
+               elementType->getCppStackType() + "), " + name + ".size())";
+    }
+    return "::std::hash<" + type.getCppStackType() + ">()(" + name + ")";
+}
+
+// The hidl_type_kind enumerator describing a field of the given type.
+static std::string cppTypeKind(const Type& type) {
+    if (type.isEnum()) return "ENUM";
+    if (type.isBitField()) return "BITFIELD";
+    if (type.isScalar()) return "SCALAR";
+    if (type.isString()) return "STRING";
+    if (type.isVector()) return "VECTOR";
+    if (type.isArray()) return "ARRAY";
+    if (type.isHandle()) return "HANDLE";
+    if (type.isMemory()) return "MEMORY";
+    if (type.isInterface()) return "INTERFACE";
+    if (type.isFmq()) return "FMQ";
+    if (type.isCompoundType()) {
+        switch (static_cast<const CompoundType&>(type).style()) {
+            case CompoundType::STYLE_STRUCT:
+                return "STRUCT";
+            case CompoundType::STYLE_UNION:
+                return "UNION";
+            case CompoundType::STYLE_SAFE_UNION:
+                return "SAFE_UNION";
+        }
+    }
+    return "POINTER";
+}
+
+void CompoundType::emitTypeInfo(Formatter& out) const {
+    out << "namespace android {\n";
+    out << "namespace hardware {\n";
+    out << "namespace details {\n\n";
+
+    out << "template <>\n";
+    out << "struct hidl_type_info<" << fullName() << "> ";
+    out.block([&] {
+        out << "static constexpr const char* name = \"" << fqName().string() << "\";\n";
+        out << "static constexpr hidl_type_kind kind = hidl_type_kind::" << cppTypeKind(*this)
+            << ";\n";
+        out << "static constexpr size_t size = sizeof(" << fullName() << ");\n";
+
+        if (mStyle == STYLE_SAFE_UNION) {
+            out << "// Offsets are into the union holding the active field.\n";
+        }
+        out << "static constexpr ::std::array<hidl_field_info, " << mFields.size()
+            << "> fields = {{\n";
+        out.indent(2, [&] {
+            for (const auto* field : mFields) {
+                const std::string offset =
+                        mStyle == STYLE_SAFE_UNION
+                                ? "0"
+                                : "offsetof(" + fullName() + ", " + field->name() + ")";
+                // definedName() spells out templates and arrays in full, where
+                // localName() is only "vec" or the element type.
+                out << "{\"" << field->name() << "\", \"" << field->type().definedName()
+                    << "\", hidl_type_kind::" << cppTypeKind(field->type()) << ", " << offset
+                    << ", sizeof(" << field->type().getCppStackType() << ")},\n";
+            }
+        });
+        out << "}};\n";
+
+        if (mStyle == STYLE_UNION) {
+            // Nothing records which field of a plain union is set.
+            return;
+        }
+
+        out << "\n";
+        out << "// Calls visitor(fields[i], o.field) for each field of a struct, or for\n"
+            << "// the active field of a safe_union.\n";
+        out << "template <typename Object, typename Visitor>\n";
+        out << "static void forEachField(Object& o, Visitor&& visitor) ";
+        out.block([&] {
+            if (mFields.empty()) {
+                out << "(void)o;\n";
+                out << "(void)visitor;\n";
+                return;
+            }
+
+            if (mStyle == STYLE_STRUCT) {
+                for (size_t i = 0; i < mFields.size(); i++) {
+                    out << "visitor(fields[" << i << "], o." << mFields[i]->name() << ");\n";
+                }
+                return;
+            }
+
+            out << "switch (o.getDiscriminator()) ";
+            out.block([&] {
+                for (size_t i = 0; i < mFields.size(); i++) {
+                    out << "case " << fullName() << "::hidl_discriminator::"
+                        << mFields[i]->name() << ":\n";
+                    out.indent([&] {
+                        out << "visitor(fields[" << i << "], o." << mFields[i]->name()
+                            << "());\n";
+                        out << "break;\n";
+                    });
+                }
+            }).endl();
+        }).endl();
+    });
+    out << ";\n\n";
+
+    out << "}  // namespace details\n";
+    out << "}  // namespace hardware\n";
+    out << "}  // namespace android\n\n";
+}
+
+void CompoundType::emitGlobalTypeDeclarations(Formatter& out) const {
+    Scope::emitGlobalTypeDeclarations(out);
+
+    emitTypeInfo(out);
+
+    if (!isCppHashable()) {
+        return;
+    }
+
+    out << "namespace std {\n\n";
+    out << "template <>\n";
+    out << "struct hash<" << fullName() << "> ";
+    out.block([&] {
+        emitCppHashBytesFunction(out);
+
+        out << "size_t operator()(" << getCppArgumentType() << " o) const ";
+        out.block([&] {
+            if (isCppBitwiseComparable()) {
+                out << "return hashBytes(&o, sizeof(o), 0);\n";
+                return;
+            }
+
+            out << "size_t h = 0;\n";
+            for (const auto* field : mFields) {
+                out << "h ^= " << cppFieldHash(field->type(), "o." + field->name())
+                    << " + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);\n";
+            }
+            out << "return h;\n";
+        }).endl();
+    });
+    out << ";\n\n";
+    out << "}  // namespace std\n\n";
+}
+
 void CompoundType::emitPackageHwDeclarations(Formatter& out) const {
     Scope::emitPackageHwDeclarations(out);
 
@@ -1107,6 +1395,11 @@ void CompoundType::emitSafeUnionTypeConstructors(Formatter& out) const {
         emitSafeUnionFieldConstructor(out, mFields.at(0), "");
     }).endl().endl();
 
+    if (isTriviallyCopyableSafeUnion()) {
+        // The rest is defaulted in the declaration.
+        return;
+    }
+
     // Destructor
     out << fullName() << "::~" << definedName() << "() ";
 
@@ -1218,8 +1511,10 @@ void CompoundType::emitSafeUnionTypeDefinitions(Formatter& out) const {
     }
 
     // Trivial constructor/destructor for internal union
-    out << fullName() << "::hidl_union::hidl_union() {}\n\n"
-        << fullName() << "::hidl_union::~hidl_union() {}\n\n";
+    out << fullName() << "::hidl_union::hidl_union() {}\n\n";
+    if (!isTriviallyCopyableSafeUnion()) {
+        out << fullName() << "::hidl_union::~hidl_union() {}\n\n";
+    }
 
     // Utility method
     out << fullName() << "::hidl_discriminator ("
@@ -1391,6 +1686,11 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
             field->type().emitJavaFieldInitializer(out, field->name());
         }
 
+        if (isJavaImmutable()) {
+            out << "\n// Cached by hashCode(), 0 until it is first called.\n"
+                << "private int hidl_hash = 0;\n";
+        }
+
         out << "\n";
     } else {
         LOG(FATAL) << "Java output doesn't support " << mStyle;
@@ -1422,10 +1722,11 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
                 }).endl();
             } else {
                 for (const auto& field : mFields) {
-                    std::string condition = (field->type().isScalar() || field->type().isEnum())
-                        ? "this." + field->name() + " != other." + field->name()
-                        : ("!android.os.HidlSupport.deepEquals(this." + field->name()
-                                + ", other." + field->name() + ")");
+                    const std::string lhs = "this." + field->name();
+                    const std::string rhs = "other." + field->name();
+                    std::string condition = (field->type().resolveToScalarType() != nullptr)
+                        ? lhs + " != " + rhs
+                        : "!" + field->type().getJavaEqualsCall(lhs, rhs);
                     out.sIf(condition, [&] {
                         out << "return false;\n";
                     }).endl();
@@ -1434,20 +1735,33 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
             out << "return true;\n";
         }).endl().endl();
 
+        // The fields are combined the way java.util.Objects.hash() does, without
+        // boxing them into an Object[] first.
         out << "@Override\npublic final int hashCode() ";
         out.block([&] {
-            out << "return java.util.Objects.hash(\n";
-            out.indent(2, [&] {
-                if (mStyle == STYLE_SAFE_UNION) {
-                    out << "android.os.HidlSupport.deepHashCode(this.hidl_o),\n"
-                        << "java.util.Objects.hashCode(this.hidl_d)";
-                } else {
-                    out.join(mFields.begin(), mFields.end(), ", \n", [&](const auto& field) {
-                        out << "android.os.HidlSupport.deepHashCode(this." << field->name() << ")";
-                    });
+            if (isJavaImmutable()) {
+                out.sIf("this.hidl_hash != 0", [&] {
+                    out << "return this.hidl_hash;\n";
+                }).endl();
+            }
+
+            out << "int _hidl_hash = 1;\n";
+            if (mStyle == STYLE_SAFE_UNION) {
+                out << "_hidl_hash = 31 * _hidl_hash + "
+                    << "android.os.HidlSupport.deepHashCode(this.hidl_o);\n"
+                    << "_hidl_hash = 31 * _hidl_hash + "
+                    << getUnionDiscriminatorType()->getJavaHashCodeCall("this.hidl_d") << ";\n";
+            } else {
+                for (const auto& field : mFields) {
+                    out << "_hidl_hash = 31 * _hidl_hash + "
+                        << field->type().getJavaHashCodeCall("this." + field->name()) << ";\n";
                 }
-            });
-            out << ");\n";
+            }
+
+            if (isJavaImmutable()) {
+                out << "this.hidl_hash = _hidl_hash;\n";
+            }
+            out << "return _hidl_hash;\n";
         }).endl().endl();
     } else {
         out << "// equals() is not generated for " << definedName() << "\n";
@@ -1458,7 +1772,15 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
     out << "@Override\npublic final String toString() ";
     out.block([&] {
         out << "java.lang.StringBuilder builder = new java.lang.StringBuilder();\n"
-            << "builder.append(\"{\");\n";
+            << "appendTo(builder);\n"
+            << "return builder.toString();\n";
+    }).endl().endl();
+
+    // Nested structs append to the same builder instead of building their own
+    // strings.
+    out << "public final void appendTo(java.lang.StringBuilder builder) ";
+    out.block([&] {
+        out << "builder.append(\"{\");\n";
 
         if (mStyle == STYLE_SAFE_UNION) {
             out << "switch (this.hidl_d) {\n";
@@ -1500,7 +1822,7 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
             out << "}\n";
         }
 
-        out << "builder.append(\"}\");\nreturn builder.toString();\n";
+        out << "builder.append(\"}\");\n";
     }).endl().endl();
 
     CompoundLayout layout = getCompoundAlignmentAndSize();
@@ -1594,6 +1916,10 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
         out << "android.os.HwParcel parcel, android.os.HwBlob _hidl_blob, long _hidl_offset) {\n";
         out.unindent();
 
+        if (isJavaImmutable()) {
+            out << "this.hidl_hash = 0;\n";
+        }
+
         if (mStyle == STYLE_SAFE_UNION) {
             getUnionDiscriminatorType()->emitJavaFieldReaderWriter(
                 out, 0 /* depth */, "parcel", "_hidl_blob", "hidl_d",
@@ -1775,10 +2101,165 @@ void CompoundType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) con
         out << "}\n";
     }
 
+    if (isJavaView()) {
+        out << "\n";
+        emitJavaViewDeclarations(out);
+    }
+
     out.unindent();
     out << "};\n\n";
 }
 
+// The java.nio.ByteBuffer getter that reads a value of the given scalar type.
+static std::string getJavaByteBufferGetter(const ScalarType* type) {
+    const std::string suffix = type->getJavaSuffix();
+    if (suffix == "Bool" || suffix == "Int8") return "get";
+    if (suffix == "Int16") return "getShort";
+    if (suffix == "Int32") return "getInt";
+    if (suffix == "Int64") return "getLong";
+    if (suffix == "Float") return "getFloat";
+    CHECK(suffix == "Double") << suffix;
+    return "getDouble";
+}
+
+void CompoundType::emitJavaViewDeclarations(Formatter& out) const {
+    CHECK(isJavaView());
+
+    size_t vecAlign, vecSize;
+    VectorType::getAlignmentAndSizeStatic(&vecAlign, &vecSize);
+
+    size_t elementAlign, elementSize;
+    getAlignmentAndSize(&elementAlign, &elementSize);
+
+    // Emits an expression reading field at fieldOffset of the element at
+    // offsetName out of the ByteBuffer bytesName.
+    const auto emitFieldRead = [&](const NamedReference<Type>* field, size_t fieldOffset,
+                                   const std::string& bytesName, const std::string& offsetName) {
+        const ScalarType* scalarType = field->type().resolveToScalarType();
+        out << bytesName << "." << getJavaByteBufferGetter(scalarType) << "(" << offsetName
+            << " + " << fieldOffset << ")";
+        if (scalarType->getJavaSuffix() == "Bool") {
+            out << " != 0";
+        }
+    };
+
+    std::vector<size_t> fieldOffsets;
+    size_t offset = 0;
+    for (const auto& field : mFields) {
+        size_t fieldAlign, fieldSize;
+        field->type().getAlignmentAndSize(&fieldAlign, &fieldSize);
+
+        offset += Layout::getPad(offset, fieldAlign);
+        fieldOffsets.push_back(offset);
+        offset += fieldSize;
+    }
+
+    out << "/**\n"
+        << " * A read-only vec<" << definedName() << "> that keeps the elements in their\n"
+        << " * wire layout and decodes fields on access. All elements are copied out of\n"
+        << " * native memory with a single call when the view is created, so it stays\n"
+        << " * valid after the parcel it was read from is released.\n"
+        << " */\n";
+    out << "public static final class View ";
+    out.block([&] {
+        out << "private final int mSize;\n"
+            << "private final java.nio.ByteBuffer mBytes;\n\n";
+
+        out << "private View(android.os.HwBlob blob, int size) ";
+        out.block([&] {
+            out << "byte[] bytes = new byte[size * " << elementSize << "];\n";
+            out.sIf("size > 0", [&] {
+                out << "blob.copyToInt8Array(0 /* offset */, bytes, bytes.length);\n";
+            }).endl();
+            out << "mSize = size;\n"
+                << "mBytes = java.nio.ByteBuffer.wrap(bytes).order("
+                << "java.nio.ByteOrder.LITTLE_ENDIAN);\n";
+        }).endl().endl();
+
+        out << "public static final View fromList(java.util.ArrayList<" << definedName()
+            << "> list) ";
+        out.block([&] {
+            out << "android.os.HwBlob blob = new android.os.HwBlob((int)(list.size() * "
+                << elementSize << "));\n";
+            out.sFor("int i = 0; i < list.size(); ++i", [&] {
+                out << "list.get(i).writeEmbeddedToBlob(blob, i * " << elementSize << ");\n";
+            }).endl();
+            out << "return new View(blob, list.size());\n";
+        }).endl().endl();
+
+        out << "public final int size() ";
+        out.block([&] { out << "return mSize;\n"; }).endl().endl();
+
+        out << "private int offsetOf(int index) ";
+        out.block([&] {
+            out.sIf("index < 0 || index >= mSize", [&] {
+                out << "throw new IndexOutOfBoundsException("
+                    << "\"Index \" + index + \" out of range for size \" + mSize);\n";
+            }).endl();
+            out << "return index * " << elementSize << ";\n";
+        }).endl().endl();
+
+        for (size_t i = 0; i < mFields.size(); i++) {
+            const auto& field = mFields[i];
+
+            out << "public final " << field->type().getJavaType() << " get"
+                << StringHelper::Capitalize(field->name()) << "(int index) ";
+            out.block([&] {
+                out << "return ";
+                emitFieldRead(field, fieldOffsets[i], "mBytes", "offsetOf(index)");
+                out << ";\n";
+            }).endl().endl();
+        }
+
+        out << "public final " << definedName() << " get(int index) ";
+        out.block([&] {
+            out << "int offset = offsetOf(index);\n"
+                << definedName() << " element = new " << definedName() << "();\n";
+            for (size_t i = 0; i < mFields.size(); i++) {
+                out << "element." << mFields[i]->name() << " = ";
+                emitFieldRead(mFields[i], fieldOffsets[i], "mBytes", "offset");
+                out << ";\n";
+            }
+            out << "return element;\n";
+        }).endl().endl();
+
+        out << "public final java.util.ArrayList<" << definedName() << "> toList() ";
+        out.block([&] {
+            out << "java.util.ArrayList<" << definedName() << "> list = new java.util.ArrayList<"
+                << definedName() << ">(mSize);\n";
+            out.sFor("int i = 0; i < mSize; ++i", [&] { out << "list.add(get(i));\n"; }).endl();
+            out << "return list;\n";
+        }).endl();
+    }).endl().endl();
+
+    out << "public static final View readViewFromParcel(android.os.HwParcel parcel) ";
+    out.block([&] {
+        out << "android.os.HwBlob _hidl_blob = parcel.readBuffer(" << vecSize
+            << " /* sizeof hidl_vec<T> */);\n";
+        out << "int _hidl_vec_size = _hidl_blob.getInt32(8 /* offsetof(hidl_vec<T>, mSize) */);\n";
+        out << "android.os.HwBlob childBlob = parcel.readEmbeddedBuffer(\n";
+        out.indent(2, [&] {
+            out << "_hidl_vec_size * " << elementSize << ", _hidl_blob.handle(),\n"
+                << "0 /* offsetof(hidl_vec<T>, mBuffer) */, true /* nullable */);\n";
+        });
+        out << "return new View(childBlob, _hidl_vec_size);\n";
+    }).endl().endl();
+
+    out << "public static final void writeViewToParcel(android.os.HwParcel parcel, View view) ";
+    out.block([&] {
+        out << "android.os.HwBlob _hidl_blob = new android.os.HwBlob(" << vecSize
+            << " /* sizeof(hidl_vec<T>) */);\n";
+        out << "_hidl_blob.putInt32(8 /* offsetof(hidl_vec<T>, mSize) */, view.mSize);\n";
+        out << "_hidl_blob.putBool(12 /* offsetof(hidl_vec<T>, mOwnsBuffer) */, false);\n";
+        out << "android.os.HwBlob childBlob = new android.os.HwBlob(view.mBytes.capacity());\n";
+        out.sIf("view.mSize > 0", [&] {
+            out << "childBlob.putInt8Array(0 /* offset */, view.mBytes.array());\n";
+        }).endl();
+        out << "_hidl_blob.putBlob(0 /* offsetof(hidl_vec<T>, mBuffer) */, childBlob);\n";
+        out << "parcel.writeBuffer(_hidl_blob);\n";
+    }).endl();
+}
+
 void CompoundType::emitStructReaderWriter(
         Formatter &out, const std::string &prefix, bool isReader) const {
 
@@ -1881,6 +2362,76 @@ bool CompoundType::needsEmbeddedReadWrite() const {
     return false;
 }
 
+bool CompoundType::isCppTriviallyCopyable() const {
+    if (mStyle == STYLE_SAFE_UNION && !isTriviallyCopyableSafeUnion()) {
+        return false;
+    }
+
+    return std::all_of(mFields.begin(), mFields.end(),
+                       [](const auto* field) { return field->type().isCppTriviallyCopyable(); });
+}
+
+bool CompoundType::isCppBitwiseComparable() const {
+    if (mStyle != STYLE_STRUCT || mFields.empty()) {
+        return false;
+    }
+
+    size_t fieldsSize = 0;
+    for (const auto* field : mFields) {
+        if (!field->type().isCppBitwiseComparable()) {
+            return false;
+        }
+
+        size_t fieldAlign, fieldSize;
+        field->type().getAlignmentAndSize(&fieldAlign, &fieldSize);
+        fieldsSize += fieldSize;
+    }
+
+    // Any difference is padding, which is not guaranteed to be zeroed.
+    size_t align, size;
+    getAlignmentAndSize(&align, &size);
+    return fieldsSize == size;
+}
+
+// Whether a field of the given type can be hashed consistently with how it is
+// compared, see emitCppFieldHash.
+static bool isCppHashableField(const Type& type) {
+    if (type.isCppBitwiseComparable() || type.resolveToScalarType() != nullptr ||
+        type.isString()) {
+        return true;
+    }
+
+    if (type.isVector()) {
+        return static_cast<const VectorType&>(type).getElementType()->isCppBitwiseComparable();
+    }
+
+    return type.isCompoundType() && static_cast<const CompoundType&>(type).isCppHashable();
+}
+
+bool CompoundType::isCppHashable() const {
+    return mStyle == STYLE_STRUCT && canCheckEquality() &&
+           std::all_of(mFields.begin(), mFields.end(),
+                       [](const auto* field) { return isCppHashableField(field->type()); });
+}
+
+bool CompoundType::isTriviallyCopyableSafeUnion() const {
+    return mStyle == STYLE_SAFE_UNION &&
+           std::any_of(annotations().begin(), annotations().end(),
+                       [](const auto* a) { return a->name() == "triviallyCopyable"; });
+}
+
+bool CompoundType::isJavaImmutable() const {
+    return mStyle == STYLE_STRUCT &&
+           std::any_of(annotations().begin(), annotations().end(),
+                       [](const auto* a) { return a->name() == "javaImmutable"; });
+}
+
+bool CompoundType::isJavaView() const {
+    return mStyle == STYLE_STRUCT &&
+           std::any_of(annotations().begin(), annotations().end(),
+                       [](const auto* a) { return a->name() == "javaView"; });
+}
+
 bool CompoundType::resultNeedsDeref() const {
     return !containsInterface() ;
 }
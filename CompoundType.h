@@ -87,6 +87,14 @@ struct CompoundType : public Scope {
             const std::string &argName,
             bool isReader) const override;
 
+    void emitJavaDump(
+            Formatter &out,
+            const std::string &streamName,
+            const std::string &name) const override;
+
+    std::string getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const override;
+    std::string getJavaHashCodeCall(const std::string& name) const override;
+
     void emitJavaFieldInitializer(
             Formatter &out, const std::string &fieldName) const override;
 
@@ -108,6 +116,7 @@ struct CompoundType : public Scope {
     void emitPackageTypeDeclarations(Formatter& out) const override;
     void emitPackageTypeHeaderDefinitions(Formatter& out) const override;
     void emitPackageHwDeclarations(Formatter& out) const override;
+    void emitGlobalTypeDeclarations(Formatter& out) const override;
 
     void emitTypeDefinitions(Formatter& out, const std::string& prefix) const override;
 
@@ -115,6 +124,23 @@ struct CompoundType : public Scope {
 
     bool needsEmbeddedReadWrite() const override;
     bool resultNeedsDeref() const override;
+    bool isCppTriviallyCopyable() const override;
+    bool isCppBitwiseComparable() const override;
+    // Whether a std::hash specialization is generated for this struct.
+    bool isCppHashable() const;
+
+    // Whether this is a safe_union annotated with @triviallyCopyable, which
+    // gets defaulted copy, move and destruction instead of a switch over the
+    // discriminator.
+    bool isTriviallyCopyableSafeUnion() const;
+
+    // Whether this is a struct annotated with @javaImmutable. Its fields must
+    // not change once hashCode() has been called, which caches the result.
+    bool isJavaImmutable() const;
+
+    // Whether this is a struct annotated with @javaView, whose Java class gets
+    // a View over vec<T> that decodes fields lazily from the wire layout.
+    bool isJavaView() const;
 
     void emitVtsTypeDeclarations(Formatter& out) const override;
     void emitVtsAttributeType(Formatter& out) const override;
@@ -157,6 +183,9 @@ private:
     void emitLayoutAsserts(Formatter& out, const Layout& localLayout,
                            const std::string& localLayoutName) const;
 
+    // Emits the hidl_type_info specialization describing the fields.
+    void emitTypeInfo(Formatter& out) const;
+
     void emitInvalidSubTypeNamesError(const std::string& subTypeName,
                                       const Location& location) const;
 
@@ -174,6 +203,7 @@ private:
                                               bool usesMoveSemantics) const;
 
     CompoundLayout getCompoundAlignmentAndSize() const;
+    void emitJavaViewDeclarations(Formatter& out) const;
     void emitPaddingZero(Formatter& out, size_t offset, size_t size) const;
 
     void emitSafeUnionReaderWriterForInterfaces(
@@ -19,6 +19,7 @@
 #include <hidl-util/Formatter.h>
 #include <inttypes.h>
 #include <iostream>
+#include <map>
 #include <string>
 #include <unordered_map>
 
@@ -412,6 +413,27 @@ void EnumType::emitGlobalTypeDeclarations(Formatter& out) const {
 
     emitIteratorDeclaration(out);
 
+    out << "\n";
+    out << "template <>\n";
+    out << "struct hidl_type_info<" << fullName() << "> ";
+    out.block([&] {
+        out << "static constexpr const char* name = \"" << fqName().string() << "\";\n";
+        out << "static constexpr hidl_type_kind kind = hidl_type_kind::ENUM;\n";
+        out << "static constexpr size_t size = sizeof(" << fullName() << ");\n";
+        out << "using storage_type = " << mStorageType->resolveToScalarType()->getCppStackType()
+            << ";\n";
+        out << "static constexpr ::std::array<hidl_enumerator_info<" << fullName() << ">, "
+            << numValueNames() << "> enumerators = {{\n";
+        out.indent(2, [&] {
+            forEachValueFromRoot([&](const EnumValue* value) {
+                out << "{" << fullName() << "::" << value->name() << ", \"" << value->name()
+                    << "\"},\n";
+            });
+        });
+        out << "}};\n";
+    });
+    out << ";\n\n";
+
     out << "}  // namespace details\n";
     out << "}  // namespace hardware\n";
     out << "}  // namespace android\n\n";
@@ -421,7 +443,12 @@ void EnumType::emitPackageTypeDeclarations(Formatter& out) const {
     out << "template<typename>\n"
         << "static inline std::string toString(" << resolveToScalarType()->getCppArgumentType()
         << " o);\n";
+    out << "template<typename>\n"
+        << "static inline void appendToString(" << resolveToScalarType()->getCppArgumentType()
+        << " o, ::std::string* os);\n";
     out << "static inline std::string toString(" << getCppArgumentType() << " o);\n";
+    out << "static inline void appendToString(" << getCppArgumentType()
+        << " o, ::std::string* os);\n";
     out << "static inline void PrintTo(" << getCppArgumentType() << " o, ::std::ostream* os);\n";
 
     emitEnumBitwiseOperator(out, true  /* lhsIsEnum */, true  /* rhsIsEnum */, "|");
@@ -437,60 +464,172 @@ void EnumType::emitPackageTypeDeclarations(Formatter& out) const {
     out.endl();
 }
 
+void EnumType::emitCppNameLookup(Formatter& out) const {
+    const ScalarType* scalarType = mStorageType->resolveToScalarType();
+    CHECK(scalarType != nullptr);
+    const std::string storageType = scalarType->getCppStackType();
+
+    bool isSigned = false;
+    switch (scalarType->getKind()) {
+        case ScalarType::KIND_INT8:
+        case ScalarType::KIND_INT16:
+        case ScalarType::KIND_INT32:
+        case ScalarType::KIND_INT64:
+            isSigned = true;
+            break;
+        default:
+            break;
+    }
+
+    // Values are ordered as unsigned keys; flipping the sign bit of signed
+    // values keeps their order.
+    std::map<uint64_t, const EnumValue*> byKey;
+    forEachValueFromRoot([&](const EnumValue* value) {
+        uint64_t key = isSigned ? static_cast<uint64_t>(std::stoll(
+                                          value->rawValue(ScalarType::KIND_INT64))) ^
+                                          (1ull << 63)
+                                : std::stoull(value->rawValue(ScalarType::KIND_UINT64));
+        // Aliases print as the first enumerator given the value.
+        byKey.emplace(key, value);
+    });
+
+    out << "static inline const char* _hidl_enumeratorName(" << getCppArgumentType() << " o) ";
+    out.block([&] {
+        if (byKey.empty()) {
+            out << "(void)o;\n";
+            out << "return nullptr;\n";
+            return;
+        }
+
+        const uint64_t span = byKey.rbegin()->first - byKey.begin()->first;
+        if (span < 2 * byKey.size()) {
+            out << "static constexpr const char* kNames[] = ";
+            out.block([&] {
+                uint64_t key = byKey.begin()->first;
+                for (const auto& entry : byKey) {
+                    for (; key < entry.first; key++) {
+                        out << "nullptr,\n";
+                    }
+                    out << "\"" << entry.second->name() << "\",\n";
+                    key++;
+                }
+            });
+            out << ";\n";
+            out << "const uint64_t index = static_cast<uint64_t>(static_cast<" << storageType
+                << ">(o)) - static_cast<uint64_t>(static_cast<" << storageType << ">("
+                << fullName() << "::" << byKey.begin()->second->name() << "));\n";
+            out << "return index < sizeof(kNames) / sizeof(kNames[0]) ? kNames[index] : "
+                   "nullptr;\n";
+            return;
+        }
+
+        out << "static constexpr struct { " << fullName() << " value; const char* name; } "
+            << "kNames[] = ";
+        out.block([&] {
+            for (const auto& entry : byKey) {
+                out << "{" << fullName() << "::" << entry.second->name() << ", \""
+                    << entry.second->name() << "\"},\n";
+            }
+        });
+        out << ";\n";
+        out << "size_t lo = 0;\n";
+        out << "size_t hi = sizeof(kNames) / sizeof(kNames[0]);\n";
+        out << "while (lo < hi) ";
+        out.block([&] {
+            out << "const size_t mid = lo + (hi - lo) / 2;\n";
+            out.sIf("kNames[mid].value < o", [&] { out << "lo = mid + 1;\n"; }).sElse([&] {
+                out << "hi = mid;\n";
+            }).endl();
+        }).endl();
+        out << "return lo < sizeof(kNames) / sizeof(kNames[0]) && kNames[lo].value == o ? "
+               "kNames[lo].name : nullptr;\n";
+    }).endl().endl();
+}
+
 void EnumType::emitPackageTypeHeaderDefinitions(Formatter& out) const {
     const ScalarType *scalarType = mStorageType->resolveToScalarType();
     CHECK(scalarType != nullptr);
 
     out << "template<>\n"
-        << "inline std::string toString<" << getCppStackType() << ">("
-        << scalarType->getCppArgumentType() << " o) ";
+        << "inline void appendToString<" << getCppStackType() << ">("
+        << scalarType->getCppArgumentType() << " o, ::std::string* os) ";
     out.block([&] {
         // include toHexString for scalar types
-        out << "using ::android::hardware::details::toHexString;\n"
-            << "std::string os;\n"
-            << getBitfieldCppType(StorageMode_Stack) << " flipped = 0;\n"
+        out << "using ::android::hardware::details::toHexString;\n";
+        out << getBitfieldCppType(StorageMode_Stack) << " flipped = 0;\n"
             << "bool first = true;\n";
-        forEachValueFromRoot([&](const EnumValue* value) {
-            std::string valueName = fullName() + "::" + value->name();
-            out.sIf("(o & " + valueName + ")" +
-                    " == static_cast<" + scalarType->getCppStackType() +
-                    ">(" + valueName + ")", [&] {
-                out << "os += (first ? \"\" : \" | \");\n"
-                    << "os += \"" << value->name() << "\";\n"
-                    << "first = false;\n"
-                    << "flipped |= " << valueName << ";\n";
+        if (numValueNames() > 0) {
+            out << "static constexpr struct { " << scalarType->getCppStackType()
+                << " value; const char* name; } kFlags[] = ";
+            out.block([&] {
+                forEachValueFromRoot([&](const EnumValue* value) {
+                    out << "{static_cast<" << scalarType->getCppStackType() << ">("
+                        << fullName() << "::" << value->name() << "), \"" << value->name()
+                        << "\"},\n";
+                });
+            });
+            out << ";\n";
+            out << "for (const auto& flag : kFlags) ";
+            out.block([&] {
+                out.sIf("(o & flag.value) == flag.value", [&] {
+                    out << "os->append(first ? \"\" : \" | \");\n"
+                        << "os->append(flag.name);\n"
+                        << "first = false;\n"
+                        << "flipped |= flag.value;\n";
+                }).endl();
             }).endl();
-        });
+        }
         // put remaining bits
         out.sIf("o != flipped", [&] {
-            out << "os += (first ? \"\" : \" | \");\n";
-            scalarType->emitHexDump(out, "os", "o & (~flipped)");
+            out << "os->append(first ? \"\" : \" | \");\n";
+            scalarType->emitHexDump(out, "*os", "o & (~flipped)");
         });
-        out << "os += \" (\";\n";
-        scalarType->emitHexDump(out, "os", "o");
-        out << "os += \")\";\n";
+        out << "os->append(\" (\");\n";
+        scalarType->emitHexDump(out, "*os", "o");
+        out << "os->append(\")\");\n";
+    }).endl().endl();
 
+    out << "template<>\n"
+        << "inline std::string toString<" << getCppStackType() << ">("
+        << scalarType->getCppArgumentType() << " o) ";
+    out.block([&] {
+        out << "std::string os;\n";
+        out << "appendToString<" << getCppStackType() << ">(o, &os);\n";
         out << "return os;\n";
     }).endl().endl();
 
-    out << "static inline std::string toString(" << getCppArgumentType() << " o) ";
+    emitCppNameLookup(out);
 
+    out << "static inline void appendToString(" << getCppArgumentType()
+        << " o, ::std::string* os) ";
     out.block([&] {
         out << "using ::android::hardware::details::toHexString;\n";
-        forEachValueFromRoot([&](const EnumValue* value) {
-            out.sIf("o == " + fullName() + "::" + value->name(), [&] {
-                out << "return \"" << value->name() << "\";\n";
-            }).endl();
-        });
-        out << "std::string os;\n";
-        scalarType->emitHexDump(out, "os",
+        out << "const char* name = _hidl_enumeratorName(o);\n";
+        out.sIf("name != nullptr", [&] {
+            out << "os->append(name);\n";
+            out << "return;\n";
+        }).endl();
+        scalarType->emitHexDump(out, "*os",
             "static_cast<" + scalarType->getCppStackType() + ">(o)");
+    }).endl().endl();
+
+    out << "static inline std::string toString(" << getCppArgumentType() << " o) ";
+    out.block([&] {
+        out << "const char* name = _hidl_enumeratorName(o);\n";
+        out.sIf("name != nullptr", [&] { out << "return name;\n"; }).endl();
+        out << "std::string os;\n";
+        out << "appendToString(o, &os);\n";
         out << "return os;\n";
     }).endl().endl();
 
     out << "static inline void PrintTo(" << getCppArgumentType() << " o, ::std::ostream* os) ";
 
-    out.block([&] { out << "*os << toString(o);\n"; }).endl().endl();
+    out.block([&] {
+        out << "const char* name = _hidl_enumeratorName(o);\n";
+        out.sIf("name != nullptr", [&] { out << "*os << name;\n"; }).sElse([&] {
+            out << "*os << toString(o);\n";
+        }).endl();
+    }).endl().endl();
 }
 
 void EnumType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) const {
@@ -525,49 +664,170 @@ void EnumType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) const {
         }
     }
 
+    emitJavaNameLookup(out);
+
+    out << "public static final void appendTo(StringBuilder builder, " << typeName << " o) ";
+    out.block([&] {
+        out << "final String name = hidl_lookupName(o);\n";
+        out.sIf("name != null", [&] { out << "builder.append(name);\n"; }).sElse([&] {
+            out << "builder.append(\"0x\").append(";
+            scalarType->emitConvertToJavaHexString(out, "o");
+            out << ");\n";
+        }).endl();
+    }).endl().endl();
+
     out << "public static final String toString("
         << typeName << " o) ";
     out.block([&] {
-        forEachValueFromRoot([&](const EnumValue* value) {
-            out.sIf("o == " + value->name(), [&] {
-                out << "return \"" << value->name() << "\";\n";
-            }).endl();
-        });
+        out << "final String name = hidl_lookupName(o);\n";
+        out.sIf("name != null", [&] { out << "return name;\n"; }).endl();
         out << "return \"0x\" + ";
         scalarType->emitConvertToJavaHexString(out, "o");
         out << ";\n";
     }).endl();
 
     auto bitfieldType = getBitfieldJavaType(false /* forInitializer */);
-    out << "\n"
-        << "public static final String dumpBitfield("
-        << bitfieldType << " o) ";
+    out << "\n";
+    if (numValueNames() > 0) {
+        // Flags are checked in declaration order; zero-valued enumerators
+        // always match and are always listed.
+        out << "private static final " << bitfieldType << "[] hidl_flagValues = ";
+        out.block([&] {
+            forEachValueFromRoot([&](const EnumValue* value) { out << value->name() << ",\n"; });
+        });
+        out << ";\n\n";
+        out << "private static final String[] hidl_flagNames = ";
+        out.block([&] {
+            forEachValueFromRoot(
+                    [&](const EnumValue* value) { out << "\"" << value->name() << "\",\n"; });
+        });
+        out << ";\n\n";
+    }
+
+    out << "public static final void appendBitfield(StringBuilder builder, " << bitfieldType
+        << " o) ";
     out.block([&] {
-        out << "java.util.ArrayList<String> list = new java.util.ArrayList<>();\n";
         out << bitfieldType << " flipped = 0;\n";
-        forEachValueFromRoot([&](const EnumValue* value) {
-            if (value->constExpr()->castSizeT() == 0) {
-                out << "list.add(\"" << value->name() << "\"); // " << value->name() << " == 0\n";
-                return;  // continue to next value
-            }
-            out.sIf("(o & " + value->name() + ") == " + value->name(), [&] {
-                out << "list.add(\"" << value->name() << "\");\n";
-                out << "flipped |= " << value->name() << ";\n";
+        out << "boolean first = true;\n";
+        if (numValueNames() > 0) {
+            out.sFor("int i = 0; i < hidl_flagValues.length; ++i", [&] {
+                out.sIf("(o & hidl_flagValues[i]) == hidl_flagValues[i]", [&] {
+                    out << "builder.append(first ? \"\" : \" | \").append(hidl_flagNames[i]);\n";
+                    out << "first = false;\n";
+                    out << "flipped |= hidl_flagValues[i];\n";
+                }).endl();
             }).endl();
-        });
+        }
         // put remaining bits
         out.sIf("o != flipped", [&] {
-            out << "list.add(\"0x\" + ";
+            out << "builder.append(first ? \"0x\" : \" | 0x\").append(";
             scalarType->emitConvertToJavaHexString(out, "o & (~flipped)");
             out << ");\n";
         }).endl();
-        out << "return String.join(\" | \", list);\n";
+    }).endl().endl();
+
+    out << "public static final String dumpBitfield("
+        << bitfieldType << " o) ";
+    out.block([&] {
+        out << "StringBuilder builder = new StringBuilder();\n";
+        out << "appendBitfield(builder, o);\n";
+        out << "return builder.toString();\n";
     }).endl().endl();
 
     out.unindent();
     out << "};\n\n";
 }
 
+void EnumType::emitJavaNameLookup(Formatter& out) const {
+    const ScalarType* scalarType = mStorageType->resolveToScalarType();
+    CHECK(scalarType != nullptr);
+    const std::string typeName = scalarType->getJavaType(false /* forInitializer */);
+
+    size_t align, size;
+    scalarType->getAlignmentAndSize(&align, &size);
+    const size_t shift = 64 - 8 * size;
+
+    bool isSigned = false;
+    switch (scalarType->getKind()) {
+        case ScalarType::KIND_INT8:
+        case ScalarType::KIND_INT16:
+        case ScalarType::KIND_INT32:
+        case ScalarType::KIND_INT64:
+            isSigned = true;
+            break;
+        default:
+            break;
+    }
+
+    // Java compares the signed reinterpretation of unsigned values, so the
+    // tables are ordered by that.
+    std::map<int64_t, const EnumValue*> byValue;
+    forEachValueFromRoot([&](const EnumValue* value) {
+        int64_t key;
+        if (isSigned) {
+            key = std::stoll(value->rawValue(ScalarType::KIND_INT64));
+        } else {
+            const uint64_t raw = std::stoull(value->rawValue(ScalarType::KIND_UINT64));
+            key = static_cast<int64_t>(raw << shift) >> shift;
+        }
+        // Aliases print as the first enumerator given the value.
+        byValue.emplace(key, value);
+    });
+
+    if (byValue.empty()) {
+        out << "private static String hidl_lookupName(" << typeName << " o) ";
+        out.block([&] { out << "return null;\n"; }).endl().endl();
+        return;
+    }
+
+    const uint64_t first = static_cast<uint64_t>(byValue.begin()->first);
+    const uint64_t span = static_cast<uint64_t>(byValue.rbegin()->first) - first;
+    if (span < 2 * byValue.size()) {
+        out << "private static final String[] hidl_names = ";
+        out.block([&] {
+            uint64_t index = 0;
+            for (const auto& entry : byValue) {
+                for (; index < static_cast<uint64_t>(entry.first) - first; index++) {
+                    out << "null,\n";
+                }
+                out << "\"" << entry.second->name() << "\",\n";
+                index++;
+            }
+        });
+        out << ";\n\n";
+
+        out << "private static String hidl_lookupName(" << typeName << " o) ";
+        out.block([&] {
+            out << "final long index = (long) o - (long) " << byValue.begin()->second->name()
+                << ";\n";
+            out << "return index >= 0 && index < hidl_names.length ? hidl_names[(int) index] : "
+                   "null;\n";
+        }).endl().endl();
+        return;
+    }
+
+    out << "private static final " << typeName << "[] hidl_values = ";
+    out.block([&] {
+        for (const auto& entry : byValue) {
+            out << entry.second->name() << ",\n";
+        }
+    });
+    out << ";\n\n";
+    out << "private static final String[] hidl_names = ";
+    out.block([&] {
+        for (const auto& entry : byValue) {
+            out << "\"" << entry.second->name() << "\",\n";
+        }
+    });
+    out << ";\n\n";
+
+    out << "private static String hidl_lookupName(" << typeName << " o) ";
+    out.block([&] {
+        out << "final int index = java.util.Arrays.binarySearch(hidl_values, o);\n";
+        out << "return index >= 0 ? hidl_names[index] : null;\n";
+    }).endl().endl();
+}
+
 void EnumType::emitVtsTypeDeclarations(Formatter& out) const {
     const ScalarType *scalarType = mStorageType->resolveToScalarType();
 
@@ -613,8 +873,7 @@ void EnumType::emitJavaDump(
         Formatter &out,
         const std::string &streamName,
         const std::string &name) const {
-    out << streamName << ".append(" << fqName().javaName() << ".toString("
-        << name << "));\n";
+    out << fqName().javaName() << ".appendTo(" << streamName << ", " << name << ");\n";
 }
 
 std::vector<const EnumType*> EnumType::typeChain() const {
@@ -935,8 +1194,8 @@ void BitFieldType::emitJavaDump(
         Formatter &out,
         const std::string &streamName,
         const std::string &name) const {
-    out << streamName << ".append(" << getEnumType()->fqName().javaName() << ".dumpBitfield("
-        << name << "));\n";
+    out << getEnumType()->fqName().javaName() << ".appendBitfield(" << streamName << ", " << name
+        << ");\n";
 }
 
 void BitFieldType::emitJavaFieldReaderWriter(
@@ -130,6 +130,14 @@ struct EnumType : public Scope {
     void emitIteratorDeclaration(Formatter& out) const;
     void emitIteratorDefinitions(Formatter& out) const;
 
+    // Emits a function mapping a value to the name of its first enumerator,
+    // or nullptr, using a dense table or a binary search over sorted values.
+    void emitCppNameLookup(Formatter& out) const;
+
+    // Emits the tables and private method mapping a value to the name of
+    // its first enumerator, or null, for the Java enum class.
+    void emitJavaNameLookup(Formatter& out) const;
+
     void emitEnumBitwiseOperator(
             Formatter &out,
             bool lhsIsEnum,
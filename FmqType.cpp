@@ -42,6 +42,17 @@ std::string FmqType::fullName() const {
             mName + "<" + mElementType->getCppStackType(true) + ">";
 }
 
+std::string FmqType::getCppFlavor() const {
+    if (mName == "MQDescriptorSync") {
+        return "::android::hardware::kSynchronizedReadWrite";
+    } else if (mName == "MQDescriptorUnsync") {
+        return "::android::hardware::kUnsynchronizedWrite";
+    }
+
+    CHECK(false) << "Invalid FmqType.";
+    return "";
+}
+
 std::string FmqType::getCppType(
         StorageMode mode,
         bool) const {
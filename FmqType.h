@@ -31,6 +31,8 @@ struct FmqType : public TemplatedType {
     bool isFmq() const override;
 
     std::string fullName() const;
+    // The MQFlavor of the queue, e.g. ::android::hardware::kSynchronizedReadWrite.
+    std::string getCppFlavor() const;
     std::string templatedTypeName() const override;
 
     std::string getCppType(
@@ -27,6 +27,7 @@
 
 #include <unistd.h>
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -34,6 +35,7 @@
 #include <unordered_map>
 
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <hidl-util/Formatter.h>
 #include <hidl-util/StringHelper.h>
 
@@ -67,6 +69,15 @@ enum {
     HIDL_DEBUG_TRANSACTION                    = B_PACK_CHARS(0x0f, 'D', 'B', 'G'),
     HIDL_HASH_CHAIN_TRANSACTION               = B_PACK_CHARS(0x0f, 'H', 'S', 'H'),
     LAST_HIDL_TRANSACTION   = 0x0fffffff,
+    /////////////////// Batched user defined transactions (@batch)
+    FIRST_BATCH_TRANSACTION = 0x10000000,
+    LAST_BATCH_TRANSACTION  = 0x1effffff,
+    /////////////////// Flattened user defined transactions (@flatten)
+    FIRST_FLATTEN_TRANSACTION = 0x20000000,
+    LAST_FLATTEN_TRANSACTION  = 0x2effffff,
+    /////////////////// User defined transactions with arguments in shared memory (@shm)
+    FIRST_SHM_TRANSACTION = 0x30000000,
+    LAST_SHM_TRANSACTION  = 0x3effffff,
 };
 
 const std::unique_ptr<ConstantExpression> Interface::FLAG_ONE_WAY =
@@ -518,6 +529,12 @@ status_t Interface::validate() const {
     err = validateAnnotations();
     if (err != OK) return err;
 
+    err = validateJavaAsyncNames();
+    if (err != OK) return err;
+
+    err = validateJavaArraysNames();
+    if (err != OK) return err;
+
     return Scope::validate();
 }
 
@@ -560,8 +577,340 @@ status_t Interface::validateUniqueNames() const {
     return OK;
 }
 
+// <name>Async and <name>Results are generated into the Java interface, so they
+// must not collide with a method or a nested type the interface already has.
+// Methods inherited from a @javaAsync super interface are checked as well,
+// since this interface's ResultsStub refers to their <name>Results.
+status_t Interface::validateJavaAsyncNames() const {
+    if (!isJavaCompatible() || !isJavaAsync()) return OK;
+
+    const auto& methods = allMethodsFromRoot();
+    for (const auto& tuple : methods) {
+        const Method* method = tuple.method();
+        if (!tuple.interface()->isJavaAsync() || !method->hasJavaAsyncOverload()) continue;
+
+        for (const auto& other : methods) {
+            if (other.method()->name() == method->getJavaAsyncMethodName()) {
+                std::cerr << "ERROR: Java method " << method->getJavaAsyncMethodName()
+                          << " generated for method " << method->name() << " conflicts with "
+                          << "method " << other.method()->name() << " at "
+                          << other.method()->location() << std::endl;
+                return UNKNOWN_ERROR;
+            }
+        }
+
+        if (method->results().size() <= 1) continue;
+
+        for (const NamedType* type : getSubTypes()) {
+            if (type->definedName() == method->getJavaResultsClassName()) {
+                std::cerr << "ERROR: Java class " << method->getJavaResultsClassName()
+                          << " generated for method " << method->name() << " conflicts with "
+                          << "type " << type->definedName() << " at " << method->location()
+                          << std::endl;
+                return UNKNOWN_ERROR;
+            }
+        }
+    }
+
+    return OK;
+}
+
+status_t Interface::validateJavaArraysNames() const {
+    // Every interface checks the methods of its super interfaces as well, so
+    // that a method clashing with the overload of an inherited method is found.
+    const auto& methods = allMethodsFromRoot();
+    for (const auto& tuple : methods) {
+        const Method* method = tuple.method();
+        if (!method->hasJavaArraysOverload()) continue;
+
+        for (const auto& other : methods) {
+            if (other.method()->name() == method->getJavaArraysMethodName()) {
+                std::cerr << "ERROR: @javaArrays on method " << method->name() << " conflicts with "
+                          << "method " << other.method()->name() << " at "
+                          << other.method()->location() << std::endl;
+                return UNKNOWN_ERROR;
+            }
+        }
+    }
+
+    return OK;
+}
+
+static status_t validateBatchAnnotation(const Method* method, const Annotation* annotation) {
+    if (!method->isOneway()) {
+        std::cerr << "ERROR: @batch can only be used on oneway methods, but " << method->name()
+                  << " is not oneway at " << method->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    for (const AnnotationParam* param : annotation->params()) {
+        const std::string& name = param->getName();
+        if (name != "max" && name != "flushUs") {
+            std::cerr << "ERROR: Unrecognized parameter '" << name << "' of @batch for method "
+                      << method->name() << ". A parameter should be one of: max, flushUs."
+                      << std::endl;
+            return UNKNOWN_ERROR;
+        }
+
+        size_t value;
+        if (param->getValues().size() != 1 ||
+            !base::ParseUint(param->getSingleString(), &value) || value == 0) {
+            std::cerr << "ERROR: Parameter '" << name << "' of @batch for method "
+                      << method->name() << " must be a positive integer." << std::endl;
+            return UNKNOWN_ERROR;
+        }
+    }
+
+    return OK;
+}
+
+static status_t validateFlattenAnnotation(const Method* method, const Annotation* annotation) {
+    if (method->isOneway()) {
+        std::cerr << "ERROR: @flatten can only be used on methods that return, but "
+                  << method->name() << " is oneway at " << method->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    if (!annotation->params().empty()) {
+        std::cerr << "ERROR: @flatten takes no parameters, for method " << method->name()
+                  << " at " << method->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    bool hasFlattenedArg = false;
+    for (const auto* args : {&method->args(), &method->results()}) {
+        for (const NamedReference<Type>* arg : *args) {
+            if (!Method::isCppFlattenedArg(arg)) continue;
+
+            if (!Method::isCppFlattenableType(arg->type())) {
+                std::cerr << "ERROR: @flatten can only encode scalars, strings, vecs, arrays "
+                          << "of scalars and structs of those, but " << arg->name() << " of "
+                          << method->name() << " is " << arg->type().typeName() << " at "
+                          << arg->location() << std::endl;
+                return UNKNOWN_ERROR;
+            }
+            hasFlattenedArg = true;
+        }
+    }
+
+    if (!hasFlattenedArg) {
+        std::cerr << "ERROR: @flatten requires a string, vec or struct argument or result "
+                  << "containing one, for method " << method->name() << " at "
+                  << method->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    return OK;
+}
+
+static status_t validateShmAnnotation(const Method* method, const Annotation* annotation) {
+    if (method->isBatched() || method->isFlattened()) {
+        std::cerr << "ERROR: @shm cannot be combined with @batch or @flatten, for method "
+                  << method->name() << " at " << method->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    for (const AnnotationParam* param : annotation->params()) {
+        const std::string& name = param->getName();
+        if (name != "arg" && name != "threshold") {
+            std::cerr << "ERROR: Unrecognized parameter '" << name << "' of @shm for method "
+                      << method->name() << ". A parameter should be one of: arg, threshold."
+                      << std::endl;
+            return UNKNOWN_ERROR;
+        }
+
+        if (param->getValues().size() != 1) {
+            std::cerr << "ERROR: Parameter '" << name << "' of @shm for method "
+                      << method->name() << " takes a single value." << std::endl;
+            return UNKNOWN_ERROR;
+        }
+    }
+
+    const AnnotationParam* threshold = annotation->getParam("threshold");
+    size_t value;
+    if (threshold != nullptr &&
+        !Method::parseShmThreshold(threshold->getSingleString(), &value)) {
+        std::cerr << "ERROR: Parameter 'threshold' of @shm for method " << method->name()
+                  << " must be a size in bytes, optionally followed by K or M." << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    const NamedReference<Type>* arg =
+            annotation->getParam("arg") != nullptr ? method->getShmArg() : nullptr;
+    if (arg == nullptr) {
+        std::cerr << "ERROR: @shm requires arg to name an argument of method " << method->name()
+                  << " at " << method->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    const Type* element = arg->type().isVector()
+                                  ? static_cast<const VectorType&>(arg->type()).getElementType()
+                                  : nullptr;
+    if (element == nullptr || !element->isScalar() ||
+        static_cast<const ScalarType*>(element)->getKind() != ScalarType::KIND_UINT8) {
+        std::cerr << "ERROR: @shm can only be used on vec<uint8_t> arguments, but "
+                  << arg->name() << " of " << method->name() << " is "
+                  << arg->type().typeName()
+                  << " at " << arg->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    return OK;
+}
+
+static status_t validateJavaArraysAnnotation(const Method* method,
+                                             const Annotation* annotation) {
+    if (!annotation->params().empty()) {
+        std::cerr << "ERROR: @javaArrays takes no parameters, for method " << method->name()
+                  << " at " << method->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    const auto& args = method->args();
+    const auto& results = method->results();
+    if (std::none_of(args.begin(), args.end(), &Method::isJavaArrayArg) &&
+        std::none_of(results.begin(), results.end(), &Method::isJavaArrayArg)) {
+        std::cerr << "ERROR: @javaArrays requires a vec of scalars or @javaView structs "
+                  << "argument or result, for method " << method->name() << " at "
+                  << method->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    return OK;
+}
+
+// The View of a @javaView struct is only used by <method>Arrays overloads, so
+// any other method would silently decode every element.
+static status_t validateJavaViewArgs(const Method* method) {
+    if (method->hasJavaArraysOverload()) return OK;
+
+    for (const auto* args : {&method->args(), &method->results()}) {
+        for (const NamedReference<Type>* arg : *args) {
+            if (!arg->type().isVector()) continue;
+
+            const Type* elementType =
+                    static_cast<const VectorType&>(arg->type()).getElementType();
+            if (Method::isJavaViewElement(elementType)) {
+                std::cerr << "ERROR: vec<" << elementType->definedName()
+                          << "> of a @javaView struct can only be used by @javaArrays methods, "
+                          << "for method " << method->name() << " at " << method->location()
+                          << std::endl;
+                return UNKNOWN_ERROR;
+            }
+        }
+    }
+
+    return OK;
+}
+
+static status_t validateMethodPassthroughOnewayAnnotation(const Method* method,
+                                                          const Annotation* annotation) {
+    if (!method->isOneway()) {
+        std::cerr << "ERROR: @passthroughOneway can only be used on oneway methods, but "
+                  << method->name() << " is not oneway at " << method->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    for (const AnnotationParam* param : annotation->params()) {
+        const std::string& name = param->getName();
+        if (name == "mode") {
+            if (param->getValues().size() != 1 || param->getSingleString() != "inline") {
+                std::cerr << "ERROR: Parameter 'mode' of @passthroughOneway for method "
+                          << method->name() << " must be \"inline\"." << std::endl;
+                return UNKNOWN_ERROR;
+            }
+        } else if (name == "key") {
+            const NamedReference<Type>* key = nullptr;
+            if (param->getValues().size() == 1) {
+                for (const NamedReference<Type>* arg : method->args()) {
+                    if (arg->name() == param->getSingleString()) key = arg;
+                }
+            }
+            const ScalarType* scalar = key == nullptr ? nullptr : key->type().resolveToScalarType();
+            if (scalar == nullptr || !scalar->isValidEnumStorageType()) {
+                std::cerr << "ERROR: Parameter 'key' of @passthroughOneway for method "
+                          << method->name() << " must name an integer or enum argument."
+                          << std::endl;
+                return UNKNOWN_ERROR;
+            }
+        } else {
+            std::cerr << "ERROR: Unrecognized parameter '" << name
+                      << "' of @passthroughOneway for method " << method->name()
+                      << ". A parameter should be one of: mode, key." << std::endl;
+            return UNKNOWN_ERROR;
+        }
+    }
+
+    return OK;
+}
+
+static status_t validateInterfacePassthroughOnewayAnnotation(const Interface* iface,
+                                                             const Annotation* annotation) {
+    const AnnotationParam* modeParam = annotation->getParam("mode");
+    const std::string mode = modeParam == nullptr || modeParam->getValues().size() != 1
+                                     ? ""
+                                     : modeParam->getSingleString();
+    if (mode != "queue" && mode != "pool" && mode != "inline") {
+        std::cerr << "ERROR: @passthroughOneway for interface " << iface->definedName()
+                  << " requires a mode of \"queue\", \"pool\" or \"inline\" at "
+                  << iface->location() << std::endl;
+        return UNKNOWN_ERROR;
+    }
+
+    for (const AnnotationParam* param : annotation->params()) {
+        const std::string& name = param->getName();
+        if (name == "mode") continue;
+
+        if (name != "workers" && name != "queue") {
+            std::cerr << "ERROR: Unrecognized parameter '" << name
+                      << "' of @passthroughOneway for interface " << iface->definedName()
+                      << ". A parameter should be one of: mode, workers, queue." << std::endl;
+            return UNKNOWN_ERROR;
+        }
+
+        if ((name == "workers" && mode != "pool") || (name == "queue" && mode == "inline")) {
+            std::cerr << "ERROR: Parameter '" << name << "' of @passthroughOneway for interface "
+                      << iface->definedName() << " cannot be used with mode \"" << mode << "\"."
+                      << std::endl;
+            return UNKNOWN_ERROR;
+        }
+
+        size_t value;
+        if (param->getValues().size() != 1 ||
+            !base::ParseUint(param->getSingleString(), &value) || value == 0) {
+            std::cerr << "ERROR: Parameter '" << name << "' of @passthroughOneway for interface "
+                      << iface->definedName() << " must be a positive integer." << std::endl;
+            return UNKNOWN_ERROR;
+        }
+    }
+
+    return OK;
+}
+
 status_t Interface::validateAnnotations() const {
+    for (const Annotation* annotation : annotations()) {
+        if (annotation->name() == "passthroughOneway") {
+            status_t err = validateInterfacePassthroughOnewayAnnotation(this, annotation);
+            if (err != OK) return err;
+        }
+
+        if (annotation->name() == "javaReuseParcels" && !annotation->params().empty()) {
+            std::cerr << "ERROR: @javaReuseParcels takes no parameters, for interface "
+                      << definedName() << " at " << location() << std::endl;
+            return UNKNOWN_ERROR;
+        }
+
+        if (annotation->name() == "javaAsync" && !annotation->params().empty()) {
+            std::cerr << "ERROR: @javaAsync takes no parameters, for interface "
+                      << definedName() << " at " << location() << std::endl;
+            return UNKNOWN_ERROR;
+        }
+    }
+
     for (const Method* method : methods()) {
+        status_t err = validateJavaViewArgs(method);
+        if (err != OK) return err;
+
         for (const Annotation* annotation : method->annotations()) {
             const std::string name = annotation->name();
 
@@ -569,15 +918,153 @@ status_t Interface::validateAnnotations() const {
                 continue;
             }
 
+            if (name == "batch") {
+                status_t err = validateBatchAnnotation(method, annotation);
+                if (err != OK) return err;
+                continue;
+            }
+
+            if (name == "passthroughOneway") {
+                status_t err = validateMethodPassthroughOnewayAnnotation(method, annotation);
+                if (err != OK) return err;
+                continue;
+            }
+
+            if (name == "flatten") {
+                status_t err = validateFlattenAnnotation(method, annotation);
+                if (err != OK) return err;
+                continue;
+            }
+
+            if (name == "shm") {
+                status_t err = validateShmAnnotation(method, annotation);
+                if (err != OK) return err;
+                continue;
+            }
+
+            if (name == "javaArrays") {
+                status_t err = validateJavaArraysAnnotation(method, annotation);
+                if (err != OK) return err;
+                continue;
+            }
+
+            if (name == "async" || name == "awaitable") {
+                if (!annotation->params().empty() || method->isOneway()) {
+                    std::cerr << "ERROR: @" << name << " takes no parameters and only applies to "
+                              << "two-way methods, for method " << method->name() << " at "
+                              << method->location() << std::endl;
+                    return UNKNOWN_ERROR;
+                }
+                continue;
+            }
+
+            if (name == "move") {
+                if (!annotation->params().empty() || !method->hasCppMoveOverload()) {
+                    std::cerr << "ERROR: @move takes no parameters and requires an argument "
+                              << "passed by reference, such as a vec, string or struct, for "
+                              << "method " << method->name() << " at " << method->location()
+                              << std::endl;
+                    return UNKNOWN_ERROR;
+                }
+                continue;
+            }
+
             std::cerr << "ERROR: Unrecognized annotation '" << name
                       << "' for method: " << method->name() << ". An annotation should be one of: "
-                      << "entry, exit, callflow." << std::endl;
+                      << "entry, exit, callflow, batch, passthroughOneway, move, flatten, shm, "
+                      << "javaArrays, async, awaitable."
+                      << std::endl;
             return UNKNOWN_ERROR;
         }
     }
     return OK;
 }
 
+size_t Interface::getBatchSerialId(const Method* method) {
+    CHECK(method->isBatched());
+    static_assert(LAST_CALL_TRANSACTION <= LAST_BATCH_TRANSACTION - FIRST_BATCH_TRANSACTION,
+                  "every user defined transaction needs a batched counterpart");
+    return FIRST_BATCH_TRANSACTION + method->getSerialId();
+}
+
+size_t Interface::getFlattenSerialId(const Method* method) {
+    CHECK(method->isFlattened());
+    static_assert(LAST_CALL_TRANSACTION <= LAST_FLATTEN_TRANSACTION - FIRST_FLATTEN_TRANSACTION,
+                  "every user defined transaction needs a flattened counterpart");
+    return FIRST_FLATTEN_TRANSACTION + method->getSerialId();
+}
+
+size_t Interface::getShmSerialId(const Method* method) {
+    CHECK(method->hasShmArg());
+    static_assert(LAST_CALL_TRANSACTION <= LAST_SHM_TRANSACTION - FIRST_SHM_TRANSACTION,
+                  "every user defined transaction needs a shared memory counterpart");
+    return FIRST_SHM_TRANSACTION + method->getSerialId();
+}
+
+const Annotation* Interface::getPassthroughOnewayAnnotation() const {
+    for (const Interface* iface : typeChain()) {
+        for (const Annotation* annotation : iface->annotations()) {
+            if (annotation->name() == "passthroughOneway") {
+                return annotation;
+            }
+        }
+    }
+    return nullptr;
+}
+
+std::string Interface::getPassthroughOnewayMode() const {
+    const Annotation* annotation = getPassthroughOnewayAnnotation();
+    CHECK(annotation != nullptr);
+    return annotation->getParam("mode")->getSingleString();
+}
+
+static size_t getPassthroughOnewayParam(const Annotation* annotation, const std::string& name,
+                                        size_t defaultValue) {
+    CHECK(annotation != nullptr);
+
+    const AnnotationParam* param = annotation->getParam(name);
+    if (param == nullptr) {
+        return defaultValue;
+    }
+
+    size_t value;
+    CHECK(base::ParseUint(param->getSingleString(), &value)) << name << " must be an integer.";
+    return value;
+}
+
+size_t Interface::getPassthroughOnewayWorkers() const {
+    return getPassthroughOnewayMode() == "pool"
+                   ? getPassthroughOnewayParam(getPassthroughOnewayAnnotation(), "workers", 4)
+                   : 1;
+}
+
+size_t Interface::getPassthroughOnewayQueueSize() const {
+    // similar limit to binderized
+    return getPassthroughOnewayParam(getPassthroughOnewayAnnotation(), "queue", 3000);
+}
+
+bool Interface::isJavaReuseParcels() const {
+    for (const Interface* iface : typeChain()) {
+        for (const Annotation* annotation : iface->annotations()) {
+            if (annotation->name() == "javaReuseParcels") {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Interface::isJavaAsync() const {
+    for (const Interface* iface : typeChain()) {
+        for (const Annotation* annotation : iface->annotations()) {
+            if (annotation->name() == "javaAsync") {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 bool Interface::addAllReservedMethods(const std::map<std::string, Method*>& allReservedMethods) {
     // use a sorted map to insert them in serial ID order.
     std::map<int32_t, Method *> reservedMethodsById;
@@ -771,17 +1258,7 @@ void Interface::emitReaderWriter(
 
         handleError(out, mode);
 
-        out << name
-            << " = "
-            << "::android::hardware::fromBinder<"
-            << fqName().cppName()
-            << ","
-            << getProxyFqName().cppName()
-            << ","
-            << getStubFqName().cppName()
-            << ">("
-            << binderName
-            << ");\n";
+        out << name << " = " << getCppFromBinder(binderName) << ";\n";
 
         out.unindent();
         out << "}\n\n";
@@ -814,8 +1291,18 @@ void Interface::emitReaderWriter(
     }
 }
 
+std::string Interface::getCppFromBinder(const std::string& binderName) const {
+    return "::android::hardware::fromBinder<" + fqName().cppName() + "," +
+           getProxyFqName().cppName() + "," + getStubFqName().cppName() + ">(" + binderName + ")";
+}
+
 void Interface::emitHidlDefinition(Formatter& out) const {
     if (getDocComment() != nullptr) getDocComment()->emit(out);
+
+    out.join(annotations().begin(), annotations().end(), "\n",
+             [&](auto annotation) { annotation->dump(out); });
+    if (!annotations().empty()) out << "\n";
+
     out << typeName() << " ";
 
     const Interface* super = superType();
@@ -931,6 +1418,13 @@ void Interface::emitVtsMethodDeclaration(Formatter& out, bool isInherited) const
         }
         // Generate declaration for each annotation.
         for (const auto &annotation : method->annotations()) {
+            if (annotation->name() == "batch" || annotation->name() == "passthroughOneway" ||
+                annotation->name() == "move" || annotation->name() == "flatten" ||
+                annotation->name() == "shm" || annotation->name() == "javaArrays" ||
+                annotation->name() == "async" || annotation->name() == "awaitable") {
+                // Only affects how calls are transported.
+                continue;
+            }
             out << "callflow: {\n";
             out.indent();
             const std::string name = annotation->name();
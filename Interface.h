@@ -104,6 +104,42 @@ struct Interface : public Scope {
     status_t validate() const override;
     status_t validateUniqueNames() const;
     status_t validateAnnotations() const;
+    status_t validateJavaAsyncNames() const;
+    status_t validateJavaArraysNames() const;
+
+    // Transaction code used by the proxy to send a batch of calls to a method
+    // annotated with @batch.
+    static size_t getBatchSerialId(const Method* method);
+
+    // Transaction code used by the proxy for calls to a method annotated with
+    // @flatten, and for the probe that precedes the first of them.
+    static size_t getFlattenSerialId(const Method* method);
+
+    // Transaction code used by the proxy for calls to a method annotated with
+    // @shm, and for the probe that precedes the first of them.
+    static size_t getShmSerialId(const Method* method);
+
+    // @passthroughOneway(mode="queue|pool|inline", workers="N", queue="N") on
+    // this interface or the closest super interface that has one. Returns
+    // nullptr if there is none, in which case Bs* keeps its single TaskRunner.
+    const Annotation* getPassthroughOnewayAnnotation() const;
+    std::string getPassthroughOnewayMode() const;
+    size_t getPassthroughOnewayWorkers() const;
+    size_t getPassthroughOnewayQueueSize() const;
+
+    // @javaReuseParcels on this interface or a super interface makes the Java
+    // proxy keep a reply parcel per thread for its oneway calls instead of
+    // allocating one per call.
+    bool isJavaReuseParcels() const;
+
+    // @javaAsync on this interface or a super interface gives the methods of
+    // this interface <name>Async variants in Java, and gives the interface a
+    // ResultsStub and an OnewaySender.
+    bool isJavaAsync() const;
+
+    // Expression turning the sp<IBinder> named binderName into an sp of this
+    // interface.
+    std::string getCppFromBinder(const std::string& binderName) const;
 
     void emitReaderWriter(
             Formatter &out,
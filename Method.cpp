@@ -17,16 +17,20 @@
 #include "Method.h"
 
 #include "Annotation.h"
+#include "CompoundType.h"
 #include "ConstantExpression.h"
 #include "FormattingConstants.h"
 #include "Reference.h"
 #include "ScalarType.h"
 #include "Type.h"
+#include "VectorType.h"
 
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
 #include <algorithm>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -74,6 +78,169 @@ const std::vector<Annotation *> &Method::annotations() const {
     return *mAnnotations;
 }
 
+const Annotation* Method::getBatchAnnotation() const {
+    for (const Annotation* annotation : *mAnnotations) {
+        if (annotation->name() == "batch") {
+            return annotation;
+        }
+    }
+    return nullptr;
+}
+
+static size_t getBatchParam(const Annotation* annotation, const std::string& name,
+                            size_t defaultValue) {
+    CHECK(annotation != nullptr);
+
+    const AnnotationParam* param = annotation->getParam(name);
+    if (param == nullptr) {
+        return defaultValue;
+    }
+
+    size_t value;
+    CHECK(base::ParseUint(param->getSingleString(), &value)) << name << " must be an integer.";
+    return value;
+}
+
+size_t Method::getBatchMax() const {
+    return getBatchParam(getBatchAnnotation(), "max", 64);
+}
+
+size_t Method::getBatchFlushUs() const {
+    return getBatchParam(getBatchAnnotation(), "flushUs", 500);
+}
+
+const Annotation* Method::getPassthroughOnewayAnnotation() const {
+    for (const Annotation* annotation : *mAnnotations) {
+        if (annotation->name() == "passthroughOneway") {
+            return annotation;
+        }
+    }
+    return nullptr;
+}
+
+bool Method::isPassthroughOnewayInline() const {
+    const Annotation* annotation = getPassthroughOnewayAnnotation();
+    if (annotation == nullptr) {
+        return false;
+    }
+
+    const AnnotationParam* param = annotation->getParam("mode");
+    return param != nullptr && param->getSingleString() == "inline";
+}
+
+const NamedReference<Type>* Method::getPassthroughOnewayKey() const {
+    const Annotation* annotation = getPassthroughOnewayAnnotation();
+    if (annotation == nullptr) {
+        return nullptr;
+    }
+
+    const AnnotationParam* param = annotation->getParam("key");
+    if (param == nullptr) {
+        return nullptr;
+    }
+
+    const std::string name = param->getSingleString();
+    for (const NamedReference<Type>* arg : *mArgs) {
+        if (arg->name() == name) {
+            return arg;
+        }
+    }
+
+    CHECK(false) << "key " << name << " is not an argument of " << mName;
+    return nullptr;
+}
+
+const Annotation* Method::getFlattenAnnotation() const {
+    for (const Annotation* annotation : *mAnnotations) {
+        if (annotation->name() == "flatten") {
+            return annotation;
+        }
+    }
+    return nullptr;
+}
+
+const Annotation* Method::getShmAnnotation() const {
+    for (const Annotation* annotation : *mAnnotations) {
+        if (annotation->name() == "shm") {
+            return annotation;
+        }
+    }
+    return nullptr;
+}
+
+const NamedReference<Type>* Method::getShmArg() const {
+    const Annotation* annotation = getShmAnnotation();
+    CHECK(annotation != nullptr);
+
+    const AnnotationParam* param = annotation->getParam("arg");
+    if (param == nullptr) {
+        return nullptr;
+    }
+
+    const std::string name = param->getSingleString();
+    for (const NamedReference<Type>* arg : *mArgs) {
+        if (arg->name() == name) {
+            return arg;
+        }
+    }
+    return nullptr;
+}
+
+size_t Method::getShmThreshold() const {
+    const Annotation* annotation = getShmAnnotation();
+    CHECK(annotation != nullptr);
+
+    const AnnotationParam* param = annotation->getParam("threshold");
+    if (param == nullptr) {
+        return 64 * 1024;
+    }
+
+    size_t value;
+    CHECK(parseShmThreshold(param->getSingleString(), &value)) << "threshold must be a size.";
+    return value;
+}
+
+bool Method::parseShmThreshold(const std::string& value, size_t* threshold) {
+    size_t scale = 1;
+    std::string digits = value;
+    if (!digits.empty() && (digits.back() == 'K' || digits.back() == 'M')) {
+        scale = digits.back() == 'K' ? 1024 : 1024 * 1024;
+        digits.pop_back();
+    }
+
+    size_t count;
+    if (!base::ParseUint(digits, &count, std::numeric_limits<uint32_t>::max() / scale)) {
+        return false;
+    }
+    *threshold = count * scale;
+    return true;
+}
+
+bool Method::isCppFlattenedArg(const NamedReference<Type>* arg) {
+    return arg->type().needsEmbeddedReadWrite();
+}
+
+bool Method::isCppFlattenableType(const Type& type) {
+    if (type.isCppTriviallyCopyable() || type.isString()) {
+        return true;
+    }
+
+    if (type.isVector()) {
+        return isCppFlattenableType(*static_cast<const VectorType&>(type).getElementType());
+    }
+
+    if (type.isCompoundType()) {
+        const auto& compound = static_cast<const CompoundType&>(type);
+        const auto fields = compound.getFields();
+        return compound.style() == CompoundType::STYLE_STRUCT &&
+               std::all_of(fields.begin(), fields.end(), [](const auto* field) {
+                   return isCppFlattenableType(field->type());
+               });
+    }
+
+    return false;
+}
+
 std::vector<Reference<Type>*> Method::getReferences() {
     const auto& constRet = static_cast<const Method*>(this)->getReferences();
     std::vector<Reference<Type>*> ret(constRet.size());
@@ -196,9 +363,10 @@ static void emitCppArgResultSignature(Formatter& out,
 }
 
 static void emitJavaArgResultSignature(Formatter& out,
-                                       const std::vector<NamedReference<Type>*>& args) {
+                                       const std::vector<NamedReference<Type>*>& args,
+                                       bool arrays = false) {
     out.join(args.begin(), args.end(), ", ", [&](auto arg) {
-        out << arg->type().getJavaType();
+        out << (arrays ? Method::getJavaArraysType(arg) : arg->type().getJavaType());
         out << " ";
         out << arg->name();
     });
@@ -220,6 +388,126 @@ void Method::emitCppArgSignature(Formatter &out, bool specifyNamespaces) const {
 void Method::emitCppResultSignature(Formatter &out, bool specifyNamespaces) const {
     emitCppArgResultSignature(out, results(), specifyNamespaces);
 }
+
+bool Method::hasCppResultsStruct() const {
+    return !mIsHidlReserved && !results().empty() && canElideCallback() == nullptr;
+}
+
+std::string Method::getCppResultsStructName() const {
+    return name() + "_results";
+}
+
+std::string Method::getCppResultsMethodName() const {
+    return name() + "_toResults";
+}
+
+void Method::emitCppResultsStructArgSignature(Formatter &out, bool specifyNamespaces) const {
+    CHECK(hasCppResultsStruct());
+
+    emitCppArgResultSignature(out, args(), specifyNamespaces);
+
+    if (!args().empty()) {
+        out << ", ";
+    }
+
+    out << getCppResultsStructName() << "& _hidl_results";
+}
+
+bool Method::hasCppAsyncOverload() const {
+    return !mIsHidlReserved && !isOneway() &&
+           std::any_of(mAnnotations->begin(), mAnnotations->end(),
+                       [](const auto* a) { return a->name() == "async"; });
+}
+
+std::string Method::getCppAsyncCallbackType(bool specifyNamespaces) const {
+    std::string result = "std::function<void(" + getCppAwaitResultType(specifyNamespaces);
+
+    if (hasCppResultsStruct()) {
+        result += ", " + getCppResultsStructName();
+    }
+
+    return result + ")>";
+}
+
+void Method::emitCppAsyncArgSignature(Formatter &out, bool specifyNamespaces) const {
+    CHECK(hasCppAsyncOverload());
+
+    emitCppArgResultSignature(out, args(), specifyNamespaces);
+
+    if (!args().empty()) {
+        out << ", ";
+    }
+
+    out << "const std::function<void(std::function<void(void)>)>& _hidl_executor, "
+        << name() << "_async_cb _hidl_done";
+}
+
+std::string Method::getCppAwaitResultType(bool specifyNamespaces) const {
+    const std::string space = (specifyNamespaces ? "::android::hardware::" : "");
+    const NamedReference<Type>* elidedReturn = canElideCallback();
+
+    if (elidedReturn != nullptr) {
+        return space + "Return<" + elidedReturn->type().getCppResultType(specifyNamespaces) + ">";
+    }
+    return space + "Return<void>";
+}
+
+bool Method::hasCppAwaitableOverload() const {
+    return !mIsHidlReserved && !isOneway() &&
+           std::any_of(mAnnotations->begin(), mAnnotations->end(),
+                       [](const auto* a) { return a->name() == "awaitable"; });
+}
+
+void Method::emitCppAwaitableArgSignature(Formatter &out, bool specifyNamespaces) const {
+    CHECK(hasCppAwaitableOverload());
+
+    emitCppArgResultSignature(out, args(), specifyNamespaces);
+
+    if (!args().empty()) {
+        out << ", ";
+    }
+
+    if (hasCppResultsStruct()) {
+        out << getCppResultsStructName() << "& _hidl_results, ";
+    }
+
+    out << "const std::function<void(std::function<void(void)>)>& _hidl_executor";
+}
+
+bool Method::hasCppMoveOverload() const {
+    if (mIsHidlReserved) return false;
+
+    const bool annotated = std::any_of(mAnnotations->begin(), mAnnotations->end(),
+                                       [](const auto* a) { return a->name() == "move"; });
+    return annotated && std::any_of(mArgs->begin(), mArgs->end(), &Method::isCppMovableArg);
+}
+
+std::string Method::getCppMoveMethodName() const {
+    return name() + "_move";
+}
+
+bool Method::isCppMovableArg(const NamedReference<Type>* arg) {
+    // Interfaces are reference counted, so there is nothing to gain.
+    if (arg->type().isInterface()) return false;
+
+    return arg->type().getCppArgumentType() == "const " + arg->type().getCppStackType() + "&";
+}
+
+void Method::emitCppMoveArgSignature(Formatter &out, bool specifyNamespaces) const {
+    CHECK(hasCppMoveOverload());
+
+    out.join(args().begin(), args().end(), ", ", [&](const auto* arg) {
+        if (isCppMovableArg(arg)) {
+            out << arg->type().getCppStackType(specifyNamespaces) << "&& " << arg->name();
+        } else {
+            out << arg->type().getCppArgumentType(specifyNamespaces) << " " << arg->name();
+        }
+    });
+
+    if (!results().empty() && canElideCallback() == nullptr) {
+        out << ", " << name() << "_cb _hidl_cb";
+    }
+}
 void Method::emitJavaArgSignature(Formatter &out) const {
     emitJavaArgResultSignature(out, args());
 }
@@ -251,6 +539,112 @@ void Method::emitJavaSignature(Formatter& out) const {
     out << ")";
 }
 
+bool Method::hasJavaAsyncOverload() const {
+    return !mIsHidlReserved && !isOneway();
+}
+
+std::string Method::getJavaAsyncMethodName() const {
+    return name() + "Async";
+}
+
+std::string Method::getJavaResultsClassName() const {
+    return name() + "Results";
+}
+
+std::string Method::getJavaAsyncResultType() const {
+    std::string resultType = "Void";
+
+    if (results().size() > 1) {
+        resultType = getJavaResultsClassName();
+    } else if (!results().empty()) {
+        const Type& type = results()[0]->type();
+        const ScalarType* scalarType = type.resolveToScalarType();
+        resultType = (scalarType != nullptr) ? scalarType->getJavaTypeClass() : type.getJavaType();
+    }
+
+    return "java.util.concurrent.CompletableFuture<" + resultType + ">";
+}
+
+void Method::emitJavaAsyncSignature(Formatter& out) const {
+    CHECK(hasJavaAsyncOverload());
+
+    out << getJavaAsyncResultType() << " " << getJavaAsyncMethodName() << "(";
+    emitJavaArgResultSignature(out, args());
+
+    if (!args().empty()) {
+        out << ", ";
+    }
+
+    out << "java.util.concurrent.Executor _hidl_executor)";
+}
+
+const Annotation* Method::getJavaArraysAnnotation() const {
+    for (const Annotation* annotation : *mAnnotations) {
+        if (annotation->name() == "javaArrays") {
+            return annotation;
+        }
+    }
+    return nullptr;
+}
+
+std::string Method::getJavaArraysMethodName() const {
+    return name() + "Arrays";
+}
+
+bool Method::isJavaArrayArg(const NamedReference<Type>* arg) {
+    if (!arg->type().isVector()) return false;
+
+    const Type* elementType = static_cast<const VectorType&>(arg->type()).getElementType();
+    return elementType->isScalar() || isJavaViewElement(elementType);
+}
+
+bool Method::isJavaViewElement(const Type* elementType) {
+    return elementType->isCompoundType() &&
+           static_cast<const CompoundType*>(elementType)->isJavaView();
+}
+
+std::string Method::getJavaArraysType(const NamedReference<Type>* arg) {
+    if (!isJavaArrayArg(arg)) {
+        return arg->type().getJavaType();
+    }
+
+    const Type* elementType = static_cast<const VectorType&>(arg->type()).getElementType();
+    if (isJavaViewElement(elementType)) {
+        return elementType->getJavaType() + ".View";
+    }
+    return elementType->getJavaType() + "[]";
+}
+
+void Method::emitJavaArraysResultSignature(Formatter& out) const {
+    emitJavaArgResultSignature(out, results(), true /* arrays */);
+}
+
+void Method::emitJavaArraysSignature(Formatter& out) const {
+    CHECK(hasJavaArraysOverload());
+
+    const bool returnsValue = !results().empty();
+    const bool needsCallback = results().size() > 1;
+
+    if (returnsValue && !needsCallback) {
+        out << getJavaArraysType(results()[0]);
+    } else {
+        out << "void";
+    }
+
+    out << " " << getJavaArraysMethodName() << "(";
+    emitJavaArgResultSignature(out, args(), true /* arrays */);
+
+    if (needsCallback) {
+        if (!args().empty()) {
+            out << ", ";
+        }
+
+        out << getJavaArraysMethodName() << "Callback _hidl_cb";
+    }
+
+    out << ")";
+}
+
 static void fillHidlArgResultTokens(const std::vector<NamedReference<Type>*>& args,
                                     WrappedOutput* wrappedOutput, const std::string& attachToLast) {
     for (size_t i = 0; i < args.size(); i++) {
@@ -67,6 +67,47 @@ struct Method : DocCommentable {
     bool isHidlReserved() const { return mIsHidlReserved; }
     const std::vector<Annotation *> &annotations() const;
 
+    // @batch(max="N", flushUs="T") on a oneway method lets the proxy coalesce
+    // up to N consecutive calls, held back for at most T microseconds, into a
+    // single transaction. Returns nullptr if the method is not annotated.
+    const Annotation* getBatchAnnotation() const;
+    bool isBatched() const { return getBatchAnnotation() != nullptr; }
+    size_t getBatchMax() const;
+    size_t getBatchFlushUs() const;
+
+    // @passthroughOneway(mode="inline") on a oneway method makes Bs* run it on
+    // the calling thread. @passthroughOneway(key="arg") makes a "pool" Bs*
+    // pick the worker from the value of arg, so that calls with equal keys run
+    // in order. Returns nullptr if the method is not annotated.
+    const Annotation* getPassthroughOnewayAnnotation() const;
+    bool isPassthroughOnewayInline() const;
+    // Returns nullptr if no key is given.
+    const NamedReference<Type>* getPassthroughOnewayKey() const;
+
+    // @flatten on a two-way method encodes its string, vec and struct
+    // arguments and results back to back in one buffer instead of one buffer
+    // per string and vector. Proxies fall back to the classic encoding when
+    // the stub predates it. Returns nullptr if the method is not annotated.
+    const Annotation* getFlattenAnnotation() const;
+    bool isFlattened() const { return getFlattenAnnotation() != nullptr; }
+    // Whether arg goes into the buffer of a @flatten call. Other arguments
+    // are written as usual.
+    static bool isCppFlattenedArg(const NamedReference<Type>* arg);
+    // Whether values of type can be encoded into that buffer.
+    static bool isCppFlattenableType(const Type& type);
+
+    // @shm(arg="name", threshold="N") sends the vec<uint8_t> argument name
+    // through a shared memory region instead of the parcel whenever it holds
+    // more than N bytes. N may end in K or M, and defaults to 64K. Proxies
+    // fall back to the classic encoding when the stub predates it. Returns
+    // nullptr if the method is not annotated.
+    const Annotation* getShmAnnotation() const;
+    bool hasShmArg() const { return getShmAnnotation() != nullptr; }
+    // Returns nullptr if arg does not name an argument.
+    const NamedReference<Type>* getShmArg() const;
+    size_t getShmThreshold() const;
+    static bool parseShmThreshold(const std::string& value, size_t* threshold);
+
     std::vector<Reference<Type>*> getReferences();
     std::vector<const Reference<Type>*> getReferences() const;
 
@@ -96,10 +137,77 @@ struct Method : DocCommentable {
     void emitCppArgSignature(Formatter &out, bool specifyNamespaces = true) const;
     void emitCppResultSignature(Formatter &out, bool specifyNamespaces = true) const;
 
+    // Whether the C++ interface also offers <name>_toResults, which stores
+    // the results in a generated <name>_results struct instead of invoking a
+    // callback.
+    bool hasCppResultsStruct() const;
+    std::string getCppResultsStructName() const;
+    std::string getCppResultsMethodName() const;
+    // Like emitCppArgSignature, but ends with "<name>_results& _hidl_results"
+    // in place of the callback.
+    void emitCppResultsStructArgSignature(Formatter &out, bool specifyNamespaces = true) const;
+
+    // Whether the C++ interface also offers <name>_async, which runs the
+    // blocking call on a caller-supplied executor and reports the outcome to a
+    // completion. Opted in to with @async on two-way methods.
+    bool hasCppAsyncOverload() const;
+    // The std::function type of the completion passed to <name>_async.
+    std::string getCppAsyncCallbackType(bool specifyNamespaces = true) const;
+    // Like emitCppArgSignature, but ends with the executor and the completion
+    // in place of the callback.
+    void emitCppAsyncArgSignature(Formatter &out, bool specifyNamespaces = true) const;
+    // Whether the C++ interface also offers the <name>_async overload which
+    // takes no completion and returns an awaitable. Opted in to with
+    // @awaitable on two-way methods.
+    bool hasCppAwaitableOverload() const;
+    // The Return<> type produced by awaiting that overload.
+    std::string getCppAwaitResultType(bool specifyNamespaces = true) const;
+    // Signature of the awaitable <name>_async overload: the arguments, then
+    // "<name>_results& _hidl_results" if there is a results struct, then the
+    // executor.
+    void emitCppAwaitableArgSignature(Formatter &out, bool specifyNamespaces = true) const;
+
+    // Whether the C++ interface also offers <name>_move, which takes ownership
+    // of the arguments that are otherwise passed by const reference. Opted in
+    // to with @move.
+    bool hasCppMoveOverload() const;
+    std::string getCppMoveMethodName() const;
+    // Whether arg is passed as T&& to <name>_move.
+    static bool isCppMovableArg(const NamedReference<Type>* arg);
+    // Like emitCppArgSignature, but movable arguments are passed as T&&.
+    void emitCppMoveArgSignature(Formatter &out, bool specifyNamespaces = true) const;
+
     void emitJavaArgSignature(Formatter &out) const;
     void emitJavaResultSignature(Formatter &out) const;
     void emitJavaSignature(Formatter& out) const;
 
+    // @javaArrays adds <name>Arrays to the Java interface, which takes and
+    // returns vec<scalar> arguments and results as primitive arrays, and
+    // vectors of @javaView structs as their View. Proxies and stubs copy those
+    // in bulk instead of boxing every element. Returns nullptr if the method
+    // is not annotated.
+    const Annotation* getJavaArraysAnnotation() const;
+    bool hasJavaArraysOverload() const { return getJavaArraysAnnotation() != nullptr; }
+    std::string getJavaArraysMethodName() const;
+    // Whether arg is a vec<scalar> or a vector of @javaView structs, passed as
+    // an array or View to <name>Arrays.
+    static bool isJavaArrayArg(const NamedReference<Type>* arg);
+    static bool isJavaViewElement(const Type* elementType);
+    // The Java type of arg in <name>Arrays.
+    static std::string getJavaArraysType(const NamedReference<Type>* arg);
+    void emitJavaArraysResultSignature(Formatter& out) const;
+    void emitJavaArraysSignature(Formatter& out) const;
+
+    // Two-way methods of a @javaAsync interface get a default <name>Async in
+    // the Java interface, which makes the blocking call on a caller-supplied
+    // Executor and completes a CompletableFuture with its result, or with
+    // <name>Results when the method has several results.
+    bool hasJavaAsyncOverload() const;
+    std::string getJavaAsyncMethodName() const;
+    std::string getJavaResultsClassName() const;
+    std::string getJavaAsyncResultType() const;
+    void emitJavaAsyncSignature(Formatter& out) const;
+
     void emitHidlDefinition(Formatter& out) const;
 
     const NamedReference<Type>* canElideCallback() const;
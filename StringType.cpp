@@ -148,6 +148,14 @@ void StringType::emitReaderWriterEmbedded(
             "::android::hardware");
 }
 
+std::string StringType::getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const {
+    return "java.util.Objects.equals(" + lhs + ", " + rhs + ")";
+}
+
+std::string StringType::getJavaHashCodeCall(const std::string& name) const {
+    return "java.util.Objects.hashCode(" + name + ")";
+}
+
 void StringType::emitJavaFieldInitializer(
         Formatter &out, const std::string &fieldName) const {
     emitJavaFieldDefaultInitialValue(out, "String " + fieldName);
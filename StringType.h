@@ -62,6 +62,9 @@ struct StringType : public Type {
             const std::string &parentName,
             const std::string &offsetText) const override;
 
+    std::string getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const override;
+    std::string getJavaHashCodeCall(const std::string& name) const override;
+
     void emitJavaFieldInitializer(
             Formatter &out, const std::string &fieldName) const override;
 
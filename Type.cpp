@@ -340,6 +340,19 @@ bool Type::isElidableType() const {
     return false;
 }
 
+bool Type::isCppTriviallyCopyable() const {
+    // Scalars, enums and bitfields.
+    return resolveToScalarType() != nullptr;
+}
+
+bool Type::isCppBitwiseComparable() const {
+    // Integers, bools, enums and bitfields, but not floating point values,
+    // since 0.0 == -0.0 and NaN != NaN.
+    const ScalarType* scalar = resolveToScalarType();
+    return scalar != nullptr && scalar->getKind() != ScalarType::KIND_FLOAT &&
+           scalar->getKind() != ScalarType::KIND_DOUBLE;
+}
+
 bool Type::canCheckEquality() const {
     std::unordered_set<const Type*> visited;
     return canCheckEquality(&visited);
@@ -454,6 +467,18 @@ void Type::emitJavaDump(
     out << streamName << ".append(" << name << ");\n";
 }
 
+std::string Type::getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const {
+    return "android.os.HidlSupport.deepEquals(" + lhs + ", " + rhs + ")";
+}
+
+std::string Type::getJavaHashCodeCall(const std::string& name) const {
+    const ScalarType* scalarType = resolveToScalarType();
+    if (scalarType != nullptr) {
+        return scalarType->getJavaTypeClass() + ".hashCode(" + name + ")";
+    }
+    return "android.os.HidlSupport.deepHashCode(" + name + ")";
+}
+
 void Type::emitReaderWriterEmbedded(
         Formatter &,
         size_t,
@@ -137,6 +137,14 @@ struct Type : DocCommentable {
     bool isValidEnumStorageType() const;
     virtual bool isElidableType() const;
 
+    // Returns true iff the C++ type is trivially copyable, so that values of
+    // it can be copied with memcpy.
+    virtual bool isCppTriviallyCopyable() const;
+
+    // Returns true iff two values of the C++ type are equal exactly when their
+    // bytes are: no padding, and no floating point values.
+    virtual bool isCppBitwiseComparable() const;
+
     virtual bool canCheckEquality() const;
     bool canCheckEquality(std::unordered_set<const Type*>* visited) const;
     virtual bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const;
@@ -230,6 +238,13 @@ struct Type : DocCommentable {
             const std::string &streamName,
             const std::string &name) const;
 
+    // Java expressions for the generated equals() and hashCode(): whether lhs
+    // equals rhs, and the hash code of name. Both are method calls, so they can
+    // be negated with "!". The defaults go through android.os.HidlSupport,
+    // which dispatches on the runtime type and boxes primitives.
+    virtual std::string getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const;
+    virtual std::string getJavaHashCodeCall(const std::string& name) const;
+
     virtual void emitJavaReaderWriter(
             Formatter &out,
             const std::string &parcelObj,
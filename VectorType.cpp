@@ -19,6 +19,7 @@
 #include "ArrayType.h"
 #include "CompoundType.h"
 #include "HidlTypeAssertion.h"
+#include "Interface.h"
 
 #include <hidl-util/Formatter.h>
 #include <android-base/logging.h>
@@ -224,29 +225,41 @@ void VectorType::emitReaderWriterForVectorOfBinders(
 
         handleError(out, mode);
 
+        const Interface* elementType = static_cast<const Interface*>(mElementType.get());
+        const std::string proxiesName = "_hidl_" + name + "_proxies";
+
         out << name
             << ".resize("
             << sizeName
-            << ");\n\n"
-            << "for (size_t _hidl_index = 0; _hidl_index < "
+            << ");\n\n";
+
+        // Registries commonly return the same remote callback more than once;
+        // each of them only gets one proxy object.
+        out << "std::unordered_map<::android::hardware::IBinder*, "
+            << mElementType->getCppStackType(true /* specifyNamespaces */) << "> " << proxiesName
+            << ";\n";
+
+        out << "for (size_t _hidl_index = 0; _hidl_index < "
             << sizeName
             << "; ++_hidl_index) {\n";
 
         out.indent();
 
-        out << mElementType->getCppStackType(true /* specifyNamespaces */)
-            << " _hidl_base;\n";
+        out << "::android::sp<::android::hardware::IBinder> _hidl_binder;\n";
+        out << "_hidl_err = " << parcelObjDeref << "readNullableStrongBinder(&_hidl_binder);\n";
 
-        mElementType->emitReaderWriter(
-                out,
-                "_hidl_base",
-                parcelObj,
-                parcelObjIsPointer,
-                isReader,
-                mode);
+        handleError(out, mode);
 
-        out << name
-            << "[_hidl_index] = _hidl_base;\n";
+        out.sIf("_hidl_binder != nullptr && _hidl_binder->localBinder() == nullptr", [&] {
+            out << "auto& _hidl_proxy = " << proxiesName << "[_hidl_binder.get()];\n";
+            out.sIf("_hidl_proxy == nullptr", [&] {
+                out << "_hidl_proxy = " << elementType->getCppFromBinder("_hidl_binder") << ";\n";
+            }).endl();
+            out << name << "[_hidl_index] = _hidl_proxy;\n";
+        }).sElse([&] {
+            out << name << "[_hidl_index] = " << elementType->getCppFromBinder("_hidl_binder")
+                << ";\n";
+        }).endl();
 
         out.unindent();
         out << "}\n";
@@ -431,6 +444,52 @@ void VectorType::emitJavaReaderWriter(
             "" /* extra */);
 }
 
+void VectorType::emitJavaDump(
+        Formatter &out,
+        const std::string &streamName,
+        const std::string &name) const {
+    if (!mElementType->isCompoundType()) {
+        Type::emitJavaDump(out, streamName, name);
+        return;
+    }
+
+    // Same output as ArrayList.toString(), but the elements are appended to
+    // the same builder instead of going through intermediate strings.
+    out.sIf(name + " == null", [&] {
+        out << streamName << ".append(\"null\");\n";
+    }).sElse([&] {
+        out << streamName << ".append(\"[\");\n";
+        out.sFor("int _hidl_index = 0; _hidl_index < " + name + ".size(); ++_hidl_index", [&] {
+            out.sIf("_hidl_index > 0", [&] {
+                out << streamName << ".append(\", \");\n";
+            }).endl();
+            mElementType->emitJavaDump(out, streamName, name + ".get(_hidl_index)");
+        }).endl();
+        out << streamName << ".append(\"]\");\n";
+    }).endl();
+}
+
+// Lists of these compare and hash their elements with equals() and
+// hashCode(), which matches what HidlSupport does for them.
+static bool isJavaEqualsElement(const Type* elementType) {
+    return elementType->resolveToScalarType() != nullptr || elementType->isString() ||
+           elementType->isCompoundType();
+}
+
+std::string VectorType::getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const {
+    if (!isJavaEqualsElement(mElementType.get())) {
+        return Type::getJavaEqualsCall(lhs, rhs);
+    }
+    return "java.util.Objects.equals(" + lhs + ", " + rhs + ")";
+}
+
+std::string VectorType::getJavaHashCodeCall(const std::string& name) const {
+    if (!isJavaEqualsElement(mElementType.get())) {
+        return Type::getJavaHashCodeCall(name);
+    }
+    return "java.util.Objects.hashCode(" + name + ")";
+}
+
 void VectorType::emitJavaFieldInitializer(
         Formatter &out, const std::string &fieldName) const {
     const std::string typeName = getJavaType(false /* forInitializer */);
@@ -483,6 +542,12 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
     size_t elementAlign, elementSize;
     elementType->getAlignmentAndSize(&elementAlign, &elementSize);
 
+    /* Vectors of scalars, enums and bitfields are copied between the blob and
+       a primitive array in a single call, like the innermost dimension of an
+       ArrayType, instead of crossing into native code once per element. */
+    const bool isPrimitiveVector = elementType->resolveToScalarType() != nullptr;
+    const std::string arrayName = "_hidl_vec_array_" + std::to_string(depth);
+
     if (isReader) {
         out << "{\n";
         out.indent();
@@ -512,6 +577,28 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
         out.unindent();
 
         out << fieldName << ".clear();\n";
+
+        if (isPrimitiveVector) {
+            out << fieldName << ".ensureCapacity(_hidl_vec_size);\n";
+            out << elementType->getJavaType() << "[] " << arrayName << " = new "
+                << elementType->getJavaType() << "[_hidl_vec_size];\n";
+
+            // An empty vector may have been sent with a null buffer.
+            out.sIf("_hidl_vec_size > 0", [&] {
+                out << "childBlob.copyTo" << elementType->getJavaSuffix() << "Array(0 /* offset */, "
+                    << arrayName << ", _hidl_vec_size);\n";
+            }).endl();
+
+            out << "for (" << elementType->getJavaType() << " _hidl_vec_element : " << arrayName
+                << ") ";
+            out.block([&] { out << fieldName << ".add(_hidl_vec_element);\n"; }).endl();
+
+            out.unindent();
+            out << "}\n";
+
+            return;
+        }
+
         std::string iteratorName = "_hidl_index_" + std::to_string(depth);
 
         out << "for (int "
@@ -573,6 +660,11 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
 
     std::string iteratorName = "_hidl_index_" + std::to_string(depth);
 
+    if (isPrimitiveVector) {
+        out << elementType->getJavaType() << "[] " << arrayName << " = new "
+            << elementType->getJavaType() << "[_hidl_vec_size];\n";
+    }
+
     out << "for (int "
         << iteratorName
         << " = 0; "
@@ -584,19 +676,29 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
 
     out.indent();
 
-    elementType->emitJavaFieldReaderWriter(
-            out,
-            depth + 1,
-            parcelName,
-            "childBlob",
-            fieldName + ".get(" + iteratorName + ")",
-            iteratorName + " * " + std::to_string(elementSize),
-            false /* isReader */);
+    if (isPrimitiveVector) {
+        out << arrayName << "[" << iteratorName << "] = " << fieldName << ".get(" << iteratorName
+            << ");\n";
+    } else {
+        elementType->emitJavaFieldReaderWriter(
+                out,
+                depth + 1,
+                parcelName,
+                "childBlob",
+                fieldName + ".get(" + iteratorName + ")",
+                iteratorName + " * " + std::to_string(elementSize),
+                false /* isReader */);
+    }
 
     out.unindent();
 
     out << "}\n";
 
+    if (isPrimitiveVector) {
+        out << "childBlob.put" << elementType->getJavaSuffix() << "Array(0 /* offset */, "
+            << arrayName << ");\n";
+    }
+
     out << blobName
         << ".putBlob("
         << offset
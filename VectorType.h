@@ -75,6 +75,14 @@ struct VectorType : public TemplatedType {
             const std::string &argName,
             bool isReader) const override;
 
+    void emitJavaDump(
+            Formatter &out,
+            const std::string &streamName,
+            const std::string &name) const override;
+
+    std::string getJavaEqualsCall(const std::string& lhs, const std::string& rhs) const override;
+    std::string getJavaHashCodeCall(const std::string& name) const override;
+
     void emitJavaFieldInitializer(
             Formatter &out, const std::string &fieldName) const override;
 
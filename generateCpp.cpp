@@ -16,8 +16,10 @@
 
 #include "AST.h"
 
+#include "CompoundType.h"
 #include "Coordinator.h"
 #include "EnumType.h"
+#include "FmqType.h"
 #include "HidlTypeAssertion.h"
 #include "Interface.h"
 #include "Location.h"
@@ -25,11 +27,13 @@
 #include "Reference.h"
 #include "ScalarType.h"
 #include "Scope.h"
+#include "VectorType.h"
 
 #include <algorithm>
 #include <hidl-util/Formatter.h>
 #include <hidl-util/StringHelper.h>
 #include <android-base/logging.h>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -215,6 +219,851 @@ static void implementServiceManagerInteractions(Formatter &out,
     }).endl().endl();
 }
 
+static bool hasBatchedMethods(const Interface* iface) {
+    const auto& methods = iface->allMethodsFromRoot();
+    return std::any_of(methods.begin(), methods.end(),
+                       [](const auto& tuple) { return tuple.method()->isBatched(); });
+}
+
+static CallEncoding getCallEncoding(const Method* method) {
+    if (method->isFlattened()) return CallEncoding::FLATTEN;
+    if (method->hasShmArg()) return CallEncoding::SHM;
+    return CallEncoding::CLASSIC;
+}
+
+// Whether <method>_toResults on a proxy of iface reads the reply straight into
+// the results struct. Otherwise it goes through the callback overload, which
+// flushes queued @batch calls and picks the @flatten or @shm encoding.
+static bool hasDirectResultsPath(const Interface* iface, const Method* method) {
+    return method->hasCppResultsStruct() && getCallEncoding(method) == CallEncoding::CLASSIC &&
+           !hasBatchedMethods(iface);
+}
+
+// Suffix of the static functions which send and serve calls in encoding.
+static std::string getCallEncodingSuffix(CallEncoding encoding) {
+    switch (encoding) {
+        case CallEncoding::CLASSIC:
+            return "";
+        case CallEncoding::FLATTEN:
+            return "_flat";
+        case CallEncoding::SHM:
+            return "_shm";
+    }
+    CHECK(false);
+}
+
+static size_t getCallEncodingSerialId(const Method* method, CallEncoding encoding) {
+    switch (encoding) {
+        case CallEncoding::CLASSIC:
+            return method->getSerialId();
+        case CallEncoding::FLATTEN:
+            return Interface::getFlattenSerialId(method);
+        case CallEncoding::SHM:
+            return Interface::getShmSerialId(method);
+    }
+    CHECK(false);
+}
+
+// The comment following the transaction code of a call in encoding.
+static std::string getCallEncodingComment(const Method* method, CallEncoding encoding) {
+    switch (encoding) {
+        case CallEncoding::CLASSIC:
+            return method->name();
+        case CallEncoding::FLATTEN:
+            return method->name() + " (flattened)";
+        case CallEncoding::SHM:
+            return method->name() + " (shared memory)";
+    }
+    CHECK(false);
+}
+
+static bool hasEncodedMethods(const Interface* iface) {
+    const auto& methods = iface->allMethodsFromRoot();
+    return std::any_of(methods.begin(), methods.end(), [](const auto& tuple) {
+        return getCallEncoding(tuple.method()) != CallEncoding::CLASSIC;
+    });
+}
+
+static bool definesFlattenedMethods(const Interface* iface) {
+    const auto& methods = iface->userDefinedMethods();
+    return std::any_of(methods.begin(), methods.end(),
+                       [](const Method* method) { return method->isFlattened(); });
+}
+
+static bool definesShmMethods(const Interface* iface) {
+    const auto& methods = iface->userDefinedMethods();
+    return std::any_of(methods.begin(), methods.end(),
+                       [](const Method* method) { return method->hasShmArg(); });
+}
+
+// The encoding of @flatten calls. Values are laid out back to back at their
+// natural alignment: trivially copyable values as their bytes, strings and
+// vectors as a uint64_t length followed by their contents, and other structs
+// field by field, using hidl_type_info. Strings and vectors of trivially
+// copyable elements are read in place, so they point into the received
+// buffer, which lives as long as the parcel.
+static void emitFlatCodec(Formatter& out) {
+    out << "namespace {\n\n";
+
+    out << "template <typename T>\n";
+    out << "struct _hidl_FlatVec : std::false_type {};\n";
+    out << "template <typename T>\n";
+    out << "struct _hidl_FlatVec<::android::hardware::hidl_vec<T>> : std::true_type ";
+    out.block([&] { out << "using element_type = T;\n"; });
+    out << ";\n\n";
+
+    out << "class _hidl_FlatWriter ";
+    out.block([&] {
+        out.unindent();
+        out << "public:\n";
+        out.indent();
+
+        out << "template <typename T>\n";
+        out << "void write(const T& value) ";
+        out.block([&] {
+            out << "if constexpr (std::is_trivially_copyable<T>::value) ";
+            out.block([&] { out << "append(&value, sizeof(T), alignof(T));\n"; });
+            out << " else if constexpr (std::is_same<T, ::android::hardware::hidl_string>::value) ";
+            out.block([&] {
+                out << "writeSize(value.size());\n";
+                out << "append(value.c_str(), value.size() + 1, 1);\n";
+            });
+            out << " else if constexpr (_hidl_FlatVec<T>::value) ";
+            out.block([&] {
+                out << "using E = typename _hidl_FlatVec<T>::element_type;\n";
+                out << "writeSize(value.size());\n";
+                out << "if constexpr (std::is_trivially_copyable<E>::value) ";
+                out.block([&] {
+                    out << "append(value.data(), value.size() * sizeof(E), alignof(E));\n";
+                });
+                out << " else ";
+                out.block([&] {
+                    out << "for (const E& element : value) ";
+                    out.block([&] { out << "write(element);\n"; }).endl();
+                }).endl();
+            });
+            out << " else ";
+            out.block([&] {
+                out << "::android::hardware::details::hidl_type_info<T>::forEachField(\n";
+                out.indent(2, [&] {
+                    out << "value, [this](const auto&, const auto& field) { write(field); });\n";
+                });
+            }).endl();
+        }).endl().endl();
+
+        out << "const void* data() const { return mBytes.data(); }\n";
+        out << "size_t size() const { return mBytes.size(); }\n\n";
+
+        out.unindent();
+        out << "private:\n";
+        out.indent();
+
+        out << "void writeSize(size_t size) ";
+        out.block([&] {
+            out << "const uint64_t size64 = size;\n";
+            out << "append(&size64, sizeof(size64), alignof(uint64_t));\n";
+        }).endl().endl();
+
+        out << "void append(const void* data, size_t size, size_t align) ";
+        out.block([&] {
+            out << "mBytes.resize((mBytes.size() + align - 1) / align * align);\n";
+            out << "const uint8_t* bytes = static_cast<const uint8_t*>(data);\n";
+            out << "mBytes.insert(mBytes.end(), bytes, bytes + size);\n";
+        }).endl().endl();
+
+        out << "std::vector<uint8_t> mBytes;\n";
+    });
+    out << ";\n\n";
+
+    out << "class _hidl_FlatReader ";
+    out.block([&] {
+        out.unindent();
+        out << "public:\n";
+        out.indent();
+
+        out << "_hidl_FlatReader(const void* data, size_t size)\n";
+        out.indent(2, [&] {
+            out << ": mData(static_cast<const uint8_t*>(data)), mSize(size) {}\n\n";
+        });
+
+        out << "template <typename T>\n";
+        out << "bool read(T* value) ";
+        out.block([&] {
+            out << "if constexpr (std::is_trivially_copyable<T>::value) ";
+            out.block([&] {
+                out << "const void* bytes = take(sizeof(T), alignof(T));\n";
+                out << "if (bytes == nullptr) return false;\n";
+                out << "::std::memcpy(value, bytes, sizeof(T));\n";
+                out << "return true;\n";
+            });
+            out << " else if constexpr (std::is_same<T, ::android::hardware::hidl_string>::value) ";
+            out.block([&] {
+                out << "uint64_t size;\n";
+                out << "if (!readSize(&size) || size >= remaining()) return false;\n";
+                out << "const char* chars = static_cast<const char*>(take(size + 1, 1));\n";
+                out << "if (chars == nullptr || chars[size] != '\\0') return false;\n";
+                out << "value->setToExternal(chars, size);\n";
+                out << "return true;\n";
+            });
+            out << " else if constexpr (_hidl_FlatVec<T>::value) ";
+            out.block([&] {
+                out << "using E = typename _hidl_FlatVec<T>::element_type;\n";
+                out << "uint64_t count;\n";
+                out << "if (!readSize(&count)) return false;\n";
+                out << "if constexpr (std::is_trivially_copyable<E>::value) ";
+                out.block([&] {
+                    out << "if (count > remaining() / sizeof(E)) return false;\n";
+                    out << "const void* elements = take(count * sizeof(E), alignof(E));\n";
+                    out << "if (elements == nullptr) return false;\n";
+                    out << "value->setToExternal(const_cast<E*>(static_cast<const E*>(elements)), "
+                        << "count, false /* shouldOwn */);\n";
+                    out << "return true;\n";
+                });
+                out << " else ";
+                out.block([&] {
+                    out << "// Every element takes at least one byte, which bounds the allocation.\n";
+                    out << "if (count > remaining()) return false;\n";
+                    out << "value->resize(count);\n";
+                    out << "for (E& element : *value) ";
+                    out.block([&] { out << "if (!read(&element)) return false;\n"; }).endl();
+                    out << "return true;\n";
+                }).endl();
+            });
+            out << " else ";
+            out.block([&] {
+                out << "bool ok = true;\n";
+                out << "::android::hardware::details::hidl_type_info<T>::forEachField(\n";
+                out.indent(2, [&] {
+                    out << "*value, [&](const auto&, auto& field) { ok = ok && read(&field); });\n";
+                });
+                out << "return ok;\n";
+            }).endl();
+        }).endl().endl();
+
+        out << "bool done() const { return mPosition == mSize; }\n\n";
+
+        out.unindent();
+        out << "private:\n";
+        out.indent();
+
+        out << "size_t remaining() const { return mSize - mPosition; }\n\n";
+
+        out << "bool readSize(uint64_t* size) ";
+        out.block([&] {
+            out << "const void* bytes = take(sizeof(uint64_t), alignof(uint64_t));\n";
+            out << "if (bytes == nullptr) return false;\n";
+            out << "::std::memcpy(size, bytes, sizeof(uint64_t));\n";
+            out << "return true;\n";
+        }).endl().endl();
+
+        out << "const void* take(size_t size, size_t align) ";
+        out.block([&] {
+            out << "const size_t start = (mPosition + align - 1) / align * align;\n";
+            out << "if (start > mSize || size > mSize - start) return nullptr;\n";
+            out << "mPosition = start + size;\n";
+            out << "return mData + start;\n";
+        }).endl().endl();
+
+        out << "const uint8_t* mData;\n";
+        out << "size_t mSize;\n";
+        out << "size_t mPosition = 0;\n";
+    });
+    out << ";\n\n";
+
+    out << "}  // namespace\n\n";
+}
+
+static bool hasFlattenedArgs(const std::vector<NamedReference<Type>*>& args) {
+    return std::any_of(args.begin(), args.end(), &Method::isCppFlattenedArg);
+}
+
+// Writes the flattened arguments (or results) of a @flatten call into
+// _hidl_flat_writer, which must outlive the transaction, and adds its
+// contents to the parcel as a single buffer.
+static void emitCppFlatWriter(Formatter& out, const std::string& parcelObj,
+                              bool parcelObjIsPointer,
+                              const std::vector<NamedReference<Type>*>& args,
+                              const std::string& prefix) {
+    const std::string parcel = parcelObj + (parcelObjIsPointer ? "->" : ".");
+
+    for (const auto* arg : args) {
+        if (Method::isCppFlattenedArg(arg)) {
+            out << "_hidl_flat_writer.write(" << prefix << arg->name() << ");\n";
+        }
+    }
+    out << "_hidl_err = " << parcel << "writeUint64(_hidl_flat_writer.size());\n";
+    Type::handleError(out, Type::ErrorMode_Goto);
+    out.block([&] {
+        out << "size_t _hidl_flat_handle;\n";
+        out << "_hidl_err = " << parcel << "writeBuffer(_hidl_flat_writer.data(), "
+            << "_hidl_flat_writer.size(), &_hidl_flat_handle);\n";
+    }).endl();
+    Type::handleError(out, Type::ErrorMode_Goto);
+}
+
+// Declares _hidl_flat_<prefix><name> for each flattened argument (or result),
+// the storage that <prefix><name> ends up pointing to.
+static void declareCppFlatLocals(Formatter& out, const std::vector<NamedReference<Type>*>& args,
+                                 const std::string& prefix) {
+    for (const auto* arg : args) {
+        if (Method::isCppFlattenedArg(arg)) {
+            out << arg->type().getCppStackType() << " _hidl_flat_" << prefix << arg->name()
+                << ";\n";
+        }
+    }
+}
+
+// Reads the buffer written by emitCppFlatWriter back into the locals declared
+// by declareCppFlatLocals, and points the usual reader locals at them.
+static void emitCppFlatReader(Formatter& out, const std::string& parcelObj,
+                              bool parcelObjIsPointer,
+                              const std::vector<NamedReference<Type>*>& args,
+                              const std::string& prefix, Type::ErrorMode mode) {
+    const std::string parcel = parcelObj + (parcelObjIsPointer ? "->" : ".");
+
+    out.block([&] {
+        out << "uint64_t _hidl_flat_size;\n";
+        out << "_hidl_err = " << parcel << "readUint64(&_hidl_flat_size);\n";
+        Type::handleError(out, mode);
+        out << "size_t _hidl_flat_handle;\n";
+        out << "const void* _hidl_flat_data;\n";
+        out << "_hidl_err = " << parcel << "readBuffer(_hidl_flat_size, &_hidl_flat_handle, "
+            << "&_hidl_flat_data);\n";
+        Type::handleError(out, mode);
+
+        out << "_hidl_FlatReader _hidl_flat_reader(_hidl_flat_data, _hidl_flat_size);\n";
+        out << "if (";
+        bool first = true;
+        for (const auto* arg : args) {
+            if (!Method::isCppFlattenedArg(arg)) continue;
+            out << (first ? "" : " ||\n    ") << "!_hidl_flat_reader.read(&_hidl_flat_" << prefix
+                << arg->name() << ")";
+            first = false;
+        }
+        out << " ||\n    !_hidl_flat_reader.done()) ";
+        out.block([&] { out << "_hidl_err = ::android::BAD_VALUE;\n"; }).endl();
+        Type::handleError(out, mode);
+
+        for (const auto* arg : args) {
+            if (Method::isCppFlattenedArg(arg)) {
+                out << prefix << arg->name() << " = &_hidl_flat_" << prefix << arg->name()
+                    << ";\n";
+            }
+        }
+    }).endl();
+}
+
+// Support for @shm arguments. Above the threshold, the sender copies the
+// vector into a memfd region and writes a handle to it, and the receiver maps
+// it read-only and points a hidl_vec at the mapping. The region is sealed
+// against writes and resizing before it is sent, so the receiver reads the
+// bytes that were sent for as long as it keeps the mapping, even after it has
+// replied. Regions are therefore never reused; the sender closes its fd once
+// the transaction is done.
+static void emitShmSupport(Formatter& out) {
+    out << "namespace {\n\n";
+
+    out << "// Writes a vector, which is shared if it is larger than the threshold and a\n"
+        << "// region could be created. Must outlive the transaction.\n";
+    out << "class _hidl_ShmSend ";
+    out.block([&] {
+        out.unindent();
+        out << "public:\n";
+        out.indent();
+
+        out << "_hidl_ShmSend() = default;\n";
+        out << "_hidl_ShmSend(const _hidl_ShmSend&) = delete;\n";
+        out << "_hidl_ShmSend& operator=(const _hidl_ShmSend&) = delete;\n\n";
+
+        out << "~_hidl_ShmSend() ";
+        out.block([&] {
+            out.sIf("mHandle != nullptr", [&] { out << "native_handle_delete(mHandle);\n"; })
+                    .endl();
+            out.sIf("mFd >= 0", [&] { out << "close(mFd);\n"; }).endl();
+        }).endl().endl();
+
+        out << "::android::status_t write(::android::hardware::Parcel* parcel,\n";
+        out.indent(2, [&] {
+            out << "const ::android::hardware::hidl_vec<uint8_t>& value, size_t threshold) ";
+        });
+        out.block([&] {
+            out << "mShared = value.size() > threshold && createSealed(value);\n";
+            out << "::android::status_t err = parcel->writeBool(mShared);\n";
+            out << "if (err != ::android::OK || !mShared) return err;\n\n";
+
+            out << "mHandle = native_handle_create(1 /* numFds */, 0 /* numInts */);\n";
+            out << "if (mHandle == nullptr) return ::android::NO_MEMORY;\n";
+            out << "mHandle->data[0] = mFd;\n";
+            out << "err = parcel->writeNativeHandleNoDup(mHandle);\n";
+            out << "if (err != ::android::OK) return err;\n";
+            out << "return parcel->writeUint64(value.size());\n";
+        }).endl().endl();
+
+        out << "bool shared() const { return mShared; }\n\n";
+
+        out.unindent();
+        out << "private:\n";
+        out.indent();
+
+        out << "// F_SEAL_WRITE is refused while a writable mapping exists, so the bytes\n"
+            << "// are copied through one that is unmapped before sealing.\n";
+        out << "bool createSealed(const ::android::hardware::hidl_vec<uint8_t>& value) ";
+        out.block([&] {
+            out << "const int fd = static_cast<int>(\n";
+            out.indent(2, [&] {
+                out << "syscall(__NR_memfd_create, \"hidl_shm\", "
+                    << "MFD_CLOEXEC | MFD_ALLOW_SEALING));\n";
+            });
+            out << "if (fd < 0) return false;\n";
+            out << "void* data = MAP_FAILED;\n";
+            out.sIf("ftruncate(fd, value.size()) == 0", [&] {
+                out << "data = mmap(nullptr, value.size(), PROT_READ | PROT_WRITE, MAP_SHARED, "
+                    << "fd, 0);\n";
+            }).endl();
+            out.sIf("data == MAP_FAILED", [&] {
+                out << "close(fd);\n";
+                out << "return false;\n";
+            }).endl();
+            out << "::std::memcpy(data, value.data(), value.size());\n";
+            out << "munmap(data, value.size());\n\n";
+
+            out.sIf("fcntl(fd, F_ADD_SEALS,\n"
+                    "          F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0",
+                    [&] {
+                        out << "close(fd);\n";
+                        out << "return false;\n";
+                    })
+                    .endl();
+            out << "mFd = fd;\n";
+            out << "return true;\n";
+        }).endl().endl();
+
+        out << "bool mShared = false;\n";
+        out << "int mFd = -1;\n";
+        out << "native_handle_t* mHandle = nullptr;\n";
+    });
+    out << ";\n\n";
+
+    out << "// Reads a vector written by _hidl_ShmSend. A shared vector points into a\n"
+        << "// read-only mapping, which lasts as long as this object.\n";
+    out << "class _hidl_ShmReceive ";
+    out.block([&] {
+        out.unindent();
+        out << "public:\n";
+        out.indent();
+
+        out << "_hidl_ShmReceive() = default;\n";
+        out << "_hidl_ShmReceive(const _hidl_ShmReceive&) = delete;\n";
+        out << "_hidl_ShmReceive& operator=(const _hidl_ShmReceive&) = delete;\n\n";
+
+        out << "~_hidl_ShmReceive() ";
+        out.block([&] {
+            out.sIf("mData != nullptr", [&] { out << "munmap(mData, mSize);\n"; }).endl();
+        }).endl().endl();
+
+        out << "::android::status_t read(const ::android::hardware::Parcel& parcel,\n";
+        out.indent(2, [&] {
+            out << "const ::android::hardware::hidl_vec<uint8_t>** value) ";
+        });
+        out.block([&] {
+            out << "::android::status_t err = parcel.readBool(&mShared);\n";
+            out << "if (err != ::android::OK || !mShared) return err;\n\n";
+
+            out << "const native_handle_t* handle;\n";
+            out << "err = parcel.readNativeHandleNoDup(&handle);\n";
+            out << "if (err != ::android::OK) return err;\n";
+            out << "uint64_t size;\n";
+            out << "err = parcel.readUint64(&size);\n";
+            out << "if (err != ::android::OK) return err;\n";
+            out << "if (handle == nullptr || handle->numFds != 1) return ::android::BAD_VALUE;\n\n";
+
+            out << "// Without F_SEAL_SHRINK, the sender could truncate the region while it\n"
+                << "// is mapped, and reading it would raise SIGBUS. Without F_SEAL_WRITE,\n"
+                << "// it could change the bytes while they are being read.\n";
+            out << "const int fd = handle->data[0];\n";
+            out << "const int seals = fcntl(fd, F_GET_SEALS);\n";
+            out << "constexpr int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_WRITE;\n";
+            out << "struct stat st;\n";
+            out.sIf("seals < 0 || (seals & kRequiredSeals) != kRequiredSeals ||\n"
+                    "    fstat(fd, &st) != 0 || size == 0 || size > UINT32_MAX ||\n"
+                    "    size > static_cast<uint64_t>(st.st_size)",
+                    [&] { out << "return ::android::BAD_VALUE;\n"; })
+                    .endl();
+            out << "void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);\n";
+            out << "if (data == MAP_FAILED) return ::android::NO_MEMORY;\n";
+            out << "mData = data;\n";
+            out << "mSize = size;\n\n";
+
+            out << "mView.setToExternal(static_cast<uint8_t*>(mData), mSize, "
+                << "false /* shouldOwn */);\n";
+            out << "*value = &mView;\n";
+            out << "return ::android::OK;\n";
+        }).endl().endl();
+
+        out << "bool shared() const { return mShared; }\n\n";
+
+        out.unindent();
+        out << "private:\n";
+        out.indent();
+
+        out << "bool mShared = false;\n";
+        out << "void* mData = nullptr;\n";
+        out << "size_t mSize = 0;\n";
+        out << "::android::hardware::hidl_vec<uint8_t> mView;\n";
+    });
+    out << ";\n\n";
+
+    out << "}  // namespace\n\n";
+}
+
+// Whether the interface gets <method>_async overloads, which return
+// _hidl_awaitable.
+static bool hasAwaitableMethods(const Interface* iface) {
+    const auto& methods = iface->allMethodsFromRoot();
+    return std::any_of(methods.begin(), methods.end(),
+                       [](const auto& tuple) { return tuple.method()->hasCppAwaitableOverload(); });
+}
+
+static void emitAwaitableTemplate(Formatter& out) {
+    DocComment(
+            "Awaitable returned by the <method>_async overloads which take no completion. The "
+            "call is posted to the executor when the coroutine suspends, and the coroutine resumes "
+            "on whichever thread completes the call. If the call completes before the coroutine "
+            "has suspended (e.g. with an inline executor), it does not suspend at all.",
+            HIDL_LOCATION_HERE)
+            .emit(out);
+    out << "template <typename R>\n";
+    out << "class _hidl_awaitable {\n";
+    out << "public:\n";
+    out.indent();
+    out << "explicit _hidl_awaitable(std::function<void(std::function<void(R)>)> start)\n";
+    out.indent(2, [&] { out << ": mStart(std::move(start)) {}\n"; });
+    out << "_hidl_awaitable(const _hidl_awaitable&) = delete;\n";
+    out << "_hidl_awaitable& operator=(const _hidl_awaitable&) = delete;\n\n";
+    out << "bool await_ready() const { return false; }\n\n";
+    out << "template <typename Handle>\n";
+    out << "bool await_suspend(Handle handle) ";
+    out.block([&] {
+        out << "mStart([this, handle](R ret) mutable ";
+        out.block([&] {
+            out << "mResult.emplace(std::move(ret));\n";
+            out.sIf("mDone.exchange(true)", [&] { out << "handle.resume();\n"; }).endl();
+        });
+        out << ");\n";
+        out << "return !mDone.exchange(true);\n";
+    }).endl().endl();
+    out << "R await_resume() { return std::move(*mResult); }\n\n";
+    out.unindent();
+    out << "private:\n";
+    out.indent();
+    out << "std::function<void(std::function<void(R)>)> mStart;\n";
+    out << "std::optional<R> mResult;\n";
+    out << "std::atomic<bool> mDone{false};\n";
+    out.unindent();
+    out << "};\n\n";
+}
+
+// Whether a struct defined in the given scope compares or hashes its bytes.
+static bool hasBytewiseStruct(const Type* type) {
+    if (type->isCompoundType()) {
+        const auto* compound = static_cast<const CompoundType*>(type);
+        if (compound->isCppBitwiseComparable() || compound->isCppHashable()) {
+            return true;
+        }
+    }
+    const auto definedTypes = type->getDefinedTypes();
+    return std::any_of(definedTypes.begin(), definedTypes.end(), hasBytewiseStruct);
+}
+
+// Whether the given scope defines a type that gets a hidl_type_info.
+static bool hasTypeInfo(const Type* type) {
+    if (type->isCompoundType() || type->isEnum()) {
+        return true;
+    }
+    const auto definedTypes = type->getDefinedTypes();
+    return std::any_of(definedTypes.begin(), definedTypes.end(), hasTypeInfo);
+}
+
+// Declarations shared by the hidl_type_info specializations of every
+// generated header, guarded so that only the first header defines them.
+static void emitTypeInfoDeclarations(Formatter& out) {
+    out << "#ifndef HIDL_GENERATED_TYPE_INFO\n";
+    out << "#define HIDL_GENERATED_TYPE_INFO\n\n";
+    out << "namespace android {\n";
+    out << "namespace hardware {\n";
+    out << "namespace details {\n\n";
+
+    out << "enum class hidl_type_kind : uint8_t ";
+    out.block([&] {
+        for (const char* kind : {"SCALAR", "ENUM", "BITFIELD", "STRING", "VECTOR", "ARRAY",
+                                 "STRUCT", "UNION", "SAFE_UNION", "HANDLE", "MEMORY",
+                                 "INTERFACE", "FMQ", "POINTER"}) {
+            out << kind << ",\n";
+        }
+    });
+    out << ";\n\n";
+
+    out << "struct hidl_field_info ";
+    out.block([&] {
+        out << "const char* name;\n";
+        out << "// The type as spelled in the .hal file, such as \"vec<uint32_t>\" or\n"
+            << "// \"uint8_t[8]\".\n";
+        out << "const char* type;\n";
+        out << "hidl_type_kind kind;\n";
+        out << "size_t offset;\n";
+        out << "size_t size;\n";
+    });
+    out << ";\n\n";
+
+    out << "template <typename T>\n";
+    out << "struct hidl_enumerator_info ";
+    out.block([&] {
+        out << "T value;\n";
+        out << "const char* name;\n";
+    });
+    out << ";\n\n";
+
+    out << "// Specialized for every generated struct, union, safe_union and enum.\n";
+    out << "template <typename T>\n";
+    out << "struct hidl_type_info;\n\n";
+
+    out << "}  // namespace details\n";
+    out << "}  // namespace hardware\n";
+    out << "}  // namespace android\n\n";
+    out << "#endif  // HIDL_GENERATED_TYPE_INFO\n\n";
+}
+
+static std::vector<const NamedReference<Type>*> getFmqArgs(const Method* method) {
+    std::vector<const NamedReference<Type>*> fmqArgs;
+    for (const auto* args : {&method->args(), &method->results()}) {
+        std::copy_if(args->begin(), args->end(), std::back_inserter(fmqArgs),
+                     [](const auto* arg) { return arg->type().isFmq(); });
+    }
+    return fmqArgs;
+}
+
+static bool hasFmqArgs(const Interface* iface) {
+    const auto& methods = iface->userDefinedMethods();
+    return std::any_of(methods.begin(), methods.end(),
+                       [](const Method* method) { return !getFmqArgs(method).empty(); });
+}
+
+// Typed ends of a fast message queue, aliased by interfaces for each of their
+// fmq_sync and fmq_unsync arguments and results. They are only declared when
+// libfmq is available to the including code, and are guarded so that only the
+// first header defines them.
+static void emitFmqHelperDeclarations(Formatter& out) {
+    out << "#if !defined(HIDL_GENERATED_FMQ_HELPERS) && __has_include(<fmq/MessageQueue.h>)\n";
+    out << "#define HIDL_GENERATED_FMQ_HELPERS\n\n";
+    out << "#include <fmq/EventFlag.h>\n";
+    out << "#include <fmq/MessageQueue.h>\n\n";
+    out << "#include <algorithm>\n";
+    out << "#include <chrono>\n";
+    out << "#include <memory>\n";
+    out << "#include <thread>\n\n";
+    out << "namespace android {\n";
+    out << "namespace hardware {\n";
+    out << "namespace details {\n\n";
+
+    out << "// How a blocking read or write waits for the other end of the queue.\n";
+    out << "struct hidl_fmq_wait_policy ";
+    out.block([&] {
+        out << "// Attempts made before blocking, which avoid a futex wait when the other\n"
+            << "// end keeps up.\n";
+        out << "uint32_t spinCount = 64;\n";
+        out << "// How long to wait for in total, or 0 to wait for as long as it takes.\n";
+        out << "int64_t timeoutNanos = 0;\n";
+    });
+    out << ";\n\n";
+
+    out << "template <typename T, MQFlavor flavor>\n";
+    out << "class hidl_fmq_endpoint ";
+    out.block([&] {
+        out.unindent();
+        out << "public:\n";
+        out.indent();
+
+        out << "using queue_type = MessageQueue<T, flavor>;\n";
+        out << "using descriptor_type = MQDescriptor<T, flavor>;\n\n";
+
+        out << "// Bits of the event flag word. Writers set kNotEmpty after writing, and\n"
+            << "// readers set kNotFull after reading.\n";
+        out << "static constexpr uint32_t kNotEmpty = 1u << 0;\n";
+        out << "static constexpr uint32_t kNotFull = 1u << 1;\n\n";
+
+        out << "bool isValid() const { return mQueue != nullptr && mQueue->isValid(); }\n";
+        out << "queue_type& queue() const { return *mQueue; }\n";
+        out << "const descriptor_type* getDesc() const { return mQueue->getDesc(); }\n\n";
+
+        out.unindent();
+        out << "protected:\n";
+        out.indent();
+
+        out << "hidl_fmq_endpoint(std::shared_ptr<queue_type> queue, hidl_fmq_wait_policy policy)\n";
+        out.indent(2, [&] { out << ": mQueue(std::move(queue)), mPolicy(policy) "; });
+        out.block([&] {
+            out << "EventFlag* eventFlag = nullptr;\n";
+            out.sIf("isValid() && mQueue->getEventFlagWord() != nullptr &&\n"
+                    "    EventFlag::createEventFlag(mQueue->getEventFlagWord(), &eventFlag) == OK",
+                    [&] { out << "mEventFlag.reset(eventFlag);\n"; })
+                    .endl();
+        }).endl().endl();
+
+        out << "void wake(uint32_t bits) ";
+        out.block([&] {
+            out.sIf("mEventFlag != nullptr", [&] { out << "mEventFlag->wake(bits);\n"; }).endl();
+        }).endl().endl();
+
+        out << "// Retries attempt until it succeeds. After the policy's spin count, waits for\n"
+            << "// the other end to set bits in between, or yields if the queue has no event\n"
+            << "// flag word. Returns false if the timeout passes first.\n";
+        out << "template <typename Attempt>\n";
+        out << "bool retry(uint32_t bits, Attempt&& attempt) ";
+        out.block([&] {
+            out << "for (uint32_t i = 0; i <= mPolicy.spinCount; ++i) ";
+            out.block([&] { out << "if (attempt()) return true;\n"; }).endl();
+            out << "const auto deadline = std::chrono::steady_clock::now() +\n";
+            out.indent(2, [&] { out << "std::chrono::nanoseconds(mPolicy.timeoutNanos);\n"; });
+            out << "while (true) ";
+            out.block([&] {
+                out << "int64_t remainingNanos = 0;\n";
+                out.sIf("mPolicy.timeoutNanos > 0", [&] {
+                    out << "remainingNanos = std::chrono::nanoseconds(\n";
+                    out.indent(2, [&] {
+                        out << "deadline - std::chrono::steady_clock::now()).count();\n";
+                    });
+                    out << "if (remainingNanos <= 0) return false;\n";
+                }).endl();
+                out.sIf("mEventFlag != nullptr", [&] {
+                    out << "uint32_t state;\n";
+                    out << "const status_t err = mEventFlag->wait(bits, &state, remainingNanos);\n";
+                    out << "if (err != OK && err != TIMED_OUT) return false;\n";
+                }).sElse([&] {
+                    out << "std::this_thread::yield();\n";
+                }).endl();
+                out << "if (attempt()) return true;\n";
+            }).endl();
+        }).endl().endl();
+
+        out << "struct EventFlagDeleter ";
+        out.block([&] {
+            out << "void operator()(EventFlag* eventFlag) const { "
+                << "EventFlag::deleteEventFlag(&eventFlag); }\n";
+        });
+        out << ";\n\n";
+
+        out << "std::shared_ptr<queue_type> mQueue;\n";
+        out << "hidl_fmq_wait_policy mPolicy;\n";
+        out << "std::unique_ptr<EventFlag, EventFlagDeleter> mEventFlag;\n";
+    });
+    out << ";\n\n";
+
+    // The writer and reader mirror each other.
+    for (const bool writer : {true, false}) {
+        const std::string klass = writer ? "hidl_fmq_writer" : "hidl_fmq_reader";
+        const std::string op = writer ? "write" : "read";
+        const std::string Op = writer ? "Write" : "Read";
+        const std::string ptr = writer ? "const T*" : "T*";
+        const std::string wakes = writer ? "kNotEmpty" : "kNotFull";
+        const std::string waits = writer ? "kNotFull" : "kNotEmpty";
+
+        out << "template <typename T, MQFlavor flavor>\n";
+        out << "class " << klass << " : public hidl_fmq_endpoint<T, flavor> ";
+        out.block([&] {
+            out << "using Base = hidl_fmq_endpoint<T, flavor>;\n\n";
+
+            out.unindent();
+            out << "public:\n";
+            out.indent();
+
+            out << "using typename Base::descriptor_type;\n";
+            out << "using typename Base::queue_type;\n";
+            out << "using MemTransaction = typename queue_type::MemTransaction;\n\n";
+
+            out << "// Uses a queue created in this process, for instance before sending its\n"
+                << "// descriptor to the other end.\n";
+            out << "explicit " << klass << "(std::shared_ptr<queue_type> queue,\n";
+            out.indent(2, [&] {
+                out << "hidl_fmq_wait_policy policy = {})\n";
+                out << ": Base(std::move(queue), policy) {}\n";
+            });
+            out << "// Opens a queue whose descriptor was received from the other end.\n";
+            out << "explicit " << klass << "(const descriptor_type& desc, "
+                << "hidl_fmq_wait_policy policy = {})\n";
+            out.indent(2, [&] {
+                out << ": Base(std::make_shared<queue_type>(desc), policy) {}\n\n";
+            });
+
+            out << "size_t availableTo" << Op << "() const { return this->queue().availableTo"
+                << Op << "(); }\n\n";
+
+            out << "// " << Op << "s all count messages without waiting, or none of them.\n";
+            out << "bool " << op << "(" << ptr << " data, size_t count) ";
+            out.block([&] {
+                out << "if (!this->queue()." << op << "(data, count)) return false;\n";
+                out << "this->wake(Base::" << wakes << ");\n";
+                out << "return true;\n";
+            }).endl().endl();
+
+            if (!writer) {
+                out << "// Reads as many messages as are available, up to count, and returns how\n"
+                    << "// many were read.\n";
+                out << "size_t readSome(T* data, size_t count) ";
+                out.block([&] {
+                    out << "const size_t available = std::min(count, availableToRead());\n";
+                    out << "return available > 0 && read(data, available) ? available : 0;\n";
+                }).endl().endl();
+            }
+
+            out << "// " << Op << "s all count messages, waiting for "
+                << (writer ? "space" : "them") << " as the policy allows. Fails\n"
+                << "// at once if count is more than the queue holds.\n";
+            out << "bool " << op << "Blocking(" << ptr << " data, size_t count) ";
+            out.block([&] {
+                out << "if (count > this->queue().getQuantumCount()) return false;\n";
+                out << "return this->retry(Base::" << waits << ", [&] { return " << op
+                    << "(data, count); });\n";
+            }).endl().endl();
+
+            out << "// " << Op << "s count messages in place: calls " << (writer ? "fill" : "consume")
+                << "(" << ptr << " messages, size_t n) for\n"
+                << "// each contiguous run of slots, then commits them.\n";
+            const std::string fn = writer ? "fill" : "consume";
+            out << "template <typename F>\n";
+            out << "bool " << op << "InPlace(size_t count, F&& " << fn << ") ";
+            out.block([&] {
+                out << "MemTransaction tx;\n";
+                out << "if (!begin" << Op << "(count, &tx)) return false;\n";
+                out << "for (const auto& region : {tx.getFirstRegion(), tx.getSecondRegion()}) ";
+                out.block([&] {
+                    out.sIf("region.getLength() > 0", [&] {
+                        out << fn << "(region.getAddress(), region.getLength());\n";
+                    }).endl();
+                }).endl();
+                out << "return commit" << Op << "(count);\n";
+            }).endl().endl();
+
+            out << "bool begin" << Op << "(size_t count, MemTransaction* tx) const ";
+            out.block([&] { out << "return this->queue().begin" << Op << "(count, tx);\n"; })
+                    .endl()
+                    .endl();
+
+            out << "bool commit" << Op << "(size_t count) ";
+            out.block([&] {
+                out << "if (!this->queue().commit" << Op << "(count)) return false;\n";
+                out << "this->wake(Base::" << wakes << ");\n";
+                out << "return true;\n";
+            }).endl();
+        });
+        out << ";\n\n";
+    }
+
+    out << "}  // namespace details\n";
+    out << "}  // namespace hardware\n";
+    out << "}  // namespace android\n\n";
+    out << "#endif  // HIDL_GENERATED_FMQ_HELPERS\n\n";
+}
+
 void AST::generateInterfaceHeader(Formatter& out) const {
     const Interface *iface = getInterface();
     std::string ifaceName = iface ? iface->definedName() : "types";
@@ -239,6 +1088,21 @@ void AST::generateInterfaceHeader(Formatter& out) const {
         }
     }
 
+    if (iface && hasAwaitableMethods(iface)) {
+        out << "#include <atomic>\n";
+        out << "#include <optional>\n\n";
+    }
+
+    if (hasTypeInfo(&mRootScope)) {
+        out << "#include <array>\n";
+        out << "#include <cstddef>\n\n";
+    }
+
+    if (hasBytewiseStruct(&mRootScope)) {
+        out << "#include <cstring>\n";
+        out << "#include <functional>\n\n";
+    }
+
     out << "#include <hidl/HidlSupport.h>\n";
     out << "#include <hidl/MQDescriptor.h>\n";
 
@@ -249,6 +1113,14 @@ void AST::generateInterfaceHeader(Formatter& out) const {
     out << "#include <utils/NativeHandle.h>\n";
     out << "#include <utils/misc.h>\n\n"; /* for report_sysprop_change() */
 
+    if (hasTypeInfo(&mRootScope)) {
+        emitTypeInfoDeclarations(out);
+    }
+
+    if (iface && hasFmqArgs(iface)) {
+        emitFmqHelperDeclarations(out);
+    }
+
     enterLeaveNamespace(out, true /* enter */);
     out << "\n";
 
@@ -287,6 +1159,10 @@ void AST::generateInterfaceHeader(Formatter& out) const {
     }
 
     if (iface) {
+        if (hasAwaitableMethods(iface)) {
+            emitAwaitableTemplate(out);
+        }
+
         DocComment(
                 "Returns whether this object's implementation is outside of the current process.",
                 HIDL_LOCATION_HERE)
@@ -314,6 +1190,50 @@ void AST::generateInterfaceHeader(Formatter& out) const {
                 out << ")>;\n";
             }
 
+            if (method->hasCppResultsStruct() && tuple.interface() == iface) {
+                DocComment("Results of " + method->name() + ", filled in by " +
+                                   method->getCppResultsMethodName(),
+                           HIDL_LOCATION_HERE)
+                        .emit(out);
+                out << "struct " << method->getCppResultsStructName() << " {\n";
+                out.indent([&] {
+                    for (const auto& result : method->results()) {
+                        out << result->type().getCppStackType(true /* specify namespaces */)
+                            << " " << result->name() << ";\n";
+                    }
+                });
+                out << "};\n\n";
+            }
+
+            if (method->hasCppAsyncOverload() && tuple.interface() == iface) {
+                DocComment("Completion for " + method->name() + "_async", HIDL_LOCATION_HERE)
+                        .emit(out);
+                out << "using " << method->name()
+                    << "_async_cb = " << method->getCppAsyncCallbackType() << ";\n\n";
+            }
+
+            const auto fmqArgs = getFmqArgs(method);
+            if (!fmqArgs.empty() && tuple.interface() == iface) {
+                out << "#ifdef HIDL_GENERATED_FMQ_HELPERS\n";
+                for (const auto* arg : fmqArgs) {
+                    const auto& fmq = static_cast<const FmqType&>(arg->type());
+                    const std::string params =
+                            "<" + fmq.getElementType()->getCppStackType(true /* specify namespaces */) +
+                            ", " + fmq.getCppFlavor() + ">";
+                    DocComment("Ends of the queue passed as " + arg->name() + " of " +
+                                       method->name(),
+                               HIDL_LOCATION_HERE)
+                            .emit(out);
+                    out << "using " << method->name() << "_" << arg->name()
+                        << "_writer = ::android::hardware::details::hidl_fmq_writer" << params
+                        << ";\n";
+                    out << "using " << method->name() << "_" << arg->name()
+                        << "_reader = ::android::hardware::details::hidl_fmq_reader" << params
+                        << ";\n";
+                }
+                out << "#endif  // HIDL_GENERATED_FMQ_HELPERS\n\n";
+            }
+
             method->emitDocComment(out);
 
             if (elidedReturn) {
@@ -335,6 +1255,70 @@ void AST::generateInterfaceHeader(Formatter& out) const {
                 out << " = 0";
             }
             out << ";\n";
+
+            if (method->hasCppResultsStruct()) {
+                DocComment("Same as " + method->name() +
+                                   ", but stores the results in _hidl_results instead of invoking "
+                                   "a callback. Replies from remote objects are read directly into "
+                                   "_hidl_results. Not virtual, so it does not change the layout "
+                                   "of the interface.",
+                           HIDL_LOCATION_HERE)
+                        .emit(out);
+                out << "::android::hardware::Return<void> " << method->getCppResultsMethodName()
+                    << "(";
+                method->emitCppResultsStructArgSignature(out, true /* specify namespaces */);
+                out << ");\n";
+            }
+
+            if (method->hasCppAsyncOverload()) {
+                DocComment("Posts a call to " + method->name() +
+                                   " onto _hidl_executor and returns immediately. _hidl_done is "
+                                   "invoked on the executor with the outcome of the call. "
+                                   "Arguments are copied, so they do not need to outlive this call. "
+                                   "This offloads the blocking call rather than pipelining it: the "
+                                   "executor thread running it waits for the reply, so each "
+                                   "outstanding call holds one thread.",
+                           HIDL_LOCATION_HERE)
+                        .emit(out);
+                out << "void " << method->name() << "_async(";
+                method->emitCppAsyncArgSignature(out, true /* specify namespaces */);
+                out << ");\n";
+            }
+
+            if (method->hasCppAwaitableOverload()) {
+                DocComment("Coroutine form of " + method->name() +
+                                   "_async: co_await the result to get the Return<> of the call.",
+                           HIDL_LOCATION_HERE)
+                        .emit(out);
+                out << "_hidl_awaitable<" << method->getCppAwaitResultType() << "> "
+                    << method->name() << "_async(";
+                method->emitCppAwaitableArgSignature(out, true /* specify namespaces */);
+                out << ");\n";
+            }
+
+            if (method->hasCppMoveOverload()) {
+                if (tuple.interface() == iface) {
+                    DocComment("Same as " + method->name() +
+                                       ", but takes ownership of the arguments passed as "
+                                       "rvalues, so that same-process implementations can keep "
+                                       "them without a copy. By default, forwards to " +
+                                       method->name() + ".",
+                               HIDL_LOCATION_HERE)
+                            .emit(out);
+                    out << "virtual ";
+                    method->generateCppReturnType(out);
+                    out << method->getCppMoveMethodName() << "(";
+                    method->emitCppMoveArgSignature(out, true /* specify namespaces */);
+                    out << ");\n";
+                }
+
+                DocComment("Calls " + method->getCppMoveMethodName() + ".", HIDL_LOCATION_HERE)
+                        .emit(out);
+                method->generateCppReturnType(out);
+                out << method->name() << "(";
+                method->emitCppMoveArgSignature(out, true /* specify namespaces */);
+                out << ");\n";
+            }
         }
 
         out << "\n// cast static functions\n";
@@ -436,11 +1420,12 @@ static std::string wrapPassthroughArg(Formatter& out, const NamedReference<Type>
     std::string wrappedName = "_hidl_wrapped_" + name;
     const Interface &iface = static_cast<const Interface &>(arg->type());
     out << iface.getCppStackType() << " " << wrappedName << ";\n";
-    // TODO(elsk): b/33754152 Should not wrap this if object is Bs*
+    // Wrappers are shared through _hidl_wrapPassthrough, which also passes back
+    // Bs* objects that it created itself (b/33754152).
     out.sIf(name + " != nullptr && !" + name + "->isRemote()", [&] {
         out << wrappedName
             << " = "
-            << "::android::hardware::details::wrapPassthrough("
+            << "_hidl_wrapPassthrough("
             << name
             << ");\n";
         out.sIf(wrappedName + " == nullptr", [&] {
@@ -455,8 +1440,63 @@ static std::string wrapPassthroughArg(Formatter& out, const NamedReference<Type>
     return wrappedName;
 }
 
-void AST::generatePassthroughMethod(Formatter& out, const Method* method, const Interface* superInterface) const {
-    method->generateCppSignature(out);
+// Whether a method of iface itself takes or returns a vec of interfaces.
+static bool hasVectorOfBinders(const Interface* iface) {
+    for (const Method* method : iface->userDefinedMethods()) {
+        for (const auto* args : {&method->args(), &method->results()}) {
+            if (std::any_of(args->begin(), args->end(), [](const auto* arg) {
+                    return arg->type().isVector() &&
+                           static_cast<const VectorType&>(arg->type()).isVectorOfBinders();
+                })) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Whether Bs* needs to wrap interface arguments or results of user methods.
+static bool hasPassthroughInterfaceArguments(const Interface* iface) {
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        const Method* method = tuple.method();
+        if (method->isHidlReserved()) continue;
+
+        for (const auto* args : {&method->args(), &method->results()}) {
+            if (std::any_of(args->begin(), args->end(),
+                            [](const auto* arg) { return arg->type().isInterface(); })) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Whether Bs* queues oneway calls that hold moved arguments in a shared_ptr.
+static bool hasPassthroughMovedOnewayArguments(const Interface* iface) {
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        if (tuple.method()->isOneway() && tuple.method()->hasCppMoveOverload()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether Bs* runs oneway calls on its own queues rather than on a TaskRunner.
+static bool hasPassthroughOnewayPool(const Interface* iface) {
+    return iface->getPassthroughOnewayAnnotation() != nullptr &&
+           iface->getPassthroughOnewayMode() != "inline";
+}
+
+void AST::generatePassthroughMethod(Formatter& out, const Method* method, const Interface* superInterface,
+                                    bool moveArgs) const {
+    if (moveArgs) {
+        method->generateCppReturnType(out);
+        out << method->getCppMoveMethodName() << "(";
+        method->emitCppMoveArgSignature(out);
+        out << ")";
+    } else {
+        method->generateCppSignature(out);
+    }
 
     out << " override {\n";
     out.indent();
@@ -491,27 +1531,54 @@ void AST::generatePassthroughMethod(Formatter& out, const Method* method, const
         wrappedArgNames.push_back(name);
     }
 
+    const Interface* iface = mRootScope.getInterface();
+    const bool hasOnewayPool = hasPassthroughOnewayPool(iface);
+    const bool queued = method->isOneway() && !method->isPassthroughOnewayInline() &&
+                        (hasOnewayPool || iface->getPassthroughOnewayAnnotation() == nullptr);
+
     out << "::android::hardware::Status _hidl_error = ::android::hardware::Status::ok();\n";
     out << "auto _hidl_return = ";
 
-    if (method->isOneway()) {
-        out << "addOnewayTask([mImpl = this->mImpl\n"
+    if (queued) {
+        out << "addOnewayTask(";
+        if (hasOnewayPool) {
+            const NamedReference<Type>* key = method->getPassthroughOnewayKey();
+            if (key != nullptr) {
+                out << "static_cast<size_t>(" << key->name() << "), ";
+            } else {
+                out << method->getSerialId() << " /* " << method->name() << " */, ";
+            }
+        }
+        out << "[mImpl = this->mImpl\n"
             << "#ifdef __ANDROID_DEBUGGABLE__\n"
                ", mEnableInstrumentation = this->mEnableInstrumentation, "
                "mInstrumentationCallbacks = this->mInstrumentationCallbacks\n"
             << "#endif // __ANDROID_DEBUGGABLE__\n";
-        for (const std::string& arg : wrappedArgNames) {
-            out << ", " << arg;
+        // TaskRunner copies the task, so moved arguments are held by a shared_ptr
+        // that every copy shares rather than by value.
+        for (size_t i = 0; i < wrappedArgNames.size(); i++) {
+            const std::string& arg = wrappedArgNames[i];
+            if (moveArgs && Method::isCppMovableArg(method->args()[i])) {
+                out << ", " << arg << " = std::make_shared<"
+                    << method->args()[i]->type().getCppStackType() << ">(std::move(" << arg
+                    << "))";
+            } else {
+                out << ", " << arg;
+            }
         }
         out << "] {\n";
         out.indent();
     }
 
     out << "mImpl->"
-        << method->name()
+        << (moveArgs ? method->getCppMoveMethodName() : method->name())
         << "(";
 
     out.join(method->args().begin(), method->args().end(), ", ", [&](const auto &arg) {
+        if (moveArgs && Method::isCppMovableArg(arg)) {
+            out << "std::move(" << (queued ? "*" : "") << arg->name() << ")";
+            return;
+        }
         out << (arg->type().isInterface() ? "_hidl_wrapped_" : "") << arg->name();
     });
 
@@ -583,7 +1650,7 @@ void AST::generatePassthroughMethod(Formatter& out, const Method* method, const
                 superInterface);
     }
 
-    if (method->isOneway()) {
+    if (queued) {
         out.unindent();
         out << "});\n";
     } else {
@@ -716,6 +1783,29 @@ void AST::generateStubHeader(Formatter& out) const {
                                    })
                             .endl()
                             .endl();
+
+                        if (method->isBatched()) {
+                            out << "static ::android::status_t _hidl_" << method->name()
+                                << "_batch(\n";
+                            out.indent(2, [&] {
+                                   out << "::android::hidl::base::V1_0::BnHwBase* _hidl_this,\n"
+                                       << "const ::android::hardware::Parcel &_hidl_data,\n"
+                                       << "::android::hardware::Parcel *_hidl_reply,\n"
+                                       << "TransactCallback _hidl_cb);\n";
+                               }).endl().endl();
+                        }
+
+                        const CallEncoding encoding = getCallEncoding(method);
+                        if (encoding != CallEncoding::CLASSIC) {
+                            out << "static ::android::status_t _hidl_" << method->name()
+                                << getCallEncodingSuffix(encoding) << "(\n";
+                            out.indent(2, [&] {
+                                   out << "::android::hidl::base::V1_0::BnHwBase* _hidl_this,\n"
+                                       << "const ::android::hardware::Parcel &_hidl_data,\n"
+                                       << "::android::hardware::Parcel *_hidl_reply,\n"
+                                       << "TransactCallback _hidl_cb);\n";
+                               }).endl().endl();
+                        }
                     },
                     false /* include parents */);
 
@@ -761,6 +1851,18 @@ void AST::generateProxyHeader(Formatter& out) const {
     out << "#ifndef " << guard << "\n";
     out << "#define " << guard << "\n\n";
 
+    const bool batched = hasBatchedMethods(iface);
+    const bool encoded = hasEncodedMethods(iface);
+
+    if (batched) {
+        out << "#include <chrono>\n";
+        out << "#include <condition_variable>\n";
+        out << "#include <map>\n";
+        out << "#include <memory>\n\n";
+    } else if (encoded) {
+        out << "#include <map>\n\n";
+    }
+
     out << "#include <hidl/HidlTransportSupport.h>\n\n";
 
     generateCppPackageInclude(out, mPackage, iface->getHwName());
@@ -807,6 +1909,26 @@ void AST::generateProxyHeader(Formatter& out) const {
             }
             method->emitCppArgSignature(out);
             out << ");\n";
+
+            if (hasDirectResultsPath(iface, method)) {
+                out << "static ";
+                method->generateCppReturnType(out);
+                out << " _hidl_" << method->name() << "("
+                    << "::android::hardware::IInterface* _hidl_this, ";
+                method->emitCppResultsStructArgSignature(out);
+                out << ");\n";
+            }
+
+            const CallEncoding encoding = getCallEncoding(method);
+            if (encoding != CallEncoding::CLASSIC) {
+                out << "static ";
+                method->generateCppReturnType(out);
+                out << " _hidl_" << method->name() << getCallEncodingSuffix(encoding) << "("
+                    << "::android::hardware::IInterface* _hidl_this, "
+                    << "::android::hardware::details::HidlInstrumentor *_hidl_this_instrumentor, ";
+                method->emitCppArgSignature(out);
+                out << ");\n";
+            }
         },
         false /* include parents */);
 
@@ -821,6 +1943,43 @@ void AST::generateProxyHeader(Formatter& out) const {
     out << "std::mutex _hidl_mMutex;\n"
         << "std::vector<::android::sp<::android::hardware::hidl_binder_death_recipient>>"
         << " _hidl_mDeathRecipients;\n";
+
+    if (batched) {
+        out << "\n";
+        out << "// Calls to @batch methods are appended to _hidl_mBatchData until the batch\n"
+            << "// is full, its flush deadline passes, or another method is called.\n";
+        out << "void _hidl_flushBatch();\n";
+        out << "void _hidl_flushBatchLocked(std::unique_lock<std::mutex>& _hidl_lock);\n";
+        out << "void _hidl_flushExpiredBatch();\n";
+        out << "bool _hidl_batchSupportedLocked(std::unique_lock<std::mutex>& _hidl_lock, "
+            << "uint32_t _hidl_code, const char* _hidl_descriptor);\n";
+        out << "::android::status_t _hidl_beginBatchLocked(uint32_t _hidl_code, "
+            << "const char* _hidl_descriptor, uint32_t _hidl_flushUs);\n\n";
+        out << "std::mutex _hidl_mBatchMutex;\n";
+        out << "std::unique_ptr<::android::hardware::Parcel> _hidl_mBatchData;\n";
+        out << "// Copies of the arguments whose buffers _hidl_mBatchData points at.\n";
+        out << "std::vector<std::shared_ptr<void>> _hidl_mBatchArgs;\n";
+        out << "uint32_t _hidl_mBatchCode = 0;  // 0 if nothing is queued\n";
+        out << "size_t _hidl_mBatchCountPosition = 0;\n";
+        out << "uint32_t _hidl_mBatchCount = 0;\n";
+        out << "std::chrono::steady_clock::time_point _hidl_mBatchDeadline;\n";
+        out << "// Batches are sent without _hidl_mBatchMutex held, in the order their\n"
+            << "// flushes took a ticket.\n";
+        out << "std::condition_variable _hidl_mBatchSent;\n";
+        out << "uint64_t _hidl_mBatchNextTicket = 0;\n";
+        out << "uint64_t _hidl_mBatchSentTicket = 0;\n";
+        out << "// Whether the remote end understands each batch transaction code.\n";
+        out << "std::map<uint32_t, bool> _hidl_mBatchSupported;\n";
+    }
+
+    if (encoded) {
+        out << "\n";
+        out << "bool _hidl_encodingSupported(uint32_t _hidl_code, const char* _hidl_descriptor);\n\n";
+        out << "std::mutex _hidl_mEncodingMutex;\n";
+        out << "// Whether the remote end understands each @flatten or @shm transaction code.\n";
+        out << "std::map<uint32_t, bool> _hidl_mEncodingSupported;\n";
+    }
+
     out.unindent();
     out << "};\n\n";
 
@@ -842,6 +2001,27 @@ void AST::generateCppSource(Formatter& out) const {
     out << "#include <log/log.h>\n";
     out << "#include <cutils/trace.h>\n";
     out << "#include <hidl/HidlTransportSupport.h>\n\n";
+    if (iface && hasVectorOfBinders(iface)) {
+        out << "#include <unordered_map>\n\n";
+    }
+    if (iface && hasBatchedMethods(iface)) {
+        out << "#include <functional>\n";
+        out << "#include <thread>\n\n";
+    }
+    if (iface && definesFlattenedMethods(iface)) {
+        out << "#include <cstring>\n";
+        out << "#include <type_traits>\n";
+        out << "#include <vector>\n\n";
+    }
+    if (iface && definesShmMethods(iface)) {
+        out << "#include <fcntl.h>\n";
+        out << "#include <linux/memfd.h>\n";
+        out << "#include <sys/mman.h>\n";
+        out << "#include <sys/stat.h>\n";
+        out << "#include <sys/syscall.h>\n";
+        out << "#include <unistd.h>\n\n";
+        out << "#include <cstring>\n\n";
+    }
     out << "#include <hidl/Static.h>\n";
     out << "#include <hwbinder/ProcessState.h>\n";
     out << "#include <utils/Trace.h>\n";
@@ -915,6 +2095,13 @@ void AST::generateCppSource(Formatter& out) const {
         });
         out << "}\n\n";
 
+        if (definesFlattenedMethods(iface)) {
+            emitFlatCodec(out);
+        }
+        if (definesShmMethods(iface)) {
+            emitShmSupport(out);
+        }
+
         generateInterfaceSource(out);
         generateProxySource(out, iface->fqName());
         generateStubSource(out, iface);
@@ -986,9 +2173,41 @@ void AST::generateProxyMethodSource(Formatter& out, const std::string& klassName
     }
 
     out.block([&] {
+        if (method->isBatched()) {
+            generateProxyBatchMethodSource(out, method, superInterface);
+            return;
+        }
+
+        if (hasBatchedMethods(mRootScope.getInterface())) {
+            // Keep calls ordered after any batched calls which are still queued.
+            out << "_hidl_flushBatch();\n\n";
+        }
+
         const bool returnsValue = !method->results().empty();
         const NamedReference<Type>* elidedReturn = method->canElideCallback();
 
+        const CallEncoding encoding = getCallEncoding(method);
+        if (encoding != CallEncoding::CLASSIC) {
+            const size_t code = getCallEncodingSerialId(method, encoding);
+            out.sIf("_hidl_encodingSupported(" + std::to_string(code) + " /* " +
+                            getCallEncodingComment(method, encoding) + " */, " +
+                            superInterface->fqName().cppName() + "::descriptor)",
+                    [&] {
+                        out << "return " << superInterface->fqName().cppNamespace() << "::"
+                            << superInterface->getProxyName() << "::_hidl_" << method->name()
+                            << getCallEncodingSuffix(encoding) << "(this, this";
+                        for (const auto& arg : method->args()) {
+                            out << ", " << arg->name();
+                        }
+                        if (returnsValue && elidedReturn == nullptr) {
+                            out << ", _hidl_cb";
+                        }
+                        out << ");\n";
+                    })
+                    .endl()
+                    .endl();
+        }
+
         method->generateCppReturnType(out);
 
         out << " _hidl_out = "
@@ -1021,45 +2240,61 @@ void AST::generateProxyMethodSource(Formatter& out, const std::string& klassName
 }
 
 void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& klassName,
-                                          const Method* method, const Interface* superInterface) const {
+                                          const Method* method, const Interface* superInterface,
+                                          bool toResultsStruct, CallEncoding encoding) const {
     if (method->isHidlReserved() && method->overridesCppImpl(IMPL_PROXY)) {
         return;
     }
 
+    CHECK(!toResultsStruct || method->hasCppResultsStruct());
+
+    const bool flat = encoding == CallEncoding::FLATTEN;
+    const NamedReference<Type>* shmArg =
+            encoding == CallEncoding::SHM ? method->getShmArg() : nullptr;
+
     method->generateCppReturnType(out);
 
     out << klassName
         << "::_hidl_"
         << method->name()
+        << getCallEncodingSuffix(encoding)
         << "("
-        << "::android::hardware::IInterface *_hidl_this, "
-        << "::android::hardware::details::HidlInstrumentor *_hidl_this_instrumentor";
+        << "::android::hardware::IInterface *_hidl_this";
 
-    if (!method->hasEmptyCppArgSignature()) {
+    if (toResultsStruct) {
         out << ", ";
+        method->emitCppResultsStructArgSignature(out);
+    } else {
+        out << ", ::android::hardware::details::HidlInstrumentor *_hidl_this_instrumentor";
+        if (!method->hasEmptyCppArgSignature()) {
+            out << ", ";
+        }
+        method->emitCppArgSignature(out);
     }
-
-    method->emitCppArgSignature(out);
     out << ") {\n";
 
     out.indent();
 
-    out << "#ifdef __ANDROID_DEBUGGABLE__\n";
-    out << "bool mEnableInstrumentation = _hidl_this_instrumentor->isInstrumentationEnabled();\n";
-    out << "const auto &mInstrumentationCallbacks = _hidl_this_instrumentor->getInstrumentationCallbacks();\n";
-    out << "#else\n";
-    out << "(void) _hidl_this_instrumentor;\n";
-    out << "#endif // __ANDROID_DEBUGGABLE__\n";
+    // The results overload has no instrumentor to report to.
+    const bool instrumented = !toResultsStruct;
+    if (instrumented) {
+        out << "#ifdef __ANDROID_DEBUGGABLE__\n";
+        out << "bool mEnableInstrumentation = _hidl_this_instrumentor->isInstrumentationEnabled();\n";
+        out << "const auto &mInstrumentationCallbacks = _hidl_this_instrumentor->getInstrumentationCallbacks();\n";
+        out << "#else\n";
+        out << "(void) _hidl_this_instrumentor;\n";
+        out << "#endif // __ANDROID_DEBUGGABLE__\n";
+    }
 
     const bool returnsValue = !method->results().empty();
     const NamedReference<Type>* elidedReturn = method->canElideCallback();
-    const bool hasCallback = returnsValue && elidedReturn == nullptr;
+    // The results overload reads the reply after transact returns.
+    const bool hasCallback = returnsValue && elidedReturn == nullptr && !toResultsStruct;
 
-    generateCppInstrumentationCall(
-            out,
-            InstrumentationEvent::CLIENT_API_ENTRY,
-            method,
-            superInterface);
+    if (instrumented) {
+        generateCppInstrumentationCall(out, InstrumentationEvent::CLIENT_API_ENTRY, method,
+                                       superInterface);
+    }
 
     out << "::android::hardware::Parcel _hidl_data;\n";
     out << "::android::hardware::Parcel _hidl_reply;\n";
@@ -1067,9 +2302,19 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
     out << "::android::status_t _hidl_transact_err;\n";
     out << "::android::hardware::Status _hidl_status;\n\n";
 
+    if (flat) {
+        out << "_hidl_FlatWriter _hidl_flat_writer;\n\n";
+    }
+    if (shmArg != nullptr) {
+        out << "_hidl_ShmSend _hidl_shm_" << shmArg->name() << ";\n\n";
+    }
+
     if (!hasCallback) {
         declareCppReaderLocals(
                 out, method->results(), true /* forResults */);
+        if (flat) {
+            declareCppFlatLocals(out, method->results(), "_hidl_out_");
+        }
     }
 
     out << "_hidl_err = _hidl_data.writeInterfaceToken(";
@@ -1077,12 +2322,31 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
     out << "::descriptor);\n";
     out << "if (_hidl_err != ::android::OK) { goto _hidl_error; }\n\n";
 
+    if (encoding != CallEncoding::CLASSIC) {
+        out << "_hidl_err = _hidl_data.writeUint32(1 /* call */);\n";
+        Type::handleError(out, Type::ErrorMode_Goto);
+    }
+
     bool hasInterfaceArgument = false;
 
     for (const auto &arg : method->args()) {
         if (arg->type().isInterface()) {
             hasInterfaceArgument = true;
         }
+        if (flat && Method::isCppFlattenedArg(arg)) {
+            continue;
+        }
+        if (arg == shmArg) {
+            out << "_hidl_err = _hidl_shm_" << arg->name() << ".write(&_hidl_data, "
+                << arg->name() << ", " << method->getShmThreshold() << " /* threshold */);\n";
+            Type::handleError(out, Type::ErrorMode_Goto);
+            out.sIf("!_hidl_shm_" + arg->name() + ".shared()", [&] {
+                emitCppReaderWriter(out, "_hidl_data", false /* parcelObjIsPointer */, arg,
+                                    false /* reader */, Type::ErrorMode_Goto,
+                                    false /* addPrefixToName */);
+            }).endl().endl();
+            continue;
+        }
         emitCppReaderWriter(
                 out,
                 "_hidl_data",
@@ -1093,14 +2357,22 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
                 false /* addPrefixToName */);
     }
 
+    if (flat && hasFlattenedArgs(method->args())) {
+        emitCppFlatWriter(out, "_hidl_data", false /* parcelObjIsPointer */, method->args(), "");
+    }
+
     if (hasInterfaceArgument) {
-        // Start binder threadpool to handle incoming transactions
-        out << "::android::hardware::ProcessState::self()->startThreadPool();\n";
+        // Start binder threadpool to handle incoming transactions. A local
+        // binder, such as a loopback, hands the transaction over in this
+        // thread, and callbacks resolve to local objects.
+        out.sIf("::android::hardware::IInterface::asBinder(_hidl_this)->localBinder() == nullptr",
+                [&] { out << "::android::hardware::ProcessState::self()->startThreadPool();\n"; })
+                .endl();
     }
     out << "_hidl_transact_err = ::android::hardware::IInterface::asBinder(_hidl_this)->transact("
-        << method->getSerialId()
+        << getCallEncodingSerialId(method, encoding)
         << " /* "
-        << method->name()
+        << getCallEncodingComment(method, encoding)
         << " */, _hidl_data, &_hidl_reply";
 
     if (method->isOneway()) {
@@ -1114,6 +2386,9 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
         out.indent();
         declareCppReaderLocals(
                 out, method->results(), true /* forResults */);
+        if (flat) {
+            declareCppFlatLocals(out, method->results(), "_hidl_out_");
+        }
         out.endl();
     } else {
         out << ");\n";
@@ -1137,6 +2412,9 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
         }
 
         for (const auto &arg : method->results()) {
+            if (flat && Method::isCppFlattenedArg(arg)) {
+                continue;
+            }
             emitCppReaderWriter(
                     out,
                     "_hidl_reply",
@@ -1147,7 +2425,19 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
                     true /* addPrefixToName */);
         }
 
-        if (returnsValue && elidedReturn == nullptr) {
+        if (flat && hasFlattenedArgs(method->results())) {
+            emitCppFlatReader(out, "_hidl_reply", false /* parcelObjIsPointer */,
+                              method->results(), "_hidl_out_", errorMode);
+        }
+
+        if (toResultsStruct) {
+            for (const auto& arg : method->results()) {
+                out << "_hidl_results." << arg->name() << " = "
+                    << (arg->type().resultNeedsDeref() ? "*" : "") << "_hidl_out_" << arg->name()
+                    << ";\n";
+            }
+            out << "\n";
+        } else if (returnsValue && elidedReturn == nullptr) {
             out << "_hidl_cb(";
 
             out.join(method->results().begin(), method->results().end(), ", ", [&] (const auto &arg) {
@@ -1161,11 +2451,10 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
         }
     }
 
-    generateCppInstrumentationCall(
-            out,
-            InstrumentationEvent::CLIENT_API_EXIT,
-            method,
-            superInterface);
+    if (instrumented) {
+        generateCppInstrumentationCall(out, InstrumentationEvent::CLIENT_API_EXIT, method,
+                                       superInterface);
+    }
 
     if (hasCallback) {
         out.unindent();
@@ -1204,6 +2493,7 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
 
 void AST::generateProxySource(Formatter& out, const FQName& fqName) const {
     const std::string klassName = fqName.getInterfaceProxyName();
+    const bool batched = hasBatchedMethods(mRootScope.getInterface());
 
     out << klassName
         << "::"
@@ -1236,18 +2526,367 @@ void AST::generateProxySource(Formatter& out, const FQName& fqName) const {
             out << "_hidl_mDeathRecipients.clear();\n";
         }).endl().endl();
 
+        if (batched) {
+            // Send whatever is still queued while remote() is still valid.
+            out << "_hidl_flushBatch();\n\n";
+        }
+
         out << "BpInterface<" << fqName.getInterfaceName() << ">::onLastStrongRef(id);\n";
     }).endl();
 
+    if (batched) {
+        generateProxyBatchSource(out, klassName);
+    }
+
+    if (hasEncodedMethods(mRootScope.getInterface())) {
+        generateProxyEncodingSource(out, klassName);
+    }
+
     generateMethods(out,
                     [&](const Method* method, const Interface* superInterface) {
                         generateStaticProxyMethodSource(out, klassName, method, superInterface);
+                        if (hasDirectResultsPath(mRootScope.getInterface(), method)) {
+                            generateStaticProxyMethodSource(out, klassName, method, superInterface,
+                                                            true /* toResultsStruct */);
+                        }
+                        const CallEncoding encoding = getCallEncoding(method);
+                        if (encoding != CallEncoding::CLASSIC) {
+                            generateStaticProxyMethodSource(out, klassName, method, superInterface,
+                                                            false /* toResultsStruct */, encoding);
+                        }
                     },
                     false /* include parents */);
 
-    generateMethods(out, [&](const Method* method, const Interface* superInterface) {
-        generateProxyMethodSource(out, klassName, method, superInterface);
-    });
+    generateMethods(out, [&](const Method* method, const Interface* superInterface) {
+        generateProxyMethodSource(out, klassName, method, superInterface);
+    });
+}
+
+void AST::generateProxyBatchSource(Formatter& out, const std::string& klassName) const {
+    out << "namespace {\n\n";
+    out << "// Flushes the batches of every " << klassName << " whose deadline has passed.\n"
+        << "// One thread serves all of them, and it only holds weak references.\n";
+    out << "class _hidl_BatchTimer ";
+    out.block([&] {
+        out.unindent();
+        out << "public:\n";
+        out.indent();
+        out << "static _hidl_BatchTimer& get() ";
+        out.block([&] {
+            out << "// Never destroyed, since its thread runs until the process exits.\n";
+            out << "static _hidl_BatchTimer* _hidl_timer = new _hidl_BatchTimer();\n";
+            out << "return *_hidl_timer;\n";
+        }).endl().endl();
+
+        out << "void schedule(std::chrono::steady_clock::time_point _hidl_deadline, "
+            << "std::function<void()> _hidl_flush) ";
+        out.block([&] {
+            out << "std::unique_lock<std::mutex> _hidl_lock(mMutex);\n";
+            out << "mPending.emplace(_hidl_deadline, std::move(_hidl_flush));\n";
+            out.sIf("!mStarted", [&] {
+                out << "mStarted = true;\n";
+                out << "std::thread([this] { run(); }).detach();\n";
+            }).endl();
+            out << "mCondition.notify_one();\n";
+        }).endl().endl();
+
+        out.unindent();
+        out << "private:\n";
+        out.indent();
+        out << "void run() ";
+        out.block([&] {
+            out << "std::unique_lock<std::mutex> _hidl_lock(mMutex);\n";
+            out << "for (;;) ";
+            out.block([&] {
+                out.sIf("mPending.empty()", [&] {
+                    out << "mCondition.wait(_hidl_lock);\n";
+                    out << "continue;\n";
+                }).endl();
+                out << "auto _hidl_it = mPending.begin();\n";
+                out.sIf("std::chrono::steady_clock::now() < _hidl_it->first", [&] {
+                    out << "mCondition.wait_until(_hidl_lock, _hidl_it->first);\n";
+                    out << "continue;\n";
+                }).endl();
+                out << "std::function<void()> _hidl_flush = std::move(_hidl_it->second);\n";
+                out << "mPending.erase(_hidl_it);\n";
+                out << "_hidl_lock.unlock();\n";
+                out << "_hidl_flush();\n";
+                out << "_hidl_lock.lock();\n";
+            }).endl();
+        }).endl().endl();
+
+        out << "std::mutex mMutex;\n";
+        out << "std::condition_variable mCondition;\n";
+        out << "std::multimap<std::chrono::steady_clock::time_point, std::function<void()>> "
+            << "mPending;\n";
+        out << "bool mStarted = false;\n";
+    });
+    out << ";\n\n";
+    out << "}  // namespace\n\n";
+
+    out << "void " << klassName << "::_hidl_flushBatch() ";
+    out.block([&] {
+        out << "std::unique_lock<std::mutex> _hidl_lock(_hidl_mBatchMutex);\n";
+        out << "_hidl_flushBatchLocked(_hidl_lock);\n";
+    }).endl().endl();
+
+    out << "void " << klassName
+        << "::_hidl_flushBatchLocked(std::unique_lock<std::mutex>& _hidl_lock) ";
+    out.block([&] {
+        out << "// Take the queued calls, if any, then wait for earlier flushes to be sent.\n"
+            << "// A flush with nothing to send still waits, so callers return knowing that\n"
+            << "// every batch queued before them has been handed to the driver.\n";
+        out << "std::unique_ptr<::android::hardware::Parcel> _hidl_data = "
+            << "std::move(_hidl_mBatchData);\n";
+        out << "// Kept until the transaction has been sent.\n";
+        out << "std::vector<std::shared_ptr<void>> _hidl_args = std::move(_hidl_mBatchArgs);\n";
+        out << "_hidl_mBatchArgs.clear();\n";
+        out << "const uint32_t _hidl_code = _hidl_mBatchCode;\n";
+        out << "const uint32_t _hidl_count = _hidl_mBatchCount;\n";
+        out << "const size_t _hidl_countPosition = _hidl_mBatchCountPosition;\n";
+        out << "_hidl_mBatchCode = 0;\n";
+        out << "_hidl_mBatchCount = 0;\n\n";
+
+        out << "const uint64_t _hidl_ticket = _hidl_mBatchNextTicket++;\n";
+        out << "_hidl_mBatchSent.wait(_hidl_lock, [&] { return _hidl_mBatchSentTicket == "
+            << "_hidl_ticket; });\n\n";
+
+        out.sIf("_hidl_code != 0", [&] {
+            out << "_hidl_lock.unlock();\n";
+            out << "::android::hardware::Parcel _hidl_reply;\n";
+            out << "const size_t _hidl_end = _hidl_data->dataPosition();\n";
+            out << "_hidl_data->setDataPosition(_hidl_countPosition);\n";
+            out << "::android::status_t _hidl_err = _hidl_data->writeUint32(_hidl_count);\n";
+            out << "_hidl_data->setDataPosition(_hidl_end);\n";
+            out.sIf("_hidl_err == ::android::OK", [&] {
+                out << "_hidl_err = remote()->transact(_hidl_code, *_hidl_data, &_hidl_reply, "
+                    << Interface::FLAG_ONE_WAY->cppValue() << ");\n";
+            }).endl();
+            out.sIf("_hidl_err != ::android::OK", [&] {
+                out << "ALOGE(\"Dropped %u batched calls (transaction %u): %d\", _hidl_count,\n";
+                out.indent(2, [&] { out << "_hidl_code, _hidl_err);\n"; });
+            }).endl();
+            out << "_hidl_lock.lock();\n";
+        }).endl().endl();
+
+        out << "_hidl_mBatchSentTicket++;\n";
+        out << "_hidl_mBatchSent.notify_all();\n";
+    }).endl().endl();
+
+    out << "void " << klassName << "::_hidl_flushExpiredBatch() ";
+    out.block([&] {
+        out << "std::unique_lock<std::mutex> _hidl_lock(_hidl_mBatchMutex);\n";
+        out << "// The batch this was scheduled for may already be gone, and a newer one\n"
+            << "// has its own deadline.\n";
+        out.sIf("_hidl_mBatchCode != 0 && std::chrono::steady_clock::now() >= "
+                "_hidl_mBatchDeadline",
+                [&] { out << "_hidl_flushBatchLocked(_hidl_lock);\n"; })
+                .endl();
+    }).endl().endl();
+
+    out << "bool " << klassName
+        << "::_hidl_batchSupportedLocked(std::unique_lock<std::mutex>& _hidl_lock, "
+        << "uint32_t _hidl_code, const char* _hidl_descriptor) ";
+    out.block([&] {
+        out << "auto _hidl_it = _hidl_mBatchSupported.find(_hidl_code);\n";
+        out.sIf("_hidl_it != _hidl_mBatchSupported.end()", [&] {
+            out << "return _hidl_it->second;\n";
+        }).endl().endl();
+
+        out << "// Probe without the lock, so other calls are not held up by the round trip.\n";
+        out << "_hidl_lock.unlock();\n";
+        out << "::android::hardware::Parcel _hidl_data;\n";
+        out << "::android::hardware::Parcel _hidl_reply;\n";
+        out << "::android::hardware::Status _hidl_status;\n";
+        out << "::android::status_t _hidl_err = _hidl_data.writeInterfaceToken(_hidl_descriptor);\n";
+        out.sIf("_hidl_err == ::android::OK", [&] {
+            out << "_hidl_err = _hidl_data.writeUint32(0);\n";
+        }).endl();
+        out.sIf("_hidl_err == ::android::OK", [&] {
+            out << "_hidl_err = remote()->transact(_hidl_code, _hidl_data, &_hidl_reply, 0);\n";
+        }).endl();
+        out.sIf("_hidl_err == ::android::OK", [&] {
+            out << "_hidl_reply.setDataPosition(0);\n";
+            out << "_hidl_err = ::android::hardware::readFromParcel(&_hidl_status, _hidl_reply);\n";
+        }).endl();
+        out << "_hidl_lock.lock();\n\n";
+
+        out << "// Only definite answers are cached. Peers generated without @batch support\n"
+            << "// reject the empty probe with UNKNOWN_TRANSACTION; after any other failure\n"
+            << "// this call is sent on its own and the next one probes again.\n";
+        out.sIf("_hidl_err == ::android::OK && _hidl_status.isOk()", [&] {
+            out << "_hidl_mBatchSupported[_hidl_code] = true;\n";
+            out << "return true;\n";
+        }).endl();
+        out.sIf("_hidl_err == ::android::UNKNOWN_TRANSACTION", [&] {
+            out << "_hidl_mBatchSupported[_hidl_code] = false;\n";
+        }).endl();
+        out << "return false;\n";
+    }).endl().endl();
+
+    out << "::android::status_t " << klassName
+        << "::_hidl_beginBatchLocked(uint32_t _hidl_code, const char* _hidl_descriptor, "
+        << "uint32_t _hidl_flushUs) ";
+    out.block([&] {
+        out << "auto _hidl_data = std::make_unique<::android::hardware::Parcel>();\n";
+        out << "::android::status_t _hidl_err = _hidl_data->writeInterfaceToken(_hidl_descriptor);\n";
+        out << "if (_hidl_err != ::android::OK) { return _hidl_err; }\n";
+        out << "const size_t _hidl_countPosition = _hidl_data->dataPosition();\n";
+        out << "// Patched with the real count by _hidl_flushBatchLocked.\n";
+        out << "_hidl_err = _hidl_data->writeUint32(0);\n";
+        out << "if (_hidl_err != ::android::OK) { return _hidl_err; }\n\n";
+
+        out << "_hidl_mBatchData = std::move(_hidl_data);\n";
+        out << "_hidl_mBatchCode = _hidl_code;\n";
+        out << "_hidl_mBatchCountPosition = _hidl_countPosition;\n";
+        out << "_hidl_mBatchCount = 0;\n";
+        out << "_hidl_mBatchDeadline = std::chrono::steady_clock::now() + "
+            << "std::chrono::microseconds(_hidl_flushUs);\n\n";
+
+        out << "_hidl_BatchTimer::get().schedule(_hidl_mBatchDeadline, "
+            << "[_hidl_proxy = ::android::wp<" << klassName << ">(this)] ";
+        out.block([&] {
+            out << "::android::sp<" << klassName << "> _hidl_strong = _hidl_proxy.promote();\n";
+            out.sIf("_hidl_strong != nullptr", [&] {
+                out << "_hidl_strong->_hidl_flushExpiredBatch();\n";
+            }).endl();
+        });
+        out << ");\n";
+        out << "return ::android::OK;\n";
+    }).endl().endl();
+}
+
+void AST::generateProxyEncodingSource(Formatter& out, const std::string& klassName) const {
+    out << "bool " << klassName
+        << "::_hidl_encodingSupported(uint32_t _hidl_code, const char* _hidl_descriptor) ";
+    out.block([&] {
+        out << "std::unique_lock<std::mutex> _hidl_lock(_hidl_mEncodingMutex);\n";
+        out << "auto _hidl_it = _hidl_mEncodingSupported.find(_hidl_code);\n";
+        out.sIf("_hidl_it != _hidl_mEncodingSupported.end()", [&] {
+            out << "return _hidl_it->second;\n";
+        }).endl().endl();
+
+        out << "// Probe without the lock, so other calls are not held up by the round trip.\n";
+        out << "_hidl_lock.unlock();\n";
+        out << "::android::hardware::Parcel _hidl_data;\n";
+        out << "::android::hardware::Parcel _hidl_reply;\n";
+        out << "::android::hardware::Status _hidl_status;\n";
+        out << "::android::status_t _hidl_err = _hidl_data.writeInterfaceToken(_hidl_descriptor);\n";
+        out.sIf("_hidl_err == ::android::OK", [&] {
+            out << "_hidl_err = _hidl_data.writeUint32(0 /* probe */);\n";
+        }).endl();
+        out.sIf("_hidl_err == ::android::OK", [&] {
+            out << "_hidl_err = remote()->transact(_hidl_code, _hidl_data, &_hidl_reply, 0);\n";
+        }).endl();
+        out.sIf("_hidl_err == ::android::OK", [&] {
+            out << "_hidl_reply.setDataPosition(0);\n";
+            out << "_hidl_err = ::android::hardware::readFromParcel(&_hidl_status, _hidl_reply);\n";
+        }).endl();
+
+        out << "_hidl_lock.lock();\n\n";
+
+        out << "// Only definite answers are cached. Peers generated without @flatten or @shm\n"
+            << "// support reject the probe with UNKNOWN_TRANSACTION; after any other failure\n"
+            << "// this call uses the classic encoding and the next one probes again.\n";
+        out.sIf("_hidl_err == ::android::OK && _hidl_status.isOk()", [&] {
+            out << "_hidl_mEncodingSupported[_hidl_code] = true;\n";
+            out << "return true;\n";
+        }).endl();
+        out.sIf("_hidl_err == ::android::UNKNOWN_TRANSACTION", [&] {
+            out << "_hidl_mEncodingSupported[_hidl_code] = false;\n";
+        }).endl();
+        out << "return false;\n";
+    }).endl().endl();
+}
+
+void AST::generateProxyBatchMethodSource(Formatter& out, const Method* method,
+                                         const Interface* superInterface) const {
+    const std::string descriptor = superInterface->fqName().cppName() + "::descriptor";
+    const size_t code = Interface::getBatchSerialId(method);
+
+    const auto& args = method->args();
+    if (std::any_of(args.begin(), args.end(), [](const auto* arg) {
+            return arg->type().isInterface();
+        })) {
+        // Like _hidl_<method>, start the threadpool for calls on the interfaces
+        // passed in.
+        out.sIf("remote()->localBinder() == nullptr", [&] {
+            out << "::android::hardware::ProcessState::self()->startThreadPool();\n";
+        }).endl().endl();
+    }
+
+    out << "std::unique_lock<std::mutex> _hidl_lock(_hidl_mBatchMutex);\n";
+    out.sIf("!_hidl_batchSupportedLocked(_hidl_lock, " + std::to_string(code) + " /* " +
+                    method->name() + " (batched) */, " + descriptor + ")",
+            [&] {
+                out << "_hidl_flushBatchLocked(_hidl_lock);\n";
+                out << "_hidl_lock.unlock();\n";
+                out << "return " << superInterface->fqName().cppNamespace() << "::"
+                    << superInterface->getProxyName() << "::_hidl_" << method->name()
+                    << "(this, this";
+                for (const auto& arg : method->args()) {
+                    out << ", " << arg->name();
+                }
+                out << ");\n";
+            })
+            .endl()
+            .endl();
+
+    out << "::android::status_t _hidl_err = ::android::OK;\n";
+    out << "::android::hardware::Status _hidl_status;\n";
+    out << "// Flushing releases the lock, so another thread may queue calls meanwhile.\n";
+    out << "while (_hidl_mBatchCode != " << code << ") ";
+    out.block([&] {
+        out.sIf("_hidl_mBatchCode != 0", [&] {
+            out << "_hidl_flushBatchLocked(_hidl_lock);\n";
+            out << "continue;\n";
+        }).endl();
+        out << "_hidl_err = _hidl_beginBatchLocked(" << code << ", " << descriptor << ", "
+            << method->getBatchFlushUs() << " /* flushUs */);\n";
+        out << "if (_hidl_err != ::android::OK) { goto _hidl_error; }\n";
+    }).endl().endl();
+
+    out.block([&] {
+        out << "::android::hardware::Parcel &_hidl_data = *_hidl_mBatchData;\n";
+        for (const auto& arg : method->args()) {
+            // Arguments passed by const reference may be written as pointers
+            // to the caller's buffers.
+            if (!Method::isCppMovableArg(arg)) {
+                emitCppReaderWriter(out, "_hidl_data", false /* parcelObjIsPointer */, arg,
+                                    false /* reader */, Type::ErrorMode_Goto,
+                                    false /* addPrefixToName */);
+                continue;
+            }
+
+            // The batch is sent after this call returns, so it keeps a copy.
+            const std::string type = arg->type().getCppStackType();
+            out << "auto _hidl_owned_" << arg->name() << " = std::make_shared<" << type << ">("
+                << arg->name() << ");\n";
+            out << "_hidl_mBatchArgs.push_back(_hidl_owned_" << arg->name() << ");\n";
+            out << "const " << type << "& _hidl_copy_" << arg->name() << " = *_hidl_owned_"
+                << arg->name() << ";\n";
+            arg->type().emitReaderWriter(out, "_hidl_copy_" + arg->name(), "_hidl_data",
+                                         false /* parcelObjIsPointer */, false /* isReader */,
+                                         Type::ErrorMode_Goto);
+        }
+    }).endl().endl();
+
+    out.sIf("++_hidl_mBatchCount >= " + std::to_string(method->getBatchMax()) + " /* max */",
+            [&] { out << "_hidl_flushBatchLocked(_hidl_lock);\n"; })
+            .endl();
+    out << "return ::android::hardware::Return<void>();\n\n";
+
+    out.unindent();
+    out << "_hidl_error:\n";
+    out.indent();
+    out << "// The batch may hold a partially written call, so none of it can be sent.\n";
+    out << "ALOGE(\"Dropped %u batched calls: %d\", _hidl_mBatchCount, _hidl_err);\n";
+    out << "_hidl_mBatchCode = 0;\n";
+    out << "_hidl_mBatchCount = 0;\n";
+    out << "_hidl_mBatchData.reset();\n";
+    out << "_hidl_mBatchArgs.clear();\n";
+    out << "_hidl_status.setFromStatusT(_hidl_err);\n";
+    out << "return ::android::hardware::Return<void>(_hidl_status);\n";
 }
 
 void AST::generateStubSource(Formatter& out, const Interface* iface) const {
@@ -1324,7 +2963,15 @@ void AST::generateStubSource(Formatter& out, const Interface* iface) const {
 
     generateMethods(out,
                     [&](const Method* method, const Interface* superInterface) {
-                        return generateStaticStubMethodSource(out, iface->fqName(), method, superInterface);
+                        generateStaticStubMethodSource(out, iface->fqName(), method, superInterface);
+                        if (method->isBatched()) {
+                            generateStaticStubBatchMethodSource(out, iface->fqName(), method);
+                        }
+                        const CallEncoding encoding = getCallEncoding(method);
+                        if (encoding != CallEncoding::CLASSIC) {
+                            generateStaticStubMethodSource(out, iface->fqName(), method,
+                                                           superInterface, encoding);
+                        }
                     },
                     false /* include parents */);
 
@@ -1375,6 +3022,32 @@ void AST::generateStubSource(Formatter& out, const Interface* iface) const {
 
         out.unindent();
         out << "}\n\n";
+
+        if (method->isBatched()) {
+            out << "case " << Interface::getBatchSerialId(method) << " /* " << method->name()
+                << " (batched) */:\n{\n";
+            out.indent([&] {
+                out << "_hidl_err = " << superInterface->fqName().cppNamespace() << "::"
+                    << superInterface->getStubName() << "::_hidl_" << method->name()
+                    << "_batch(this, _hidl_data, _hidl_reply, _hidl_cb);\n";
+                out << "break;\n";
+            });
+            out << "}\n\n";
+        }
+
+        const CallEncoding encoding = getCallEncoding(method);
+        if (encoding != CallEncoding::CLASSIC) {
+            out << "case " << getCallEncodingSerialId(method, encoding) << " /* "
+                << getCallEncodingComment(method, encoding) << " */:\n{\n";
+            out.indent([&] {
+                out << "_hidl_err = " << superInterface->fqName().cppNamespace() << "::"
+                    << superInterface->getStubName() << "::_hidl_" << method->name()
+                    << getCallEncodingSuffix(encoding)
+                    << "(this, _hidl_data, _hidl_reply, _hidl_cb);\n";
+                out << "break;\n";
+            });
+            out << "}\n\n";
+        }
     }
 
     out << "default:\n{\n";
@@ -1437,14 +3110,20 @@ void AST::generateStubSourceForMethod(Formatter& out, const Method* method,
 }
 
 void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
-                                         const Method* method, const Interface* superInterface) const {
+                                         const Method* method, const Interface* superInterface,
+                                         CallEncoding encoding) const {
     if (method->isHidlReserved() && method->overridesCppImpl(IMPL_STUB)) {
         return;
     }
 
+    const bool flat = encoding == CallEncoding::FLATTEN;
+    const NamedReference<Type>* shmArg =
+            encoding == CallEncoding::SHM ? method->getShmArg() : nullptr;
+
     const std::string& klassName = fqName.getInterfaceStubName();
 
-    out << "::android::status_t " << klassName << "::_hidl_" << method->name() << "(\n";
+    out << "::android::status_t " << klassName << "::_hidl_" << method->name()
+        << getCallEncodingSuffix(encoding) << "(\n";
 
     out.indent();
     out.indent();
@@ -1473,9 +3152,41 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
     out.unindent();
     out << "}\n\n";
 
+    if (encoding != CallEncoding::CLASSIC) {
+        out << "uint32_t _hidl_encoding_mode;\n";
+        out << "_hidl_err = _hidl_data.readUint32(&_hidl_encoding_mode);\n";
+        Type::handleError(out, Type::ErrorMode_Return);
+        out.sIf("_hidl_encoding_mode == 0 /* probe */", [&] {
+            out << "(void) _hidl_cb;\n";
+            out << "return ::android::hardware::writeToParcel("
+                << "::android::hardware::Status::ok(), _hidl_reply);\n";
+        }).endl().endl();
+    }
+
     declareCppReaderLocals(out, method->args(), false /* forResults */);
+    if (flat) {
+        declareCppFlatLocals(out, method->args(), "");
+        out << "\n";
+    }
+    if (shmArg != nullptr) {
+        out << "_hidl_ShmReceive _hidl_shm_" << shmArg->name() << ";\n\n";
+    }
 
     for (const auto &arg : method->args()) {
+        if (flat && Method::isCppFlattenedArg(arg)) {
+            continue;
+        }
+        if (arg == shmArg) {
+            out << "_hidl_err = _hidl_shm_" << arg->name() << ".read(_hidl_data, &" << arg->name()
+                << ");\n";
+            Type::handleError(out, Type::ErrorMode_Return);
+            out.sIf("!_hidl_shm_" + arg->name() + ".shared()", [&] {
+                emitCppReaderWriter(out, "_hidl_data", false /* parcelObjIsPointer */, arg,
+                                    true /* reader */, Type::ErrorMode_Return,
+                                    false /* addPrefixToName */);
+            }).endl().endl();
+            continue;
+        }
         emitCppReaderWriter(
                 out,
                 "_hidl_data",
@@ -1486,6 +3197,11 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
                 false /* addPrefixToName */);
     }
 
+    if (flat && hasFlattenedArgs(method->args())) {
+        emitCppFlatReader(out, "_hidl_data", false /* parcelObjIsPointer */, method->args(), "",
+                          Type::ErrorMode_Return);
+    }
+
     generateCppInstrumentationCall(
             out,
             InstrumentationEvent::SERVER_API_ENTRY,
@@ -1581,10 +3297,17 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
             out << "}\n";
             out << "_hidl_callbackCalled = true;\n\n";
 
+            if (flat) {
+                out << "_hidl_FlatWriter _hidl_flat_writer;\n";
+            }
+
             out << "::android::hardware::writeToParcel(::android::hardware::Status::ok(), "
                 << "_hidl_reply);\n\n";
 
             for (const auto &arg : method->results()) {
+                if (flat && Method::isCppFlattenedArg(arg)) {
+                    continue;
+                }
                 emitCppReaderWriter(
                         out,
                         "_hidl_reply",
@@ -1595,6 +3318,11 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
                         true /* addPrefixToName */);
             }
 
+            if (flat && hasFlattenedArgs(method->results())) {
+                emitCppFlatWriter(out, "_hidl_reply", true /* parcelObjIsPointer */,
+                                  method->results(), "_hidl_out_");
+            }
+
             if (!method->results().empty()) {
                 out.unindent();
                 out << "_hidl_error:\n";
@@ -1644,6 +3372,64 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
     out << "}\n\n";
 }
 
+void AST::generateStaticStubBatchMethodSource(Formatter& out, const FQName& fqName,
+                                              const Method* method) const {
+    const std::string& klassName = fqName.getInterfaceStubName();
+
+    out << "::android::status_t " << klassName << "::_hidl_" << method->name() << "_batch(\n";
+
+    out.indent(2, [&] {
+        out << "::android::hidl::base::V1_0::BnHwBase* _hidl_this,\n"
+            << "const ::android::hardware::Parcel &_hidl_data,\n"
+            << "::android::hardware::Parcel *_hidl_reply,\n"
+            << "TransactCallback _hidl_cb) {\n";
+    });
+
+    out.indent([&] {
+        out << "::android::status_t _hidl_err = ::android::OK;\n";
+        out.sIf("!_hidl_data.enforceInterface(" + klassName + "::Pure::descriptor)", [&] {
+            out << "_hidl_err = ::android::BAD_TYPE;\n";
+            out << "return _hidl_err;\n";
+        }).endl().endl();
+
+        out << "uint32_t _hidl_batch_count;\n";
+        out << "_hidl_err = _hidl_data.readUint32(&_hidl_batch_count);\n";
+        out << "if (_hidl_err != ::android::OK) { return _hidl_err; }\n\n";
+
+        out << "// A count of zero is the probe a proxy sends before batching, and is\n"
+            << "// simply acknowledged below.\n";
+        out << "for (uint32_t _hidl_batch_index = 0; _hidl_batch_index < _hidl_batch_count; "
+            << "++_hidl_batch_index) ";
+        out.block([&] {
+            declareCppReaderLocals(out, method->args(), false /* forResults */);
+
+            for (const auto& arg : method->args()) {
+                emitCppReaderWriter(out, "_hidl_data", false /* parcelObjIsPointer */, arg,
+                                    true /* reader */, Type::ErrorMode_Return,
+                                    false /* addPrefixToName */);
+            }
+
+            out << "::android::hardware::Return<void> _hidl_ret = static_cast<"
+                << fqName.getInterfaceName() << "*>(_hidl_this->getImpl().get())->"
+                << method->name() << "(";
+            out.join(method->args().begin(), method->args().end(), ", ", [&](const auto& arg) {
+                if (arg->type().resultNeedsDeref()) {
+                    out << "*";
+                }
+                out << arg->name();
+            });
+            out << ");\n";
+            out << "_hidl_ret.assertOk();\n";
+        }).endl().endl();
+
+        out << "(void) _hidl_cb;\n";
+        out << "::android::hardware::writeToParcel(::android::hardware::Status::ok(), "
+            << "_hidl_reply);\n\n";
+        out << "return _hidl_err;\n";
+    });
+    out << "}\n\n";
+}
+
 void AST::generatePassthroughHeader(Formatter& out) const {
     if (!AST::isInterface()) {
         // types.hal does not get a stub header.
@@ -1654,6 +3440,8 @@ void AST::generatePassthroughHeader(Formatter& out) const {
     CHECK(iface != nullptr);
 
     const std::string klassName = iface->getPassthroughName();
+    const bool hasOnewayPool = hasPassthroughOnewayPool(iface);
+    const bool hasInterfaceArguments = hasPassthroughInterfaceArguments(iface);
 
     const std::string guard = makeHeaderGuard(klassName);
 
@@ -1663,6 +3451,27 @@ void AST::generatePassthroughHeader(Formatter& out) const {
     out << "#include <android-base/macros.h>\n";
     out << "#include <cutils/trace.h>\n";
     out << "#include <future>\n";
+    if (hasOnewayPool) {
+        out << "#include <algorithm>\n";
+        out << "#include <chrono>\n";
+        out << "#include <condition_variable>\n";
+        out << "#include <deque>\n";
+        out << "#include <memory>\n";
+        out << "#include <mutex>\n";
+        out << "#include <thread>\n";
+        out << "#include <unordered_map>\n";
+        out << "#include <vector>\n";
+    } else if (hasInterfaceArguments) {
+        out << "#include <algorithm>\n";
+        out << "#include <mutex>\n";
+    }
+    if (!hasOnewayPool && hasInterfaceArguments) {
+        out << "#include <unordered_map>\n";
+        out << "#include <vector>\n";
+    }
+    if (!hasOnewayPool && hasPassthroughMovedOnewayArguments(iface)) {
+        out << "#include <memory>\n";
+    }
 
     generateCppPackageInclude(out, mPackage, iface->definedName());
     out << "\n";
@@ -1686,19 +3495,72 @@ void AST::generatePassthroughHeader(Formatter& out) const {
 
     generateMethods(out, [&](const Method* method, const Interface* superInterface) {
         generatePassthroughMethod(out, method, superInterface);
+        if (method->hasCppMoveOverload()) {
+            generatePassthroughMethod(out, method, superInterface, true /* moveArgs */);
+        }
     });
 
+    if (hasInterfaceArguments) {
+        out << "// Counters of the cache of Bs* objects wrapping interface arguments and\n"
+            << "// results.\n";
+        out << "struct PassthroughWrapperStats ";
+        out.block([&] {
+            out << "uint64_t hits;            // an existing wrapper was reused\n";
+            out << "uint64_t misses;          // a new wrapper was created\n";
+            out << "uint64_t alreadyWrapped;  // the object was a wrapper made by this cache\n";
+            out << "size_t entries;           // objects in the cache, some possibly dead\n";
+        });
+        out << ";\n\n";
+        out << "static PassthroughWrapperStats getPassthroughWrapperStats();\n\n";
+    }
+
+    if (hasOnewayPool) {
+        out << "~" << klassName << "();\n\n";
+
+        out << "// Snapshot of the queues that run oneway calls, see @passthroughOneway.\n";
+        out << "struct OnewayQueueStats ";
+        out.block([&] {
+            out << "size_t depth;          // calls waiting to run\n";
+            out << "size_t maxDepth;       // largest depth seen so far\n";
+            out << "uint64_t tasks;        // calls started so far\n";
+            out << "uint64_t totalWaitNs;  // time spent waiting by the calls started so far\n";
+            out << "uint64_t maxWaitNs;    // longest wait of a call started so far\n";
+        });
+        out << ";\n\n";
+        out << "// Fills in the stats of iface, which getService() or a passthrough\n"
+            << "// call returned. Returns false if iface is not a " << klassName << ".\n";
+        out << "static bool getOnewayQueueStats(const ::android::sp<" << iface->definedName()
+            << ">& iface, OnewayQueueStats* stats);\n\n";
+    }
+
     out.unindent();
     out << "private:\n";
     out.indent();
     out << "const ::android::sp<" << iface->definedName() << "> mImpl;\n";
 
-    out << "::android::hardware::details::TaskRunner mOnewayQueue;\n";
+    if (hasInterfaceArguments) {
+        generatePassthroughWrapperCache(out);
+    }
 
-    out << "\n";
+    if (hasOnewayPool) {
+        out << "struct OnewayPool;\n";
+        out << "std::shared_ptr<OnewayPool> mOnewayPool;\n";
+        out << "// Every live " << klassName << " by its " << iface->definedName() << ".\n";
+        out << "struct _hidl_OnewayPools;\n";
+        out << "static _hidl_OnewayPools& _hidl_onewayPools();\n";
 
-    out << "::android::hardware::Return<void> addOnewayTask("
-           "std::function<void(void)>);\n\n";
+        out << "\n";
+
+        out << "::android::hardware::Return<void> addOnewayTask("
+               "size_t key, std::function<void(void)>);\n\n";
+    } else {
+        out << "::android::hardware::details::TaskRunner mOnewayQueue;\n";
+
+        out << "\n";
+
+        out << "::android::hardware::Return<void> addOnewayTask("
+               "std::function<void(void)>);\n\n";
+    }
 
     out.unindent();
 
@@ -1733,6 +3595,21 @@ void AST::generateInterfaceSource(Formatter& out) const {
         return;
     });
 
+    generateMethods(out, [&](const Method* method, const Interface* superInterface) {
+        if (method->hasCppResultsStruct()) {
+            generateInterfaceResultsMethodSource(out, method, superInterface);
+        }
+        if (method->hasCppAsyncOverload()) {
+            generateInterfaceAsyncMethodSource(out, method);
+        }
+        if (method->hasCppAwaitableOverload()) {
+            generateInterfaceAwaitableMethodSource(out, method);
+        }
+        if (method->hasCppMoveOverload()) {
+            generateInterfaceMoveMethodSource(out, method, superInterface);
+        }
+    });
+
     for (const Interface *superType : iface->typeChain()) {
         out << "::android::hardware::Return<" << childTypeResult << "> " << iface->definedName()
             << "::castFrom(" << superType->getCppArgumentType() << " parent, bool "
@@ -1757,11 +3634,211 @@ void AST::generateInterfaceSource(Formatter& out) const {
     }
 }
 
+void AST::generateInterfaceResultsMethodSource(Formatter& out, const Method* method,
+                                               const Interface* superInterface) const {
+    const Interface* iface = mRootScope.getInterface();
+
+    out << "::android::hardware::Return<void> " << iface->definedName()
+        << "::" << method->getCppResultsMethodName() << "(";
+    method->emitCppResultsStructArgSignature(out);
+    out << ") ";
+
+    out.block([&] {
+        if (hasDirectResultsPath(iface, method)) {
+            // Proxy statics only need the binder, so they also serve proxies of
+            // derived interfaces, and read the reply without a callback.
+            out.sIf("isRemote()", [&] {
+                out << "return " << superInterface->fqName().cppNamespace() << "::"
+                    << superInterface->getProxyName() << "::_hidl_" << method->name()
+                    << "(this, ";
+                for (const auto& arg : method->args()) {
+                    out << arg->name() << ", ";
+                }
+                out << "_hidl_results);\n";
+            }).endl().endl();
+        }
+
+        out << "return " << method->name() << "(";
+        for (const auto& arg : method->args()) {
+            out << arg->name() << ", ";
+        }
+        out << "[&_hidl_results](";
+        method->emitCppResultSignature(out);
+        out << ") ";
+        out.block([&] {
+            for (const auto& arg : method->results()) {
+                out << "_hidl_results." << arg->name() << " = " << arg->name() << ";\n";
+            }
+        });
+        out << ");\n";
+    }).endl().endl();
+}
+
+void AST::generateInterfaceAsyncMethodSource(Formatter& out, const Method* method) const {
+    const Interface* iface = mRootScope.getInterface();
+
+    out << "void " << iface->definedName() << "::" << method->name() << "_async(";
+    method->emitCppAsyncArgSignature(out);
+    out << ") ";
+
+    out.block([&] {
+        out << "::android::sp<" << iface->definedName() << "> _hidl_this(this);\n";
+        out << "_hidl_executor([_hidl_this";
+        for (const auto& arg : method->args()) {
+            out << ", " << arg->name();
+        }
+        out << ", _hidl_done] ";
+        out.block([&] {
+            // Remote calls go through the same _hidl_<method> proxy statics as
+            // the blocking API.
+            if (method->hasCppResultsStruct()) {
+                out << method->getCppResultsStructName() << " _hidl_results;\n";
+            }
+            out << "auto _hidl_ret = _hidl_this->"
+                << (method->hasCppResultsStruct() ? method->getCppResultsMethodName()
+                                                  : method->name())
+                << "(";
+            out.join(method->args().begin(), method->args().end(), ", ",
+                     [&](const auto& arg) { out << arg->name(); });
+            if (method->hasCppResultsStruct()) {
+                out << (method->args().empty() ? "" : ", ") << "_hidl_results";
+            }
+            out << ");\n";
+            out << "_hidl_done(std::move(_hidl_ret)";
+            if (method->hasCppResultsStruct()) {
+                out << ", std::move(_hidl_results)";
+            }
+            out << ");\n";
+        });
+        out << ");\n";
+    }).endl().endl();
+}
+
+// Arguments of a call forwarding from <name>_move, or to it if moveArgs is set.
+static void emitCppMoveCallArgs(Formatter& out, const Method* method, bool moveArgs) {
+    out.join(method->args().begin(), method->args().end(), ", ", [&](const auto* arg) {
+        if (moveArgs && Method::isCppMovableArg(arg)) {
+            out << "std::move(" << arg->name() << ")";
+        } else {
+            out << arg->name();
+        }
+    });
+
+    if (!method->results().empty() && method->canElideCallback() == nullptr) {
+        out << ", _hidl_cb";
+    }
+}
+
+void AST::generateInterfaceMoveMethodSource(Formatter& out, const Method* method,
+                                            const Interface* superInterface) const {
+    const Interface* iface = mRootScope.getInterface();
+
+    if (superInterface == iface) {
+        method->generateCppReturnType(out);
+        out << iface->definedName() << "::" << method->getCppMoveMethodName() << "(";
+        method->emitCppMoveArgSignature(out);
+        out << ") ";
+        out.block([&] {
+            // Named rvalue references are lvalues, so this picks the const& overload.
+            out << "return " << method->name() << "(";
+            emitCppMoveCallArgs(out, method, false /* moveArgs */);
+            out << ");\n";
+        }).endl().endl();
+    }
+
+    method->generateCppReturnType(out);
+    out << iface->definedName() << "::" << method->name() << "(";
+    method->emitCppMoveArgSignature(out);
+    out << ") ";
+    out.block([&] {
+        out << "return " << method->getCppMoveMethodName() << "(";
+        emitCppMoveCallArgs(out, method, true /* moveArgs */);
+        out << ");\n";
+    }).endl().endl();
+}
+
+void AST::generateInterfaceAwaitableMethodSource(Formatter& out, const Method* method) const {
+    const Interface* iface = mRootScope.getInterface();
+    const std::string resultType = method->getCppAwaitResultType();
+
+    out << iface->definedName() << "::_hidl_awaitable<" << resultType << "> "
+        << iface->definedName() << "::" << method->name() << "_async(";
+    method->emitCppAwaitableArgSignature(out);
+    out << ") ";
+
+    out.block([&] {
+        out << "::android::sp<" << iface->definedName() << "> _hidl_this(this);\n";
+        out << "return _hidl_awaitable<" << resultType << ">(\n";
+        out.indent(2, [&] {
+            // The arguments are copied once here and then moved into the task,
+            // since the call only starts when the coroutine suspends.
+            out << "[_hidl_this";
+            for (const auto& arg : method->args()) {
+                out << ", " << arg->name() << " = " << arg->name();
+            }
+            if (method->hasCppResultsStruct()) {
+                out << ", &_hidl_results";
+            }
+            out << ", _hidl_executor](std::function<void(" << resultType
+                << ")> _hidl_resume) mutable ";
+            out.block([&] {
+                out << "_hidl_executor([_hidl_this";
+                for (const auto& arg : method->args()) {
+                    out << ", " << arg->name() << " = std::move(" << arg->name() << ")";
+                }
+                if (method->hasCppResultsStruct()) {
+                    out << ", &_hidl_results";
+                }
+                out << ", _hidl_resume = std::move(_hidl_resume)] ";
+                out.block([&] {
+                    out << "auto _hidl_ret = _hidl_this->"
+                        << (method->hasCppResultsStruct() ? method->getCppResultsMethodName()
+                                                          : method->name())
+                        << "(";
+                    out.join(method->args().begin(), method->args().end(), ", ",
+                             [&](const auto& arg) { out << arg->name(); });
+                    if (method->hasCppResultsStruct()) {
+                        out << (method->args().empty() ? "" : ", ") << "_hidl_results";
+                    }
+                    out << ");\n";
+                    out << "_hidl_resume(std::move(_hidl_ret));\n";
+                });
+                out << ");\n";
+            });
+            out << ");\n";
+        });
+    }).endl().endl();
+}
+
 void AST::generatePassthroughSource(Formatter& out) const {
     const Interface* iface = mRootScope.getInterface();
 
     const std::string klassName = iface->getPassthroughName();
 
+    if (hasPassthroughInterfaceArguments(iface)) {
+        out << klassName << "::_hidl_WrapperCache& " << klassName << "::_hidl_wrapperCache() ";
+        out.block([&] {
+            // Never destroyed, wrappers may still be created while exiting.
+            out << "static _hidl_WrapperCache* cache = new _hidl_WrapperCache();\n";
+            out << "return *cache;\n";
+        }).endl().endl();
+
+        out << klassName << "::PassthroughWrapperStats " << klassName
+            << "::getPassthroughWrapperStats() ";
+        out.block([&] {
+            out << "_hidl_WrapperCache& cache = _hidl_wrapperCache();\n";
+            out << "std::lock_guard<std::mutex> lock(cache.mutex);\n";
+            out << "PassthroughWrapperStats stats = cache.stats;\n";
+            out << "stats.entries = cache.byImpl.size();\n";
+            out << "return stats;\n";
+        }).endl().endl();
+    }
+
+    if (hasPassthroughOnewayPool(iface)) {
+        generatePassthroughOnewayPoolSource(out);
+        return;
+    }
+
     out << klassName << "::" << klassName << "(const ::android::sp<" << iface->fullName()
         << "> impl) : ::android::hardware::details::HidlInstrumentor(\"" << mPackage.string()
         << "\", \"" << iface->definedName() << "\"), mImpl(impl) {\n";
@@ -1791,6 +3868,274 @@ void AST::generatePassthroughSource(Formatter& out) const {
     out << "}\n\n";
 }
 
+void AST::generatePassthroughWrapperCache(Formatter& out) const {
+    const std::string base = "::android::hidl::base::V1_0::IBase";
+
+    out << "\n";
+    out << "struct _hidl_WrapperCacheEntry ";
+    out.block([&] {
+        out << "::android::wp<" << base << "> impl;\n";
+        out << "::android::wp<" << base << "> wrapper;\n";
+    });
+    out << ";\n\n";
+
+    // Entries only hold weak references: a wrapper lives as long as somebody
+    // uses it, and is reused for as long as it lives.
+    out << "struct _hidl_WrapperCache ";
+    out.block([&] {
+        out << "std::mutex mutex;\n";
+        out << "std::unordered_map<const " << base << "*, _hidl_WrapperCacheEntry> byImpl;\n";
+        out << "std::unordered_map<const " << base << "*, ::android::wp<" << base
+            << ">> wrappers;\n";
+        out << "size_t nextSweep = 16;\n";
+        out << "PassthroughWrapperStats stats = {};\n";
+    });
+    out << ";\n\n";
+
+    out << "static _hidl_WrapperCache& _hidl_wrapperCache();\n\n";
+
+    // Strong references taken while checking entries are added to promoted, so
+    // that the caller releases them after dropping the lock.
+    out << "template <typename IType>\n";
+    out << "static ::android::sp<IType> _hidl_findWrapperLocked(_hidl_WrapperCache& cache,\n";
+    out.indent(2, [&] {
+        out << "const ::android::sp<IType>& iface, std::vector<::android::sp<" << base
+            << ">>* promoted) ";
+    });
+    out.block([&] {
+        out << "const " << base << "* key = iface.get();\n\n";
+
+        out << "auto ownWrapper = cache.wrappers.find(key);\n";
+        out.sIf("ownWrapper != cache.wrappers.end()", [&] {
+            out << "promoted->push_back(ownWrapper->second.promote());\n";
+            out.sIf("promoted->back().get() == key", [&] {
+                out << "cache.stats.alreadyWrapped++;\n";
+                out << "return iface;\n";
+            }).endl();
+            out << "cache.wrappers.erase(ownWrapper);\n";
+        }).endl().endl();
+
+        out << "auto entry = cache.byImpl.find(key);\n";
+        out.sIf("entry != cache.byImpl.end()", [&] {
+            out << "promoted->push_back(entry->second.impl.promote());\n";
+            out << "const bool sameImpl = promoted->back().get() == key;\n";
+            out << "promoted->push_back(entry->second.wrapper.promote());\n";
+            out.sIf("sameImpl && promoted->back() != nullptr", [&] {
+                out << "cache.stats.hits++;\n";
+                out << "return static_cast<IType*>(promoted->back().get());\n";
+            }).endl();
+            // A dead wrapper, or a new object at the address of a dead one.
+            out << "cache.wrappers.erase(entry->second.wrapper.unsafe_get());\n";
+            out << "cache.byImpl.erase(entry);\n";
+        }).endl().endl();
+
+        out << "return nullptr;\n";
+    }).endl().endl();
+
+    out << "template <typename IType>\n";
+    out << "static ::android::sp<IType> _hidl_wrapPassthrough(const ::android::sp<IType>& iface) ";
+    out.block([&] {
+        out << "_hidl_WrapperCache& cache = _hidl_wrapperCache();\n";
+        // Declared before the locks, so that dropping the last reference to an
+        // object never runs its destructor while the lock is held.
+        out << "std::vector<::android::sp<" << base << ">> promoted;\n";
+        out << "::android::sp<IType> wrapper;\n";
+        out.block([&] {
+            out << "std::lock_guard<std::mutex> lock(cache.mutex);\n";
+            out << "wrapper = _hidl_findWrapperLocked(cache, iface, &promoted);\n";
+            out.sIf("wrapper != nullptr", [&] { out << "return wrapper;\n"; }).endl();
+        }).endl().endl();
+
+        out << "// Built without the lock, since creating a wrapper may load a library.\n";
+        out << "::android::sp<IType> created = ::android::hardware::details::wrapPassthrough("
+               "iface);\n";
+        out.sIf("created == nullptr", [&] { out << "return nullptr;\n"; }).endl().endl();
+
+        out << "std::lock_guard<std::mutex> lock(cache.mutex);\n";
+        out << "// Keep the wrapper of a thread that got here first.\n";
+        out << "wrapper = _hidl_findWrapperLocked(cache, iface, &promoted);\n";
+        out.sIf("wrapper != nullptr", [&] { out << "return wrapper;\n"; }).endl().endl();
+
+        out << "cache.stats.misses++;\n";
+        out.sIf("cache.byImpl.size() >= cache.nextSweep", [&] {
+            out << "for (auto it = cache.byImpl.begin(); it != cache.byImpl.end();) ";
+            out.block([&] {
+                out << "promoted.push_back(it->second.wrapper.promote());\n";
+                out.sIf("promoted.back() == nullptr", [&] {
+                    out << "cache.wrappers.erase(it->second.wrapper.unsafe_get());\n";
+                    out << "it = cache.byImpl.erase(it);\n";
+                }).sElse([&] { out << "++it;\n"; }).endl();
+            }).endl();
+            out << "cache.nextSweep = std::max<size_t>(16, 2 * cache.byImpl.size());\n";
+        }).endl().endl();
+
+        out << "cache.byImpl[iface.get()] = {iface, created};\n";
+        out << "cache.wrappers[created.get()] = created;\n";
+        out << "return created;\n";
+    }).endl().endl();
+}
+
+void AST::generatePassthroughOnewayPoolSource(Formatter& out) const {
+    const Interface* iface = mRootScope.getInterface();
+
+    const std::string klassName = iface->getPassthroughName();
+    const std::string depthCounter =
+            "HIDL::" + iface->definedName() + "::passthroughOnewayDepth";
+
+    // Shared with the worker threads, so that a worker can finish its queue
+    // after the Bs object is gone without joining from the destructor.
+    out << "struct " << klassName << "::OnewayPool ";
+    out.block([&] {
+        out << "struct Worker ";
+        out.block([&] {
+            out << "std::deque<std::pair<std::chrono::steady_clock::time_point, "
+                << "std::function<void(void)>>> tasks;\n";
+            out << "std::condition_variable pushed;\n";
+            out << "std::thread::id threadId;\n";
+            out << "bool started = false;\n";
+        });
+        out << ";\n\n";
+
+        out << "explicit OnewayPool(size_t workerCount) : workers(workerCount) {}\n\n";
+
+        out << "void run(size_t index) ";
+        out.block([&] {
+            out << "std::unique_lock<std::mutex> lock(mutex);\n";
+            out << "Worker& worker = workers[index];\n";
+            out << "while (true) ";
+            out.block([&] {
+                out << "worker.pushed.wait(lock, [&] { return stopping || !worker.tasks.empty(); "
+                       "});\n";
+                out << "if (worker.tasks.empty()) return;\n\n";
+
+                out << "auto task = std::move(worker.tasks.front());\n";
+                out << "worker.tasks.pop_front();\n";
+                out << "uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(\n";
+                out.indent(2, [&] {
+                    out << "std::chrono::steady_clock::now() - task.first).count();\n";
+                });
+                out << "stats.depth--;\n";
+                out << "stats.tasks++;\n";
+                out << "stats.totalWaitNs += waitNs;\n";
+                out << "stats.maxWaitNs = std::max(stats.maxWaitNs, waitNs);\n";
+                out << "atrace_int(ATRACE_TAG_HAL, \"" << depthCounter
+                    << "\", static_cast<int32_t>(stats.depth));\n";
+                out << "popped.notify_all();\n\n";
+
+                out << "lock.unlock();\n";
+                out << "task.second();\n";
+                out << "lock.lock();\n";
+            }).endl();
+        }).endl().endl();
+
+        out << "std::mutex mutex;\n";
+        out << "std::condition_variable popped;\n";
+        out << "std::vector<Worker> workers;\n";
+        out << "bool stopping = false;\n";
+        out << "OnewayQueueStats stats = {};\n";
+    });
+    out << ";\n\n";
+
+    out << klassName << "::" << klassName << "(const ::android::sp<" << iface->fullName()
+        << "> impl) : ::android::hardware::details::HidlInstrumentor(\"" << mPackage.string()
+        << "\", \"" << iface->definedName() << "\"), mImpl(impl),\n";
+    out.indent(2, [&] {
+        out << "mOnewayPool(std::make_shared<OnewayPool>(" << iface->getPassthroughOnewayWorkers()
+            << " /* workers */)) ";
+    });
+    out.block([&] {
+        out << "_hidl_OnewayPools& pools = _hidl_onewayPools();\n";
+        out << "std::lock_guard<std::mutex> lock(pools.mutex);\n";
+        out << "pools.byInterface[this] = mOnewayPool;\n";
+    }).endl().endl();
+
+    out << klassName << "::~" << klassName << "() ";
+    out.block([&] {
+        out.block([&] {
+            out << "_hidl_OnewayPools& pools = _hidl_onewayPools();\n";
+            out << "std::lock_guard<std::mutex> lock(pools.mutex);\n";
+            out << "pools.byInterface.erase(this);\n";
+        }).endl().endl();
+
+        out << "std::lock_guard<std::mutex> lock(mOnewayPool->mutex);\n";
+        out << "mOnewayPool->stopping = true;\n";
+        out << "for (auto& worker : mOnewayPool->workers) ";
+        out.block([&] { out << "worker.pushed.notify_one();\n"; }).endl();
+    }).endl().endl();
+
+    out << "struct " << klassName << "::_hidl_OnewayPools ";
+    out.block([&] {
+        out << "std::mutex mutex;\n";
+        out << "std::unordered_map<const " << iface->definedName()
+            << "*, std::shared_ptr<OnewayPool>> byInterface;\n";
+    });
+    out << ";\n\n";
+
+    out << klassName << "::_hidl_OnewayPools& " << klassName << "::_hidl_onewayPools() ";
+    out.block([&] {
+        // Never destroyed, Bs objects may still go away while exiting.
+        out << "static _hidl_OnewayPools* pools = new _hidl_OnewayPools();\n";
+        out << "return *pools;\n";
+    }).endl().endl();
+
+    out << "bool " << klassName << "::getOnewayQueueStats(const ::android::sp<"
+        << iface->definedName() << ">& iface, OnewayQueueStats* stats) ";
+    out.block([&] {
+        out << "_hidl_OnewayPools& pools = _hidl_onewayPools();\n";
+        out << "std::lock_guard<std::mutex> lock(pools.mutex);\n";
+        out << "auto it = pools.byInterface.find(iface.get());\n";
+        out.sIf("it == pools.byInterface.end()", [&] { out << "return false;\n"; }).endl().endl();
+
+        out << "std::lock_guard<std::mutex> poolLock(it->second->mutex);\n";
+        out << "*stats = it->second->stats;\n";
+        out << "return true;\n";
+    }).endl().endl();
+
+    // Calls with the same key always go to the same worker, which runs them in
+    // the order they were made.
+    out << "::android::hardware::Return<void> " << klassName
+        << "::addOnewayTask(size_t key, std::function<void(void)> fun) ";
+    out.block([&] {
+        out << "std::unique_lock<std::mutex> lock(mOnewayPool->mutex);\n";
+        out << "size_t index = key % mOnewayPool->workers.size();\n";
+        out << "OnewayPool::Worker& worker = mOnewayPool->workers[index];\n\n";
+
+        out << "// Block the caller while the queue is full, unless it is one of the\n"
+            << "// workers: two workers calling into each other's full queues would\n"
+            << "// wait forever. Workers of different interfaces calling each other\n"
+            << "// can still deadlock this way.\n";
+        out << "const bool isWorker = std::any_of(mOnewayPool->workers.begin(), "
+            << "mOnewayPool->workers.end(),\n";
+        out.indent(2, [&] {
+            out << "[](const OnewayPool::Worker& w) { return w.threadId == "
+                << "std::this_thread::get_id(); });\n";
+        });
+        out.sIf("!isWorker", [&] {
+            out << "mOnewayPool->popped.wait(lock, [&] { return worker.tasks.size() < "
+                << iface->getPassthroughOnewayQueueSize() << "; });\n";
+        }).endl().endl();
+
+        out << "worker.tasks.emplace_back(std::chrono::steady_clock::now(), std::move(fun));\n";
+        out << "mOnewayPool->stats.depth++;\n";
+        out << "mOnewayPool->stats.maxDepth =\n";
+        out.indent(2, [&] {
+            out << "std::max(mOnewayPool->stats.maxDepth, mOnewayPool->stats.depth);\n";
+        });
+        out << "atrace_int(ATRACE_TAG_HAL, \"" << depthCounter
+            << "\", static_cast<int32_t>(mOnewayPool->stats.depth));\n\n";
+
+        out.sIf("!worker.started", [&] {
+            out << "worker.started = true;\n";
+            out << "std::thread thread([pool = mOnewayPool, index] { pool->run(index); });\n";
+            out << "worker.threadId = thread.get_id();\n";
+            out << "thread.detach();\n";
+        }).endl();
+        out << "worker.pushed.notify_one();\n\n";
+
+        out << "return ::android::hardware::Status();\n";
+    }).endl().endl();
+}
+
 void AST::generateCppAtraceCall(Formatter &out,
                                     InstrumentationEvent event,
                                     const Method *method) const {
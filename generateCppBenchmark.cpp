@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AST.h"
+
+#include "Interface.h"
+#include "Method.h"
+#include "Reference.h"
+
+#include <android-base/logging.h>
+#include <hidl-util/Formatter.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace android {
+
+// Only top-level vectors and strings grow with the benchmark argument; their
+// elements, and every other type, keep default values.
+static bool isSizedType(const Type& type) {
+    return type.isVector() || type.isString();
+}
+
+static bool isSizedMethod(const Method* method) {
+    for (const auto* arg : method->args()) {
+        if (isSizedType(arg->type())) return true;
+    }
+    for (const auto* result : method->results()) {
+        if (isSizedType(result->type())) return true;
+    }
+    return false;
+}
+
+static void emitSizeValue(Formatter& out, const Type& type, const std::string& name,
+                          const std::string& size) {
+    if (type.isVector()) {
+        out << name << ".resize(" << size << ");\n";
+    } else if (type.isString()) {
+        out << name << " = std::string(" << size << ", 'x');\n";
+    }
+}
+
+static std::string getBenchmarkResultName(const Method* method, const NamedReference<Type>* result) {
+    return "m_" + method->name() + "_" + result->name();
+}
+
+static std::string getBenchmarkFunctionName(const Method* method) {
+    return "BM_" + method->name();
+}
+
+void AST::generateCppBenchmarkSource(Formatter& out) const {
+    if (!AST::isInterface()) {
+        // types.hal has nothing to call.
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+    const std::string ifaceName = iface->definedName();
+    const std::string klassName = iface->getBaseName() + "Benchmark";
+
+    std::vector<const Method*> methods;
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        if (!tuple.method()->isHidlReserved()) {
+            methods.push_back(tuple.method());
+        }
+    }
+    const bool anySized = std::any_of(methods.begin(), methods.end(), isSizedMethod);
+
+    out << "// This file is autogenerated by hidl-gen -Lc++-benchmark.\n\n";
+    out << "// Benchmarks every method of " << iface->fqName().string() << " in passthrough\n"
+        << "// mode and through the binderized proxy and stub, joined in-process by a\n"
+        << "// LoopbackBinder. Pass --instance=<name> to also benchmark a running service.\n"
+        << "// Vectors and strings are sized by the benchmark argument; adjust the\n"
+        << "// arguments and results below to match real traffic.\n\n";
+
+    generateCppPackageInclude(out, mPackage, iface->fqName().getInterfaceProxyName());
+    generateCppPackageInclude(out, mPackage, iface->fqName().getInterfaceStubName());
+    generateCppPackageInclude(out, mPackage, iface->fqName().getInterfacePassthroughName());
+    generateCppPackageInclude(out, mPackage, ifaceName);
+    out << "#include <benchmark/benchmark.h>\n";
+    out << "#include <hidl-loopback/Loopback.h>\n\n";
+
+    out << "#include <algorithm>\n";
+    out << "#include <atomic>\n";
+    out << "#include <cstdlib>\n";
+    out << "#include <cstring>\n";
+    out << "#include <new>\n";
+    out << "#include <string>\n\n";
+
+    if (methods.empty()) {
+        out << "// " << ifaceName << " declares no methods to benchmark.\n\n";
+        out << "BENCHMARK_MAIN();\n";
+        return;
+    }
+
+    out << "using ::android::sp;\n";
+    out << "using ::android::hardware::LoopbackBinder;\n";
+    out << "using ::android::hardware::makeLoopback;\n";
+    out << "using ::android::hardware::Return;\n";
+    out << "using ::android::hardware::Void;\n";
+    out << "using " << iface->fqName().cppName() << ";\n";
+    out << "using " << iface->fqName().getInterfaceProxyFqName().cppName() << ";\n";
+    out << "using " << iface->fqName().getInterfaceStubFqName().cppName() << ";\n";
+    out << "using " << iface->fqName().getInterfacePassthroughFqName().cppName() << ";\n\n";
+
+    out << "// Counts operator new calls on both sides of the transport, reported as\n"
+        << "// new/call. Buffers allocated with malloc or realloc, such as those of\n"
+        << "// Parcel, are not counted. The nothrow forms call these.\n";
+    out << "static std::atomic<size_t> gNewCalls{0};\n\n";
+    out << "void* operator new(size_t size) ";
+    out.block([&] {
+        out << "gNewCalls.fetch_add(1, std::memory_order_relaxed);\n";
+        out << "void* ptr = std::malloc(size == 0 ? 1 : size);\n";
+        out.sIf("ptr == nullptr", [&] { out << "std::abort();\n"; }).endl();
+        out << "return ptr;\n";
+    }).endl().endl();
+    out << "void* operator new(size_t size, std::align_val_t align) ";
+    out.block([&] {
+        out << "gNewCalls.fetch_add(1, std::memory_order_relaxed);\n";
+        out << "void* ptr = nullptr;\n";
+        out.sIf("posix_memalign(&ptr, std::max(static_cast<size_t>(align), sizeof(void*)), "
+                "size == 0 ? 1 : size) != 0",
+                [&] { out << "std::abort();\n"; })
+                .endl();
+        out << "return ptr;\n";
+    }).endl().endl();
+    out << "void* operator new[](size_t size) ";
+    out.block([&] { out << "return operator new(size);\n"; }).endl().endl();
+    out << "void* operator new[](size_t size, std::align_val_t align) ";
+    out.block([&] { out << "return operator new(size, align);\n"; }).endl().endl();
+
+    // Every replaceable delete form frees with std::free, since all of the
+    // operator new forms above allocate with malloc or posix_memalign.
+    for (const std::string& deleteName : {"operator delete", "operator delete[]"}) {
+        for (const std::string& extraParams :
+             {"", ", size_t", ", std::align_val_t", ", size_t, std::align_val_t"}) {
+            out << "void " << deleteName << "(void* ptr" << extraParams << ") noexcept ";
+            out.block([&] { out << "std::free(ptr);\n"; }).endl().endl();
+        }
+    }
+
+    out << "namespace {\n\n";
+
+    out << "enum class Transport { PASSTHROUGH, LOOPBACK, REMOTE };\n\n";
+    out << "const char* gInstance = nullptr;\n\n";
+
+    out << "struct " << klassName << " : public " << ifaceName << " ";
+    out.block([&] {
+        out << "void resize(size_t _hidl_size) ";
+        out.block([&] {
+            out << "(void)_hidl_size;\n";
+            for (const Method* method : methods) {
+                for (const auto* result : method->results()) {
+                    emitSizeValue(out, result->type(), getBenchmarkResultName(method, result),
+                                  "_hidl_size");
+                }
+            }
+        }).endl().endl();
+
+        for (const Method* method : methods) {
+            method->generateCppSignature(out, "" /* className */);
+            out << " override ";
+            out.block([&] {
+                const NamedReference<Type>* elidedReturn = method->canElideCallback();
+                if (elidedReturn != nullptr) {
+                    out << "return " << getBenchmarkResultName(method, elidedReturn) << ";\n";
+                    return;
+                }
+                if (!method->results().empty()) {
+                    out << "_hidl_cb(";
+                    out.join(method->results().begin(), method->results().end(), ", ",
+                             [&](const auto* result) {
+                                 out << getBenchmarkResultName(method, result);
+                             });
+                    out << ");\n";
+                }
+                out << "return Void();\n";
+            }).endl().endl();
+        }
+
+        for (const Method* method : methods) {
+            for (const auto* result : method->results()) {
+                out << result->type().getCppStackType() << " "
+                    << getBenchmarkResultName(method, result) << "{};\n";
+            }
+        }
+    });
+    out << ";\n\n";
+
+    out << "sp<" << ifaceName << "> getInterface(Transport transport, const sp<" << klassName
+        << ">& impl, sp<LoopbackBinder>* binder) ";
+    out.block([&] {
+        out << "switch (transport) ";
+        out.block([&] {
+            out << "case Transport::PASSTHROUGH:\n";
+            out.indent([&] {
+                out << "return new " << iface->fqName().getInterfacePassthroughName()
+                    << "(impl);\n";
+            });
+            out << "case Transport::LOOPBACK:\n";
+            out.indent([&] {
+                out << "return makeLoopback<" << iface->fqName().getInterfaceProxyName() << ", "
+                    << iface->fqName().getInterfaceStubName() << ">(impl, binder);\n";
+            });
+            out << "case Transport::REMOTE:\n";
+            out.indent([&] { out << "return " << ifaceName << "::getService(gInstance);\n"; });
+        }).endl();
+        out << "return nullptr;\n";
+    }).endl().endl();
+
+    out << "void report(::benchmark::State& state, Transport transport, "
+        << "const sp<LoopbackBinder>& binder, size_t newCalls) ";
+    out.block([&] {
+        out << "state.SetItemsProcessed(state.iterations());\n";
+        out.sIf("binder != nullptr", [&] {
+            out << "state.SetBytesProcessed(binder->bytesSent() + binder->bytesReceived());\n";
+        }).endl();
+        out.sIf("transport == Transport::REMOTE", [&] {
+            out << "// Only LoopbackBinder counts the bytes in each parcel. A service in\n"
+                << "// another process is reached through the kernel, which does not.\n";
+            out << "state.SetLabel(\"bytes not measured\");\n";
+        }).endl();
+        out << "state.counters[\"new/call\"] =\n";
+        out.indent(2, [&] {
+            out << "::benchmark::Counter(newCalls, ::benchmark::Counter::kAvgIterations);\n";
+        });
+    }).endl().endl();
+
+    if (anySized) {
+        out << "void applySizes(::benchmark::internal::Benchmark* benchmark) ";
+        out.block([&] { out << "benchmark->RangeMultiplier(8)->Range(1, 1 << 12);\n"; })
+                .endl()
+                .endl();
+    }
+
+    for (const Method* method : methods) {
+        const bool sized = isSizedMethod(method);
+        const std::string functionName = getBenchmarkFunctionName(method);
+
+        out << "void " << functionName
+            << "(::benchmark::State& _hidl_state, Transport _hidl_transport) ";
+        out.block([&] {
+            out << "sp<" << klassName << "> _hidl_impl = new " << klassName << "();\n";
+            if (sized) {
+                out << "const size_t _hidl_size = _hidl_state.range(0);\n";
+                out << "_hidl_impl->resize(_hidl_size);\n";
+            }
+            out << "sp<LoopbackBinder> _hidl_binder;\n";
+            out << "sp<" << ifaceName
+                << "> _hidl_iface = getInterface(_hidl_transport, _hidl_impl, &_hidl_binder);\n";
+            out.sIf("_hidl_iface == nullptr", [&] {
+                out << "_hidl_state.SkipWithError(\"interface not available\");\n";
+                out << "return;\n";
+            }).endl();
+
+            for (const auto* arg : method->args()) {
+                out << arg->type().getCppStackType() << " " << arg->name() << "{};\n";
+                emitSizeValue(out, arg->type(), arg->name(), "_hidl_size");
+            }
+
+            out << "const size_t _hidl_newCalls = gNewCalls;\n";
+            out << "for (auto _ : _hidl_state) ";
+            out.block([&] {
+                out << "auto _hidl_ret = _hidl_iface->" << method->name() << "(";
+                out.join(method->args().begin(), method->args().end(), ", ",
+                         [&](const auto* arg) { out << arg->name(); });
+                if (!method->results().empty() && method->canElideCallback() == nullptr) {
+                    out << (method->args().empty() ? "" : ", ") << "[](const auto&...) {}";
+                }
+                out << ");\n";
+                out.sIf("!_hidl_ret.isOk()", [&] {
+                    out << "_hidl_state.SkipWithError(_hidl_ret.description().c_str());\n";
+                    out << "break;\n";
+                }).endl();
+            }).endl();
+            out << "report(_hidl_state, _hidl_transport, _hidl_binder, "
+                << "gNewCalls - _hidl_newCalls);\n";
+        }).endl();
+
+        const std::string apply = sized ? "->Apply(applySizes)" : "";
+        out << "BENCHMARK_CAPTURE(" << functionName << ", Passthrough, Transport::PASSTHROUGH)"
+            << apply << ";\n";
+        out << "BENCHMARK_CAPTURE(" << functionName << ", Loopback, Transport::LOOPBACK)" << apply
+            << ";\n\n";
+    }
+
+    out << "}  // namespace\n\n";
+
+    out << "int main(int argc, char** argv) ";
+    out.block([&] {
+        out << "for (int i = 1; i < argc; i++) ";
+        out.block([&] {
+            out.sIf("strncmp(argv[i], \"--instance=\", strlen(\"--instance=\")) == 0", [&] {
+                out << "gInstance = argv[i] + strlen(\"--instance=\");\n";
+            }).endl();
+        }).endl();
+        out << "::benchmark::Initialize(&argc, argv);\n";
+        out.sIf("gInstance != nullptr", [&] {
+            for (const Method* method : methods) {
+                const std::string functionName = getBenchmarkFunctionName(method);
+                out << "::benchmark::RegisterBenchmark(\"" << functionName << "/Remote\", "
+                    << functionName << ", Transport::REMOTE)"
+                    << (isSizedMethod(method) ? "->Apply(applySizes)" : "") << ";\n";
+            }
+        }).endl();
+        out << "::benchmark::RunSpecifiedBenchmarks();\n";
+        out << "return 0;\n";
+    }).endl();
+}
+
+}  // namespace android
@@ -22,26 +22,94 @@
 #include "Method.h"
 #include "Reference.h"
 #include "Scope.h"
+#include "VectorType.h"
 
 #include <hidl-util/Formatter.h>
+#include <hidl-util/StringHelper.h>
 #include <android-base/logging.h>
 
 namespace android {
 
+// Reads or writes a vec<scalar> as a primitive array, or a vector of
+// @javaView structs as a View. The wire format is the same as for the
+// ArrayList path, but the elements are copied in one call instead of being
+// boxed one at a time.
+static void emitJavaArrayReaderWriter(Formatter& out, const std::string& parcelObj,
+                                      const NamedReference<Type>* arg, const std::string& name,
+                                      bool isReader) {
+    const Type* elementType = static_cast<const VectorType&>(arg->type()).getElementType();
+
+    if (Method::isJavaViewElement(elementType)) {
+        if (isReader) {
+            out << Method::getJavaArraysType(arg) << " " << name << " = "
+                << elementType->getJavaType() << ".readViewFromParcel(" << parcelObj << ");\n";
+        } else {
+            out << elementType->getJavaType() << ".writeViewToParcel(" << parcelObj << ", "
+                << name << ");\n";
+        }
+        return;
+    }
+
+    const std::string suffix = elementType->getJavaSuffix();
+
+    size_t elementAlign, elementSize;
+    elementType->getAlignmentAndSize(&elementAlign, &elementSize);
+
+    if (isReader) {
+        out << Method::getJavaArraysType(arg) << " " << name << ";\n";
+    }
+
+    out.block([&] {
+        if (isReader) {
+            out << "android.os.HwBlob _hidl_blob = " << parcelObj
+                << ".readBuffer(16 /* sizeof(hidl_vec<T>) */);\n";
+            out << "int _hidl_vec_size = _hidl_blob.getInt32("
+                << "8 /* offsetof(hidl_vec<T>, mSize) */);\n";
+            out << "android.os.HwBlob childBlob = " << parcelObj << ".readEmbeddedBuffer(\n";
+            out.indent(2, [&] {
+                out << "_hidl_vec_size * " << elementSize << ", _hidl_blob.handle(),\n"
+                    << "0 /* offsetof(hidl_vec<T>, mBuffer) */, true /* nullable */);\n";
+            });
+            out << name << " = new " << elementType->getJavaType() << "[_hidl_vec_size];\n";
+            // An empty vector may have been sent with a null buffer.
+            out.sIf("_hidl_vec_size > 0", [&] {
+                out << "childBlob.copyTo" << suffix << "Array(0 /* offset */, " << name
+                    << ", _hidl_vec_size);\n";
+            }).endl();
+            return;
+        }
+
+        out << "android.os.HwBlob _hidl_blob = new android.os.HwBlob("
+            << "16 /* sizeof(hidl_vec<T>) */);\n";
+        out << "int _hidl_vec_size = " << name << ".length;\n";
+        out << "_hidl_blob.putInt32(8 /* offsetof(hidl_vec<T>, mSize) */, _hidl_vec_size);\n";
+        out << "_hidl_blob.putBool(12 /* offsetof(hidl_vec<T>, mOwnsBuffer) */, false);\n";
+        out << "android.os.HwBlob childBlob = new android.os.HwBlob("
+            << "(int)(_hidl_vec_size * " << elementSize << "));\n";
+        out << "childBlob.put" << suffix << "Array(0 /* offset */, " << name << ");\n";
+        out << "_hidl_blob.putBlob(0 /* offsetof(hidl_vec<T>, mBuffer) */, childBlob);\n";
+        out << parcelObj << ".writeBuffer(_hidl_blob);\n";
+    }).endl();
+}
+
 void AST::emitJavaReaderWriter(Formatter& out, const std::string& parcelObj,
                                const NamedReference<Type>* arg, bool isReader,
-                               bool addPrefixToName) const {
+                               bool addPrefixToName, bool arrays) const {
+    const std::string name = (addPrefixToName ? "_hidl_out_" : "") + arg->name();
+
+    if (arrays && Method::isJavaArrayArg(arg)) {
+        emitJavaArrayReaderWriter(out, parcelObj, arg, name, isReader);
+        return;
+    }
+
     if (isReader) {
         out << arg->type().getJavaType()
             << " "
-            << (addPrefixToName ? "_hidl_out_" : "")
-            << arg->name()
+            << name
             << " = ";
     }
 
-    arg->type().emitJavaReaderWriter(out, parcelObj,
-            (addPrefixToName ? "_hidl_out_" : "") + arg->name(),
-            isReader);
+    arg->type().emitJavaReaderWriter(out, parcelObj, name, isReader);
 }
 
 void AST::generateJavaTypes(Formatter& out, const std::string& limitToType) const {
@@ -63,6 +131,464 @@ void AST::generateJavaTypes(Formatter& out, const std::string& limitToType) cons
     CHECK(false) << "generateJavaTypes could not find limitToType type";
 }
 
+static void emitJavaListFromArray(Formatter& out, const NamedReference<Type>* arg,
+                                  const std::string& arrayName, const std::string& listName) {
+    const Type* elementType = static_cast<const VectorType&>(arg->type()).getElementType();
+
+    if (Method::isJavaViewElement(elementType)) {
+        out << arg->type().getJavaType() << " " << listName << " = " << arrayName
+            << ".toList();\n";
+        return;
+    }
+
+    out << arg->type().getJavaType() << " " << listName << " = new "
+        << arg->type().getJavaType(false /* forInitializer */) << "(" << arrayName
+        << ".length);\n";
+    out << "for (" << elementType->getJavaType() << " _hidl_element : " << arrayName << ") ";
+    out.block([&] { out << listName << ".add(_hidl_element);\n"; }).endl();
+}
+
+static void emitJavaArrayFromList(Formatter& out, const NamedReference<Type>* arg,
+                                  const std::string& listName, const std::string& arrayName) {
+    const Type* elementType = static_cast<const VectorType&>(arg->type()).getElementType();
+
+    if (Method::isJavaViewElement(elementType)) {
+        out << Method::getJavaArraysType(arg) << " " << arrayName << " = "
+            << elementType->getJavaType() << ".View.fromList(" << listName << ");\n";
+        return;
+    }
+
+    out << Method::getJavaArraysType(arg) << " " << arrayName << " = new "
+        << elementType->getJavaType() << "[" << listName << ".size()];\n";
+    out.sFor("int _hidl_index = 0; _hidl_index < " + arrayName + ".length; ++_hidl_index", [&] {
+        out << arrayName << "[_hidl_index] = " << listName << ".get(_hidl_index);\n";
+    }).endl();
+}
+
+// Emits the <method>Arrays callback and a default <method>Arrays, which boxes
+// its arguments and forwards to <method>. Proxies override it with a bulk
+// copy, and stubs dispatch to it, so overriding it on the server skips boxing.
+static void emitJavaArraysDefaultMethod(Formatter& out, const Method* method) {
+    const bool returnsValue = !method->results().empty();
+    const bool needsCallback = method->results().size() > 1;
+    const std::string arraysName = method->getJavaArraysMethodName();
+
+    if (needsCallback) {
+        out << "\n@java.lang.FunctionalInterface\npublic interface " << arraysName
+            << "Callback {\n";
+        out.indent([&] {
+            out << "public void onValues(";
+            method->emitJavaArraysResultSignature(out);
+            out << ");\n";
+        });
+        out << "}\n";
+    }
+
+    out << "\n/**\n * Same as " << method->name()
+        << ", with primitive arrays and views in place of boxed vectors.\n */\n";
+    out << "default ";
+    method->emitJavaArraysSignature(out);
+    out << "\n";
+    out.indent(2, [&] { out << "throws android.os.RemoteException "; });
+    out.block([&] {
+        std::vector<std::string> callArgs;
+        for (const auto& arg : method->args()) {
+            if (!Method::isJavaArrayArg(arg)) {
+                callArgs.push_back(arg->name());
+                continue;
+            }
+            emitJavaListFromArray(out, arg, arg->name(), "_hidl_in_" + arg->name());
+            callArgs.push_back("_hidl_in_" + arg->name());
+        }
+
+        const auto emitResultArray = [&](const NamedReference<Type>* arg) -> std::string {
+            const std::string name = "_hidl_out_" + arg->name();
+            if (!Method::isJavaArrayArg(arg)) return name;
+            emitJavaArrayFromList(out, arg, name, name + "_array");
+            return name + "_array";
+        };
+
+        if (returnsValue && !needsCallback) {
+            const NamedReference<Type>* result = method->results()[0];
+            out << result->type().getJavaType() << " _hidl_out_" << result->name() << " = ";
+        }
+
+        out << method->name() << "(";
+        out.join(callArgs.begin(), callArgs.end(), ", ", [&](const auto& arg) { out << arg; });
+
+        if (needsCallback) {
+            if (!callArgs.empty()) {
+                out << ", ";
+            }
+            out << "(";
+            out.join(method->results().begin(), method->results().end(), ", ",
+                     [&](const auto& arg) { out << "_hidl_out_" << arg->name(); });
+            out << ") -> ";
+            out.block([&] {
+                std::vector<std::string> results;
+                for (const auto& arg : method->results()) {
+                    results.push_back(emitResultArray(arg));
+                }
+                out << "_hidl_cb.onValues(";
+                out.join(results.begin(), results.end(), ", ",
+                         [&](const auto& arg) { out << arg; });
+                out << ");\n";
+            });
+        }
+
+        out << ");\n";
+
+        if (returnsValue && !needsCallback) {
+            const std::string result = emitResultArray(method->results()[0]);
+            out << "return " << result << ";\n";
+        }
+    }).endl();
+}
+
+// Emits <method>Async, which runs the blocking call on an Executor. The
+// RemoteException of a failed call completes the future exceptionally.
+static void emitJavaAsyncDefaultMethod(Formatter& out, const Method* method) {
+    const bool returnsValue = !method->results().empty();
+    const bool needsCallback = method->results().size() > 1;
+
+    if (needsCallback) {
+        out << "\n/**\n * Results of " << method->name() << "Async.\n */\n";
+        out << "public static final class " << method->getJavaResultsClassName() << " ";
+        out.block([&] {
+            for (const auto& arg : method->results()) {
+                out << "public " << arg->type().getJavaType() << " " << arg->name() << ";\n";
+            }
+        }).endl();
+    }
+
+    out << "\n/**\n * Calls " << method->name()
+        << " on the given executor and completes the returned future with its results.\n */\n";
+    out << "default ";
+    method->emitJavaAsyncSignature(out);
+    out << " ";
+    out.block([&] {
+        out << "return java.util.concurrent.CompletableFuture."
+            << (returnsValue ? "supplyAsync" : "runAsync") << "(() -> ";
+        out.block([&] {
+            out.sTry([&] {
+                if (needsCallback) {
+                    out << "final " << method->getJavaResultsClassName() << " _hidl_results = new "
+                        << method->getJavaResultsClassName() << "();\n";
+                } else if (returnsValue) {
+                    out << "return ";
+                }
+
+                out << method->name() << "(";
+                out.join(method->args().begin(), method->args().end(), ", ",
+                         [&](const auto& arg) { out << arg->name(); });
+
+                if (needsCallback) {
+                    if (!method->args().empty()) {
+                        out << ", ";
+                    }
+                    out << "(";
+                    out.join(method->results().begin(), method->results().end(), ", ",
+                             [&](const auto& arg) { out << "_hidl_out_" << arg->name(); });
+                    out << ") -> ";
+                    out.block([&] {
+                        for (const auto& arg : method->results()) {
+                            out << "_hidl_results." << arg->name() << " = _hidl_out_"
+                                << arg->name() << ";\n";
+                        }
+                    });
+                }
+
+                out << ");\n";
+
+                if (needsCallback) {
+                    out << "return _hidl_results;\n";
+                }
+            }).sCatch("android.os.RemoteException e", [&] {
+                out << "throw new java.util.concurrent.CompletionException(e);\n";
+            }).endl();
+        });
+        out << ", _hidl_executor);\n";
+    }).endl();
+}
+
+// Emits OnewaySender, which sends the oneway methods of iface from an
+// Executor. Calls made while a batch is being sent are queued and go out in
+// order from the same executor task, so a burst of calls costs a single
+// hand-off to the executor.
+static void emitJavaOnewaySender(Formatter& out, const Interface* iface) {
+    std::vector<const Method*> methods;
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        const Method* method = tuple.method();
+        if (method->isOneway() && !method->isHidlReserved()) {
+            methods.push_back(method);
+        }
+    }
+
+    if (methods.empty()) return;
+
+    const std::string ifaceName = iface->definedName();
+
+    out << "\n/**\n"
+        << " * Sends the oneway methods of " << ifaceName << " from an Executor instead of\n"
+        << " * the calling thread. Calls queued while a batch is being sent go out with\n"
+        << " * the next batch, in call order, from a single executor task.\n"
+        << " */\n";
+    out << "public static final class OnewaySender ";
+    out.block([&] {
+        out << "private interface Call ";
+        out.block([&] {
+            out << "void send() throws android.os.RemoteException;\n\n";
+            out << "/** Called instead of send() when the executor rejects the call. */\n";
+            out << "default void drop(RuntimeException reason) {}\n";
+        }).endl();
+        out << "\n";
+
+        out << "private final " << ifaceName << " mTarget;\n"
+            << "private final java.util.concurrent.Executor mExecutor;\n"
+            << "private final java.util.ArrayDeque<Call> mQueue =\n";
+        out.indent(2, [&] { out << "new java.util.ArrayDeque<Call>();\n"; });
+        out << "private boolean mScheduled = false;\n"
+            << "private Exception mFailure = null;\n\n";
+
+        out << "public OnewaySender(" << ifaceName
+            << " target, java.util.concurrent.Executor executor) ";
+        out.block([&] {
+            out << "mTarget = target;\n"
+                << "mExecutor = executor;\n";
+        }).endl().endl();
+
+        for (const Method* method : methods) {
+            out << "public void " << method->name() << "(";
+            method->emitJavaArgSignature(out);
+            out << ") ";
+            out.block([&] {
+                out << "enqueue(() -> mTarget." << method->name() << "(";
+                out.join(method->args().begin(), method->args().end(), ", ",
+                         [&](const auto& arg) { out << arg->name(); });
+                out << "));\n";
+            }).endl().endl();
+        }
+
+        out << "/**\n"
+            << " * Returns a future that completes once every call queued so far has been\n"
+            << " * sent. It completes exceptionally with the first RemoteException or\n"
+            << " * RuntimeException raised since the previous flush.\n"
+            << " */\n";
+        out << "public java.util.concurrent.CompletableFuture<Void> flush() ";
+        out.block([&] {
+            out << "final java.util.concurrent.CompletableFuture<Void> done =\n";
+            out.indent(2, [&] { out << "new java.util.concurrent.CompletableFuture<Void>();\n"; });
+            out << "enqueue(new Call() ";
+            out.block([&] {
+                out << "@Override\npublic void send() ";
+                out.block([&] {
+                    out << "Exception failure;\n";
+                    out << "synchronized (mQueue) ";
+                    out.block([&] {
+                        out << "failure = mFailure;\n"
+                            << "mFailure = null;\n";
+                    }).endl();
+                    out.sIf("failure != null", [&] {
+                        out << "done.completeExceptionally(failure);\n";
+                    }).sElse([&] {
+                        out << "done.complete(null);\n";
+                    }).endl();
+                }).endl().endl();
+
+                out << "@Override\npublic void drop(RuntimeException reason) ";
+                out.block([&] { out << "done.completeExceptionally(reason);\n"; }).endl();
+            });
+            out << ");\n";
+            out << "return done;\n";
+        }).endl().endl();
+
+        out << "private void enqueue(Call call) ";
+        out.block([&] {
+            out << "synchronized (mQueue) ";
+            out.block([&] {
+                out << "mQueue.add(call);\n";
+                out.sIf("mScheduled", [&] { out << "return;\n"; }).endl();
+                out << "mScheduled = true;\n";
+            }).endl();
+            out.sTry([&] { out << "mExecutor.execute(this::drain);\n"; })
+                    .sCatch("java.util.concurrent.RejectedExecutionException e", [&] {
+                        out << "// Nothing will send the queued calls, this one included, so drop\n"
+                            << "// them all and let the next call schedule the executor again.\n";
+                        out << "java.util.ArrayList<Call> dropped;\n";
+                        out << "synchronized (mQueue) ";
+                        out.block([&] {
+                            out << "dropped = new java.util.ArrayList<Call>(mQueue);\n"
+                                << "mQueue.clear();\n"
+                                << "mScheduled = false;\n";
+                        }).endl();
+                        out.sFor("Call queued : dropped", [&] {
+                            out << "queued.drop(e);\n";
+                        }).endl();
+                        out << "throw e;\n";
+                    })
+                    .endl();
+        }).endl().endl();
+
+        out << "private void drain() ";
+        out.block([&] {
+            out << "while (true) ";
+            out.block([&] {
+                out << "Call call;\n";
+                out << "synchronized (mQueue) ";
+                out.block([&] {
+                    out << "call = mQueue.poll();\n";
+                    out.sIf("call == null", [&] {
+                        out << "mScheduled = false;\n"
+                            << "return;\n";
+                    }).endl();
+                }).endl();
+                // A failed call must not stop the loop, or mScheduled would stay set
+                // with calls left in the queue.
+                out.sTry([&] { out << "call.send();\n"; })
+                        .sCatch("android.os.RemoteException | RuntimeException e", [&] {
+                            out << "synchronized (mQueue) ";
+                            out.block([&] {
+                                out.sIf("mFailure == null", [&] {
+                                    out << "mFailure = e;\n";
+                                }).endl();
+                            }).endl();
+                        })
+                        .endl();
+            }).endl();
+        }).endl();
+    }).endl();
+}
+
+static std::string getJavaStubReplierName(const Method* method) {
+    return (method->hasJavaArraysOverload() ? method->getJavaArraysMethodName() : method->name()) +
+           "Replier";
+}
+
+// Emits the callback that stubs hand to multi-result methods. Each binder
+// thread keeps one instance per method, which is taken for the duration of a
+// call, so reentrant calls on the same thread get their own.
+void AST::emitJavaStubReplier(Formatter& out, const Method* method) const {
+    const bool arrays = method->hasJavaArraysOverload();
+    const std::string replierName = getJavaStubReplierName(method);
+
+    out << "private static final class " << replierName << " implements "
+        << (arrays ? method->getJavaArraysMethodName() : method->name()) << "Callback ";
+    out.block([&] {
+        out << "private static final ThreadLocal<" << replierName << "> sCached =\n";
+        out.indent(2, [&] { out << "new ThreadLocal<" << replierName << ">();\n"; });
+        out << "private android.os.HwParcel _hidl_reply = null;\n\n";
+
+        out << "static " << replierName << " obtain(android.os.HwParcel reply) ";
+        out.block([&] {
+            out << replierName << " replier = sCached.get();\n";
+            out.sIf("replier == null", [&] {
+                out << "replier = new " << replierName << "();\n";
+            }).sElse([&] {
+                out << "sCached.set(null);\n";
+            }).endl();
+            out << "replier._hidl_reply = reply;\n";
+            out << "return replier;\n";
+        }).endl().endl();
+
+        out << "void recycle() ";
+        out.block([&] {
+            out << "_hidl_reply = null;\n";
+            out << "sCached.set(this);\n";
+        }).endl().endl();
+
+        out << "@Override\npublic void onValues(";
+        if (arrays) {
+            method->emitJavaArraysResultSignature(out);
+        } else {
+            method->emitJavaResultSignature(out);
+        }
+        out << ") ";
+        out.block([&] {
+            out << "_hidl_reply.writeStatus(android.os.HwParcel.STATUS_SUCCESS);\n";
+
+            for (const auto& arg : method->results()) {
+                emitJavaReaderWriter(out, "_hidl_reply", arg, false /* isReader */,
+                                     false /* addPrefixToName */, arrays);
+            }
+
+            out << "_hidl_reply.send();\n";
+        }).endl();
+    }).endl().endl();
+}
+
+// Emits ResultsStub, a Stub whose multi-result methods fill in a reusable
+// <method>Results instead of calling back.
+static void emitJavaResultsStub(Formatter& out, const Interface* iface) {
+    std::vector<const Method*> methods;
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        const Method* method = tuple.method();
+        if (method->results().size() > 1 && tuple.interface()->isJavaAsync() &&
+            method->hasJavaAsyncOverload()) {
+            methods.push_back(method);
+        }
+    }
+
+    if (methods.empty()) return;
+
+    out << "\n/**\n"
+        << " * A Stub whose methods with several results fill in a <method>Results\n"
+        << " * instead of calling a callback. The holder passed in belongs to the calling\n"
+        << " * thread and is reused by its next call, so an implementation that fills it\n"
+        << " * in and returns it serves calls without allocating. It must not be kept\n"
+        << " * after the method returns.\n"
+        << " */\n";
+    out << "public static abstract class ResultsStub extends Stub ";
+    out.block([&] {
+        for (const Method* method : methods) {
+            const std::string resultsName = method->getJavaResultsClassName();
+            const std::string cacheName =
+                    "s" + StringHelper::Capitalize(method->name()) + "Results";
+
+            out << "private static final ThreadLocal<" << resultsName << "> " << cacheName
+                << " =\n";
+            out.indent(2, [&] { out << "new ThreadLocal<" << resultsName << ">();\n"; });
+            out << "\n";
+
+            out << "public abstract " << resultsName << " " << method->name() << "(";
+            method->emitJavaArgSignature(out);
+            if (!method->args().empty()) {
+                out << ", ";
+            }
+            out << resultsName << " _hidl_results)\n";
+            out.indent(2, [&] { out << "throws android.os.RemoteException;\n"; });
+            out << "\n";
+
+            out << "@Override\npublic final ";
+            method->emitJavaSignature(out);
+            out << "\n";
+            out.indent(2, [&] { out << "throws android.os.RemoteException "; });
+            out.block([&] {
+                out << resultsName << " _hidl_results = " << cacheName << ".get();\n";
+                out.sIf("_hidl_results == null", [&] {
+                    out << "_hidl_results = new " << resultsName << "();\n";
+                }).sElse([&] {
+                    out << cacheName << ".set(null);\n";
+                }).endl();
+
+                out.sTry([&] {
+                    out << resultsName << " _hidl_out = " << method->name() << "(";
+                    for (const auto& arg : method->args()) {
+                        out << arg->name() << ", ";
+                    }
+                    out << "_hidl_results);\n";
+
+                    out << "_hidl_cb.onValues(";
+                    out.join(method->results().begin(), method->results().end(), ", ",
+                             [&](const auto& arg) { out << "_hidl_out." << arg->name(); });
+                    out << ");\n";
+                }).sFinally([&] {
+                    out << cacheName << ".set(_hidl_results);\n";
+                }).endl();
+            }).endl().endl();
+        }
+    }).endl();
+}
+
 void emitGetService(
         Formatter& out,
         const std::string& ifaceName,
@@ -262,6 +788,18 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
         out.indent();
         out << "throws android.os.RemoteException;\n";
         out.unindent();
+
+        if (method->hasJavaArraysOverload()) {
+            emitJavaArraysDefaultMethod(out, method);
+        }
+
+        if (iface->isJavaAsync() && method->hasJavaAsyncOverload()) {
+            emitJavaAsyncDefaultMethod(out, method);
+        }
+    }
+
+    if (iface->isJavaAsync()) {
+        emitJavaOnewaySender(out, iface);
     }
 
     out << "\npublic static final class Proxy implements "
@@ -271,6 +809,31 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
     out.indent();
 
     out << "private android.os.IHwBinder mRemote;\n\n";
+
+    const bool reuseParcels = iface->isJavaReuseParcels();
+    if (reuseParcels) {
+        out << "// The reply parcel of the last oneway call made on each thread, kept for\n"
+            << "// the next one (@javaReuseParcels). Oneway calls receive no reply, so it\n"
+            << "// never holds data. Replies to two-way calls are released once read,\n"
+            << "// which also frees the native parcel, so they cannot be reused.\n";
+        out << "private static final ThreadLocal<android.os.HwParcel> sHidlReplies =\n";
+        out.indent(2, [&] { out << "new ThreadLocal<android.os.HwParcel>();\n\n"; });
+
+        out << "private static android.os.HwParcel obtainHidlReply() ";
+        out.block([&] {
+            out << "android.os.HwParcel reply = sHidlReplies.get();\n";
+            out.sIf("reply == null", [&] {
+                out << "return new android.os.HwParcel();\n";
+            }).endl();
+            out << "// Calls made while this one is in flight, e.g. from a callback it\n"
+                << "// triggers on this thread, allocate their own reply.\n";
+            out << "sHidlReplies.set(null);\n";
+            out << "return reply;\n";
+        }).endl().endl();
+
+        out << "private static void recycleHidlReply(android.os.HwParcel reply) ";
+        out.block([&] { out << "sHidlReplies.set(reply);\n"; }).endl().endl();
+    }
     out << "public Proxy(android.os.IHwBinder remote) {\n";
     out.indent();
     out << "mRemote = java.util.Objects.requireNonNull(remote);\n";
@@ -318,100 +881,120 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
                 << " follow.\n";
             prevInterface = superInterface;
         }
-        const bool returnsValue = !method->results().empty();
-        const bool needsCallback = method->results().size() > 1;
+        // Methods annotated with @javaArrays also get a <method>Arrays overload.
+        for (const bool arrays : {false, true}) {
+            if (arrays && !method->hasJavaArraysOverload()) continue;
 
-        out << "@Override\npublic ";
-        method->emitJavaSignature(out);
+            const bool returnsValue = !method->results().empty();
+            const bool needsCallback = method->results().size() > 1;
 
-        out << "\n";
-        out.indent();
-        out.indent();
-        out << "throws android.os.RemoteException {\n";
-        out.unindent();
+            out << "@Override\npublic ";
+            if (arrays) {
+                method->emitJavaArraysSignature(out);
+            } else {
+                method->emitJavaSignature(out);
+            }
 
-        if (method->isHidlReserved() && method->overridesJavaImpl(IMPL_PROXY)) {
-            method->javaImpl(IMPL_PROXY, out);
+            out << "\n";
+            out.indent();
+            out.indent();
+            out << "throws android.os.RemoteException {\n";
             out.unindent();
-            out << "}\n";
-            continue;
-        }
-        out << "android.os.HwParcel _hidl_request = new android.os.HwParcel();\n";
-        out << "_hidl_request.writeInterfaceToken("
-            << superInterface->fullJavaName()
-            << ".kInterfaceName);\n";
 
-        for (const auto &arg : method->args()) {
-            emitJavaReaderWriter(
-                    out,
-                    "_hidl_request",
-                    arg,
-                    false /* isReader */,
-                    false /* addPrefixToName */);
-        }
+            if (method->isHidlReserved() && method->overridesJavaImpl(IMPL_PROXY)) {
+                method->javaImpl(IMPL_PROXY, out);
+                out.unindent();
+                out << "}\n";
+                continue;
+            }
+            out << "android.os.HwParcel _hidl_request = new android.os.HwParcel();\n";
+            out << "_hidl_request.writeInterfaceToken("
+                << superInterface->fullJavaName()
+                << ".kInterfaceName);\n";
 
-        out << "\nandroid.os.HwParcel _hidl_reply = new android.os.HwParcel();\n";
+            for (const auto &arg : method->args()) {
+                emitJavaReaderWriter(
+                        out,
+                        "_hidl_request",
+                        arg,
+                        false /* isReader */,
+                        false /* addPrefixToName */,
+                        arrays);
+            }
 
-        out.sTry([&] {
-            out << "mRemote.transact("
-                << method->getSerialId()
-                << " /* "
-                << method->name()
-                << " */, _hidl_request, _hidl_reply, ";
-
-            if (method->isOneway()) {
-                out << Interface::FLAG_ONE_WAY->javaValue();
+            const bool reuseReply = reuseParcels && method->isOneway();
+            if (reuseReply) {
+                out << "\nandroid.os.HwParcel _hidl_reply = obtainHidlReply();\n";
             } else {
-                out << "0 /* flags */";
+                out << "\nandroid.os.HwParcel _hidl_reply = new android.os.HwParcel();\n";
             }
 
-            out << ");\n";
+            out.sTry([&] {
+                out << "mRemote.transact("
+                    << method->getSerialId()
+                    << " /* "
+                    << method->name()
+                    << " */, _hidl_request, _hidl_reply, ";
 
-            if (!method->isOneway()) {
-                out << "_hidl_reply.verifySuccess();\n";
-            } else {
-                CHECK(!returnsValue);
-            }
+                if (method->isOneway()) {
+                    out << Interface::FLAG_ONE_WAY->javaValue();
+                } else {
+                    out << "0 /* flags */";
+                }
 
-            out << "_hidl_request.releaseTemporaryStorage();\n";
+                out << ");\n";
 
-            if (returnsValue) {
-                out << "\n";
-
-                for (const auto &arg : method->results()) {
-                    emitJavaReaderWriter(
-                            out,
-                            "_hidl_reply",
-                            arg,
-                            true /* isReader */,
-                            true /* addPrefixToName */);
+                if (!method->isOneway()) {
+                    out << "_hidl_reply.verifySuccess();\n";
+                } else {
+                    CHECK(!returnsValue);
                 }
 
-                if (needsCallback) {
-                    out << "_hidl_cb.onValues(";
+                out << "_hidl_request.releaseTemporaryStorage();\n";
+
+                if (returnsValue) {
+                    out << "\n";
 
-                    bool firstField = true;
                     for (const auto &arg : method->results()) {
-                        if (!firstField) {
-                            out << ", ";
+                        emitJavaReaderWriter(
+                                out,
+                                "_hidl_reply",
+                                arg,
+                                true /* isReader */,
+                                true /* addPrefixToName */,
+                                arrays);
+                    }
+
+                    if (needsCallback) {
+                        out << "_hidl_cb.onValues(";
+
+                        bool firstField = true;
+                        for (const auto &arg : method->results()) {
+                            if (!firstField) {
+                                out << ", ";
+                            }
+
+                            out << "_hidl_out_" << arg->name();
+                            firstField = false;
                         }
 
-                        out << "_hidl_out_" << arg->name();
-                        firstField = false;
+                        out << ");\n";
+                    } else {
+                        const std::string returnName = method->results()[0]->name();
+                        out << "return _hidl_out_" << returnName << ";\n";
                     }
-
-                    out << ");\n";
+                }
+            }).sFinally([&] {
+                if (reuseReply) {
+                    out << "recycleHidlReply(_hidl_reply);\n";
                 } else {
-                    const std::string returnName = method->results()[0]->name();
-                    out << "return _hidl_out_" << returnName << ";\n";
+                    out << "_hidl_reply.release();\n";
                 }
-            }
-        }).sFinally([&] {
-            out << "_hidl_reply.release();\n";
-        }).endl();
+            }).endl();
 
-        out.unindent();
-        out << "}\n\n";
+            out.unindent();
+            out << "}\n\n";
+        }
     }
 
     out.unindent();
@@ -478,6 +1061,14 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
         out << "return this.interfaceDescriptor() + \"@Stub\";\n";
     }).endl().endl();
 
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        const Method* method = tuple.method();
+        if (method->results().size() <= 1) continue;
+        if (method->isHidlReserved() && method->overridesJavaImpl(IMPL_STUB)) continue;
+
+        emitJavaStubReplier(out, method);
+    }
+
     out << "@Override\n"
         << "public void onTransact("
         << "int _hidl_code, "
@@ -520,25 +1111,39 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
             << superInterface->fullJavaName()
             << ".kInterfaceName);\n\n";
 
+        // Stubs of @javaArrays methods dispatch to <method>Arrays, so that
+        // implementations overriding it never see the boxed ArrayLists.
+        const bool arrays = method->hasJavaArraysOverload();
+
         for (const auto &arg : method->args()) {
             emitJavaReaderWriter(
                     out,
                     "_hidl_request",
                     arg,
                     true /* isReader */,
-                    false /* addPrefixToName */);
+                    false /* addPrefixToName */,
+                    arrays);
         }
 
         if (!needsCallback && returnsValue) {
             const NamedReference<Type>* returnArg = method->results()[0];
 
-            out << returnArg->type().getJavaType()
+            out << (arrays ? Method::getJavaArraysType(returnArg)
+                           : returnArg->type().getJavaType())
                 << " _hidl_out_"
                 << returnArg->name()
                 << " = ";
         }
 
-        out << method->name()
+        if (needsCallback) {
+            const std::string replierName = getJavaStubReplierName(method);
+
+            out << replierName << " _hidl_cb = " << replierName << ".obtain(_hidl_reply);\n";
+            out << "try {\n";
+            out.indent();
+        }
+
+        out << (arrays ? method->getJavaArraysMethodName() : method->name())
             << "(";
 
         bool firstField = true;
@@ -557,36 +1162,17 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
                 out << ", ";
             }
 
-            out << "new " << method->name() << "Callback() {\n";
-            out.indent();
-
-            out << "@Override\n"
-                << "public void onValues(";
-            method->emitJavaResultSignature(out);
-            out << ") {\n";
-
-            out.indent();
-            out << "_hidl_reply.writeStatus(android.os.HwParcel.STATUS_SUCCESS);\n";
-
-            for (const auto &arg : method->results()) {
-                emitJavaReaderWriter(
-                        out,
-                        "_hidl_reply",
-                        arg,
-                        false /* isReader */,
-                        false /* addPrefixToName */);
-                // no need to add _hidl_out because out vars are are scoped
-            }
+            out << "_hidl_cb";
+        }
 
-            out << "_hidl_reply.send();\n"
-                      << "}}";
+        out << ");\n";
 
+        if (needsCallback) {
             out.unindent();
-            out.unindent();
+            out << "} finally ";
+            out.block([&] { out << "_hidl_cb.recycle();\n"; }).endl();
         }
 
-        out << ");\n";
-
         if (!needsCallback && !method->isOneway()) {
             out << "_hidl_reply.writeStatus(android.os.HwParcel.STATUS_SUCCESS);\n";
 
@@ -598,7 +1184,8 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
                         "_hidl_reply",
                         returnArg,
                         false /* isReader */,
-                        true /* addPrefixToName */);
+                        true /* addPrefixToName */,
+                        arrays);
             }
 
             out << "_hidl_reply.send();\n";
@@ -618,6 +1205,10 @@ void AST::generateJava(Formatter& out, const std::string& limitToType) const {
     out.unindent();
     out << "}\n";
 
+    if (iface->isJavaAsync()) {
+        emitJavaResultsStub(out, iface);
+    }
+
     out.unindent();
     out << "}\n";
 }
@@ -1045,6 +1045,14 @@ static const std::vector<FileGenerator> kCppAdapterSourceFormats = {
     },
 };
 
+static const std::vector<FileGenerator> kCppBenchmarkSourceFormats = {
+    {
+        FileGenerator::generateForInterfaces,
+        [](const FQName& fqName) { return fqName.getInterfaceBaseName() + "Benchmark.cpp"; },
+        astGenerationFunction(&AST::generateCppBenchmarkSource),
+    },
+};
+
 static const std::vector<OutputHandler> kFormats = {
     {
         "check",
@@ -1160,6 +1168,16 @@ static const std::vector<OutputHandler> kFormats = {
         validateIsPackage,
         {singleFileGenerator("main.cpp", generateAdapterMainSource)},
     },
+    {
+        "c++-benchmark",
+        "Generates a google-benchmark source per interface, calling every method in passthrough "
+        "mode and through an in-process proxy and stub.",
+        OutputMode::NEEDS_DIR,
+        Coordinator::Location::DIRECT,
+        GenerationGranularity::PER_FILE,
+        validateForSource,
+        kCppBenchmarkSourceFormats,
+    },
     {
         "java",
         "(internal) Generates Java library for talking to HIDL interfaces in Java.",
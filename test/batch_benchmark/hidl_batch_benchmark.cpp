@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the throughput of a oneway method annotated with @batch against the
+// same method without it.
+//
+// The service runs in a child process, so this measures what batching saves
+// in marshalling, dispatch and driver round trips: one interface token, one
+// parcel and one transaction per batch instead of per call.
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <hidl/HidlTransportSupport.h>
+#include <hidl/ServiceManagement.h>
+#include <hidl/tests/batch/1.0/IBatch.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+
+using ::android::sp;
+using ::android::hardware::configureRpcThreadpool;
+using ::android::hardware::hidl_string;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::joinRpcThreadpool;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::android::hardware::details::waitForHwService;
+using ::hidl::tests::batch::V1_0::IBatch;
+
+struct Batch : public IBatch {
+    Return<void> onEvent(int32_t /* id */, int64_t /* timestampNs */) override {
+        mCount++;
+        return Void();
+    }
+
+    Return<void> onEventUnbatched(int32_t /* id */, int64_t /* timestampNs */) override {
+        mCount++;
+        return Void();
+    }
+
+    Return<void> onNamedEvent(const hidl_string& /* name */,
+                              const hidl_vec<int32_t>& /* ids */) override {
+        mCount++;
+        return Void();
+    }
+
+    Return<uint64_t> getCount() override { return mCount.load(); }
+
+    Return<void> getEvents(getEvents_cb _hidl_cb) override {
+        _hidl_cb({}, mCount.load());
+        return Void();
+    }
+
+    Return<void> getNamedEvents(getNamedEvents_cb _hidl_cb) override {
+        _hidl_cb({}, {});
+        return Void();
+    }
+
+  private:
+    std::atomic<uint64_t> mCount{0};
+};
+
+static constexpr char kInstance[] = "hidl_batch_benchmark";
+
+// Oneway calls queue up in the service's async buffer, which a sender that
+// never waits could fill. Both benchmarks wait for the service this often.
+static constexpr int64_t kCallsPerSync = 1024;
+
+static sp<IBatch> getService() {
+    sp<IBatch> service = IBatch::getService(kInstance);
+    CHECK(service != nullptr);
+    CHECK(service->isRemote());
+    return service;
+}
+
+static void BM_OnewayUnbatched(benchmark::State& state) {
+    sp<IBatch> proxy = getService();
+    const uint64_t before = proxy->getCount();
+    int64_t calls = 0;
+
+    for (auto _ : state) {
+        CHECK(proxy->onEventUnbatched(1, calls++).isOk());
+        if (calls % kCallsPerSync == 0) CHECK(proxy->getCount().isOk());
+    }
+    CHECK_EQ(static_cast<uint64_t>(proxy->getCount()), before + calls);
+
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_OnewayUnbatched);
+
+static void BM_OnewayBatched(benchmark::State& state) {
+    sp<IBatch> proxy = getService();
+    // Negotiate outside of the timed loop.
+    CHECK(proxy->onEvent(0, 0).isOk());
+    const uint64_t before = proxy->getCount();
+    int64_t calls = 0;
+
+    for (auto _ : state) {
+        CHECK(proxy->onEvent(1, calls++).isOk());
+        if (calls % kCallsPerSync == 0) CHECK(proxy->getCount().isOk());
+    }
+    // getCount flushes whatever is still queued.
+    CHECK_EQ(static_cast<uint64_t>(proxy->getCount()), before + calls);
+
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_OnewayBatched);
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+
+    pid_t pid = fork();
+    CHECK_NE(-1, pid);
+    if (pid == 0) {
+        configureRpcThreadpool(1, true /* callerWillJoin */);
+        sp<IBatch> service = new Batch();
+        CHECK_EQ(::android::OK, service->registerAsService(kInstance));
+        joinRpcThreadpool();
+        return EXIT_FAILURE;
+    }
+
+    waitForHwService(IBatch::descriptor, kInstance);
+    ::benchmark::RunSpecifiedBenchmarks();
+
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+    return EXIT_SUCCESS;
+}
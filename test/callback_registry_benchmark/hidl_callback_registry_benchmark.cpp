@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures marshalling of vec<ICallback> in both directions, with vectors of
+// the sizes that multi-client registries return, and with callbacks repeated
+// as when one client registers for several events.
+//
+// The registries run in a child process. setCallbacks() sends callbacks that
+// the service reads as remote binders, and getCallbacks() on the "hosting"
+// instance returns callbacks that the client reads as remote binders, so both
+// directions create one proxy per distinct binder.
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <hidl/HidlTransportSupport.h>
+#include <hidl/ServiceManagement.h>
+#include <hidl/tests/callback_registry/1.0/ICallback.h>
+#include <hidl/tests/callback_registry/1.0/IRegistry.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <map>
+#include <vector>
+
+using ::android::sp;
+using ::android::hardware::configureRpcThreadpool;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::joinRpcThreadpool;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::android::hardware::details::waitForHwService;
+using ::hidl::tests::callback_registry::V1_0::ICallback;
+using ::hidl::tests::callback_registry::V1_0::IRegistry;
+
+struct Callback : public ICallback {
+    Return<void> onEvent(int32_t /* id */) override { return Void(); }
+};
+
+struct Registry : public IRegistry {
+    Return<void> setCallbacks(const hidl_vec<sp<ICallback>>& callbacks) override {
+        mCallbacks = callbacks;
+        return Void();
+    }
+
+    Return<void> getCallbacks(getCallbacks_cb _hidl_cb) override {
+        _hidl_cb(mCallbacks);
+        return Void();
+    }
+
+    Return<void> addCallback(const sp<ICallback>& callback) override {
+        std::vector<sp<ICallback>> callbacks = mCallbacks;
+        callbacks.push_back(callback);
+        mCallbacks = callbacks;
+        return Void();
+    }
+
+  protected:
+    hidl_vec<sp<ICallback>> mCallbacks;
+};
+
+// Keeps callbacks of its own in place of those it is given, one for each
+// distinct callback, so that getCallbacks() returns binders it hosts.
+struct HostingRegistry : public Registry {
+    Return<void> setCallbacks(const hidl_vec<sp<ICallback>>& callbacks) override {
+        std::map<ICallback*, sp<ICallback>> hosted;
+        mCallbacks.resize(callbacks.size());
+        for (size_t i = 0; i < callbacks.size(); i++) {
+            sp<ICallback>& callback = hosted[callbacks[i].get()];
+            if (callback == nullptr) callback = new Callback();
+            mCallbacks[i] = callback;
+        }
+        return Void();
+    }
+};
+
+static constexpr char kInstance[] = "default";
+static constexpr char kHostingInstance[] = "hosting";
+
+static sp<IRegistry> getService(const char* instance) {
+    sp<IRegistry> service = IRegistry::getService(instance);
+    CHECK(service != nullptr);
+    CHECK(service->isRemote());
+    return service;
+}
+
+// count callbacks, which repeat the first distinct ones in turn.
+static hidl_vec<sp<ICallback>> makeCallbacks(size_t count, size_t distinct) {
+    std::vector<sp<ICallback>> created(distinct);
+    for (auto& callback : created) {
+        callback = new Callback();
+    }
+
+    hidl_vec<sp<ICallback>> callbacks(count);
+    for (size_t i = 0; i < count; i++) {
+        callbacks[i] = created[i % distinct];
+    }
+    return callbacks;
+}
+
+// Arguments are the number of callbacks and the number of distinct ones.
+static void callbackArgs(benchmark::internal::Benchmark* b) {
+    b->Args({16, 16})->Args({256, 256})->Args({1024, 1024})->Args({1024, 16});
+}
+
+static void BM_SetCallbacks(benchmark::State& state) {
+    sp<IRegistry> proxy = getService(kInstance);
+    hidl_vec<sp<ICallback>> callbacks = makeCallbacks(state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        CHECK(proxy->setCallbacks(callbacks).isOk());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SetCallbacks)->Apply(callbackArgs);
+
+static void BM_GetCallbacks(benchmark::State& state) {
+    sp<IRegistry> proxy = getService(kHostingInstance);
+    CHECK(proxy->setCallbacks(makeCallbacks(state.range(0), state.range(1))).isOk());
+
+    for (auto _ : state) {
+        size_t count = 0;
+        CHECK(proxy->getCallbacks([&](const auto& callbacks) { count = callbacks.size(); })
+                      .isOk());
+        CHECK_EQ(count, static_cast<size_t>(state.range(0)));
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetCallbacks)->Apply(callbackArgs);
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+
+    pid_t pid = fork();
+    CHECK_NE(-1, pid);
+    if (pid == 0) {
+        configureRpcThreadpool(1, true /* callerWillJoin */);
+        sp<IRegistry> registry = new Registry();
+        CHECK_EQ(::android::OK, registry->registerAsService(kInstance));
+        sp<IRegistry> hosting = new HostingRegistry();
+        CHECK_EQ(::android::OK, hosting->registerAsService(kHostingInstance));
+        joinRpcThreadpool();
+        return EXIT_FAILURE;
+    }
+
+    waitForHwService(IRegistry::descriptor, kInstance);
+    waitForHwService(IRegistry::descriptor, kHostingInstance);
+    ::benchmark::RunSpecifiedBenchmarks();
+
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+    return EXIT_SUCCESS;
+}
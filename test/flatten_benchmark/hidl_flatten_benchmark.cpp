@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the classic and @flatten encodings of vec<Entry>, where every
+// entry holds a string and a vec. The classic encoding writes two buffers per
+// entry plus one for the vector; the flattened one writes a single buffer.
+//
+// The service runs in a child process, so every call goes through the driver,
+// which fixes up each buffer of the classic encoding.
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <hidl/HidlTransportSupport.h>
+#include <hidl/ServiceManagement.h>
+#include <hidl/tests/flatten/1.0/IFlatten.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+using ::android::sp;
+using ::android::hardware::configureRpcThreadpool;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::joinRpcThreadpool;
+using ::android::hardware::Return;
+using ::android::hardware::details::waitForHwService;
+using ::hidl::tests::flatten::V1_0::Entry;
+using ::hidl::tests::flatten::V1_0::IFlatten;
+
+struct Flatten : public IFlatten {
+    Return<uint32_t> put(const hidl_vec<Entry>& entries) override { return entries.size(); }
+
+    Return<uint32_t> putFlat(const hidl_vec<Entry>& entries) override { return entries.size(); }
+
+    Return<void> get(get_cb _hidl_cb) override {
+        _hidl_cb(mEntries);
+        return Return<void>();
+    }
+
+    Return<void> getFlat(getFlat_cb _hidl_cb) override {
+        _hidl_cb(mEntries);
+        return Return<void>();
+    }
+
+    hidl_vec<Entry> mEntries;
+};
+
+// Sizes passed to the benchmarks below. The service registers one instance
+// per size, named after it, whose get() and getFlat() return that many entries.
+static constexpr int64_t kSizes[] = {16, 256, 1024};
+
+static hidl_vec<Entry> makeEntries(size_t count) {
+    hidl_vec<Entry> entries(count);
+    for (size_t i = 0; i < count; i++) {
+        entries[i].key = "key" + std::to_string(i);
+        entries[i].value = std::vector<uint8_t>(32, static_cast<uint8_t>(i));
+        entries[i].flags = i;
+    }
+    return entries;
+}
+
+static sp<IFlatten> getService(int64_t size) {
+    sp<IFlatten> service = IFlatten::getService(std::to_string(size));
+    CHECK(service != nullptr);
+    CHECK(service->isRemote());
+    return service;
+}
+
+template <bool kFlat>
+static void BM_Put(benchmark::State& state) {
+    sp<IFlatten> proxy = getService(state.range(0));
+    hidl_vec<Entry> entries = makeEntries(state.range(0));
+
+    for (auto _ : state) {
+        Return<uint32_t> count = kFlat ? proxy->putFlat(entries) : proxy->put(entries);
+        CHECK_EQ(static_cast<uint32_t>(count), entries.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Put, false)->Arg(16)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Put, true)->Arg(16)->Arg(256)->Arg(1024);
+
+template <bool kFlat>
+static void BM_Get(benchmark::State& state) {
+    sp<IFlatten> proxy = getService(state.range(0));
+
+    for (auto _ : state) {
+        size_t count = 0;
+        auto cb = [&](const hidl_vec<Entry>& entries) { count = entries.size(); };
+        CHECK((kFlat ? proxy->getFlat(cb) : proxy->get(cb)).isOk());
+        CHECK_EQ(count, static_cast<size_t>(state.range(0)));
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Get, false)->Arg(16)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Get, true)->Arg(16)->Arg(256)->Arg(1024);
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+
+    pid_t pid = fork();
+    CHECK_NE(-1, pid);
+    if (pid == 0) {
+        configureRpcThreadpool(1, true /* callerWillJoin */);
+        for (int64_t size : kSizes) {
+            sp<Flatten> service = new Flatten();
+            service->mEntries = makeEntries(size);
+            CHECK_EQ(::android::OK, service->registerAsService(std::to_string(size)));
+        }
+        joinRpcThreadpool();
+        return EXIT_FAILURE;
+    }
+
+    for (int64_t size : kSizes) {
+        waitForHwService(IFlatten::descriptor, std::to_string(size));
+    }
+    ::benchmark::RunSpecifiedBenchmarks();
+
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Throughput of the queue helpers generated for IQueues, for batches of
+// messages of each queue type. Both ends live in this process; the blocking
+// benchmark runs them on two threads, so that readers and writers wait on the
+// queue's event flag.
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <hidl/tests/fmq_helpers/1.0/IQueues.h>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using ::android::hardware::kSynchronizedReadWrite;
+using ::android::hardware::kUnsynchronizedWrite;
+using ::android::hardware::MessageQueue;
+using ::hidl::tests::fmq_helpers::V1_0::IQueues;
+using ::hidl::tests::fmq_helpers::V1_0::Sample;
+
+using SampleQueue = MessageQueue<Sample, kSynchronizedReadWrite>;
+using EventQueue = MessageQueue<uint32_t, kUnsynchronizedWrite>;
+
+static constexpr size_t kCapacity = 4096;
+
+static std::vector<Sample> makeSamples(size_t count) {
+    std::vector<Sample> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = {i * 1000, static_cast<float>(i), static_cast<uint32_t>(i % 4)};
+    }
+    return samples;
+}
+
+static void BM_SyncWriteRead(benchmark::State& state) {
+    auto queue = std::make_shared<SampleQueue>(kCapacity, true /* configureEventFlagWord */);
+    IQueues::getSampleQueue_samples_writer writer(queue);
+    IQueues::getSampleQueue_samples_reader reader(*queue->getDesc());
+    CHECK(writer.isValid() && reader.isValid());
+
+    const size_t batch = state.range(0);
+    std::vector<Sample> in = makeSamples(batch);
+    std::vector<Sample> out(batch);
+
+    for (auto _ : state) {
+        CHECK(writer.write(in.data(), batch));
+        CHECK(reader.read(out.data(), batch));
+    }
+
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.SetBytesProcessed(state.iterations() * batch * sizeof(Sample));
+}
+BENCHMARK(BM_SyncWriteRead)->Arg(1)->Arg(16)->Arg(256)->Arg(2048);
+
+static void BM_SyncInPlace(benchmark::State& state) {
+    auto queue = std::make_shared<SampleQueue>(kCapacity, true /* configureEventFlagWord */);
+    IQueues::getSampleQueue_samples_writer writer(queue);
+    IQueues::getSampleQueue_samples_reader reader(*queue->getDesc());
+    CHECK(writer.isValid() && reader.isValid());
+
+    const size_t batch = state.range(0);
+    uint64_t sum = 0;
+
+    for (auto _ : state) {
+        CHECK(writer.writeInPlace(batch, [](Sample* slots, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                slots[i] = {i, 1.0f, 0};
+            }
+        }));
+        CHECK(reader.readInPlace(batch, [&](const Sample* slots, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                sum += slots[i].timestampNs;
+            }
+        }));
+    }
+
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.SetBytesProcessed(state.iterations() * batch * sizeof(Sample));
+}
+BENCHMARK(BM_SyncInPlace)->Arg(1)->Arg(16)->Arg(256)->Arg(2048);
+
+static void BM_SyncBlocking(benchmark::State& state) {
+    auto queue = std::make_shared<SampleQueue>(kCapacity, true /* configureEventFlagWord */);
+    IQueues::getSampleQueue_samples_writer writer(queue);
+    IQueues::getSampleQueue_samples_reader reader(*queue->getDesc());
+    CHECK(writer.isValid() && reader.isValid());
+
+    const size_t batch = state.range(0);
+    std::vector<Sample> in = makeSamples(batch);
+    std::vector<Sample> out(batch);
+
+    // The writer ends with a batch on channel UINT32_MAX, which stops the consumer.
+    std::thread consumer([&] {
+        while (reader.readBlocking(out.data(), batch) && out[0].channel != UINT32_MAX) {
+        }
+    });
+
+    for (auto _ : state) {
+        CHECK(writer.writeBlocking(in.data(), batch));
+    }
+
+    std::vector<Sample> last(batch, Sample{0, 0.0f, UINT32_MAX});
+    CHECK(writer.writeBlocking(last.data(), batch));
+    consumer.join();
+
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.SetBytesProcessed(state.iterations() * batch * sizeof(Sample));
+}
+BENCHMARK(BM_SyncBlocking)->Arg(1)->Arg(16)->Arg(256)->Arg(2048)->UseRealTime();
+
+static void BM_UnsyncWriteRead(benchmark::State& state) {
+    auto queue = std::make_shared<EventQueue>(kCapacity, true /* configureEventFlagWord */);
+    IQueues::setEventQueue_events_writer writer(queue);
+    IQueues::setEventQueue_events_reader reader(*queue->getDesc());
+    CHECK(writer.isValid() && reader.isValid());
+
+    const size_t batch = state.range(0);
+    std::vector<uint32_t> in(batch, 7);
+    std::vector<uint32_t> out(batch);
+
+    for (auto _ : state) {
+        CHECK(writer.write(in.data(), batch));
+        CHECK_EQ(reader.readSome(out.data(), batch), batch);
+    }
+
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.SetBytesProcessed(state.iterations() * batch * sizeof(uint32_t));
+}
+BENCHMARK(BM_UnsyncWriteRead)->Arg(1)->Arg(16)->Arg(256)->Arg(2048);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks when the blocking reads and writes of the queue helpers generated for
+// IQueues succeed, time out, or fail at once.
+
+#include <gtest/gtest.h>
+#include <hidl/tests/fmq_helpers/1.0/IQueues.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using ::android::hardware::kSynchronizedReadWrite;
+using ::android::hardware::kUnsynchronizedWrite;
+using ::android::hardware::MessageQueue;
+using ::android::hardware::details::hidl_fmq_wait_policy;
+using ::hidl::tests::fmq_helpers::V1_0::IQueues;
+using ::hidl::tests::fmq_helpers::V1_0::Sample;
+
+using SampleQueue = MessageQueue<Sample, kSynchronizedReadWrite>;
+using EventQueue = MessageQueue<uint32_t, kUnsynchronizedWrite>;
+using SampleWriter = IQueues::getSampleQueue_samples_writer;
+using SampleReader = IQueues::getSampleQueue_samples_reader;
+
+static constexpr size_t kCapacity = 16;
+static constexpr auto kTimeout = std::chrono::milliseconds(20);
+
+class FmqHelpersTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        queue = std::make_shared<SampleQueue>(kCapacity, true /* configureEventFlagWord */);
+        ASSERT_TRUE(queue->isValid());
+    }
+
+    static hidl_fmq_wait_policy timeoutPolicy() {
+        hidl_fmq_wait_policy policy;
+        policy.timeoutNanos = std::chrono::nanoseconds(kTimeout).count();
+        return policy;
+    }
+
+    static std::vector<Sample> makeSamples(size_t count) {
+        std::vector<Sample> samples(count);
+        for (size_t i = 0; i < count; i++) {
+            samples[i] = {i, static_cast<float>(i), static_cast<uint32_t>(i)};
+        }
+        return samples;
+    }
+
+    std::shared_ptr<SampleQueue> queue;
+};
+
+TEST_F(FmqHelpersTest, BlockingReadWaitsForWriter) {
+    SampleWriter writer(queue);
+    SampleReader reader(*queue->getDesc());
+    ASSERT_TRUE(writer.isValid() && reader.isValid());
+
+    const std::vector<Sample> in = makeSamples(kCapacity);
+    std::vector<Sample> out(kCapacity);
+    auto read = std::async(std::launch::async,
+                           [&] { return reader.readBlocking(out.data(), out.size()); });
+    std::this_thread::sleep_for(kTimeout);
+    EXPECT_TRUE(writer.writeBlocking(in.data(), in.size()));
+
+    ASSERT_EQ(std::future_status::ready, read.wait_for(std::chrono::seconds(5)));
+    EXPECT_TRUE(read.get());
+    for (size_t i = 0; i < kCapacity; i++) {
+        EXPECT_EQ(in[i].timestampNs, out[i].timestampNs);
+    }
+}
+
+TEST_F(FmqHelpersTest, BlockingWriteWaitsForReader) {
+    SampleWriter writer(queue);
+    SampleReader reader(*queue->getDesc());
+
+    const std::vector<Sample> in = makeSamples(kCapacity);
+    ASSERT_TRUE(writer.write(in.data(), in.size()));
+    auto write = std::async(std::launch::async, [&] { return writer.writeBlocking(in.data(), 1); });
+    EXPECT_EQ(std::future_status::timeout, write.wait_for(kTimeout));
+
+    std::vector<Sample> out(1);
+    EXPECT_TRUE(reader.read(out.data(), out.size()));
+    ASSERT_EQ(std::future_status::ready, write.wait_for(std::chrono::seconds(5)));
+    EXPECT_TRUE(write.get());
+}
+
+TEST_F(FmqHelpersTest, BlockingReadTimesOut) {
+    SampleReader reader(*queue->getDesc(), timeoutPolicy());
+
+    std::vector<Sample> out(1);
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(reader.readBlocking(out.data(), out.size()));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, kTimeout);
+}
+
+TEST_F(FmqHelpersTest, BlockingWriteTimesOut) {
+    SampleWriter writer(queue, timeoutPolicy());
+
+    const std::vector<Sample> in = makeSamples(kCapacity);
+    ASSERT_TRUE(writer.write(in.data(), in.size()));
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(writer.writeBlocking(in.data(), 1));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, kTimeout);
+}
+
+// Without a timeout, these would otherwise wait forever.
+TEST_F(FmqHelpersTest, MoreThanCapacityFailsAtOnce) {
+    SampleWriter writer(queue);
+    SampleReader reader(*queue->getDesc());
+
+    std::vector<Sample> samples = makeSamples(kCapacity + 1);
+    auto both = std::async(std::launch::async, [&] {
+        return writer.writeBlocking(samples.data(), samples.size()) ||
+               reader.readBlocking(samples.data(), samples.size());
+    });
+    ASSERT_EQ(std::future_status::ready, both.wait_for(std::chrono::seconds(5)));
+    EXPECT_FALSE(both.get());
+
+    auto events = std::make_shared<EventQueue>(kCapacity, true /* configureEventFlagWord */);
+    IQueues::setEventQueue_events_writer eventWriter(events);
+    std::vector<uint32_t> ids(kCapacity + 1);
+    EXPECT_FALSE(eventWriter.writeBlocking(ids.data(), ids.size()));
+    EXPECT_TRUE(eventWriter.writeBlocking(ids.data(), kCapacity));
+}
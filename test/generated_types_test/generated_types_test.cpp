@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <hidl/tests/bytewise_struct/1.0/types.h>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using ::android::hardware::details::hidl_type_info;
+using ::android::hardware::details::hidl_type_kind;
+using ::hidl::tests::bytewise_struct::V1_0::Mode;
+using ::hidl::tests::bytewise_struct::V1_0::Packed;
+using ::hidl::tests::bytewise_struct::V1_0::Padded;
+using ::hidl::tests::bytewise_struct::V1_0::Record;
+using ::hidl::tests::bytewise_struct::V1_0::Value;
+
+TEST(GeneratedTypesTest, PackedEquality) {
+    Packed a = {};
+    a.id = 1;
+    a.mode = Mode::ON;
+    Packed b = a;
+    EXPECT_EQ(a, b);
+    b.tag[7] = 1;
+    EXPECT_NE(a, b);
+}
+
+TEST(GeneratedTypesTest, HashMatchesEquality) {
+    Record a;
+    a.name = "record";
+    a.values = {1, 2, 3};
+    a.packed.id = 4;
+    a.padded.flag = true;
+    a.weight = 0.5f;
+    Record b = a;
+
+    ASSERT_EQ(a, b);
+    EXPECT_EQ(std::hash<Record>()(a), std::hash<Record>()(b));
+
+    std::unordered_set<Record> records = {a};
+    EXPECT_EQ(1u, records.count(b));
+    b.values[2] = 4;
+    EXPECT_EQ(0u, records.count(b));
+}
+
+TEST(GeneratedTypesTest, StructTypeInfo) {
+    using Info = hidl_type_info<Padded>;
+    EXPECT_STREQ("hidl.tests.bytewise_struct@1.0::Padded", Info::name);
+    EXPECT_EQ(hidl_type_kind::STRUCT, Info::kind);
+    ASSERT_EQ(2u, Info::fields.size());
+    EXPECT_STREQ("id", Info::fields[1].name);
+    EXPECT_STREQ("uint64_t", Info::fields[1].type);
+    EXPECT_EQ(offsetof(Padded, id), Info::fields[1].offset);
+    EXPECT_EQ(sizeof(uint64_t), Info::fields[1].size);
+
+    using RecordInfo = hidl_type_info<Record>;
+    EXPECT_STREQ("string", RecordInfo::fields[0].type);
+    EXPECT_STREQ("vec<uint32_t>", RecordInfo::fields[1].type);
+    EXPECT_EQ(hidl_type_kind::VECTOR, RecordInfo::fields[1].kind);
+    EXPECT_STREQ("Packed", RecordInfo::fields[2].type);
+    EXPECT_STREQ("uint8_t[8]", hidl_type_info<Packed>::fields[3].type);
+    EXPECT_EQ(hidl_type_kind::ARRAY, hidl_type_info<Packed>::fields[3].kind);
+    EXPECT_EQ(sizeof(uint8_t[8]), hidl_type_info<Packed>::fields[3].size);
+
+    static_assert(hidl_type_info<Record>::fields[2].kind == hidl_type_kind::STRUCT,
+                  "field kinds are constant expressions");
+
+    Padded padded = {};
+    padded.id = 7;
+    std::vector<std::string> names;
+    hidl_type_info<Padded>::forEachField(padded, [&](const auto& field, const auto& value) {
+        names.push_back(field.name);
+        if (field.offset == offsetof(Padded, id)) {
+            EXPECT_EQ(7u, static_cast<uint64_t>(value));
+        }
+    });
+    EXPECT_EQ((std::vector<std::string>{"flag", "id"}), names);
+}
+
+TEST(GeneratedTypesTest, SafeUnionVisitsActiveField) {
+    Value value;
+    value.text("text");
+    std::vector<std::string> names;
+    hidl_type_info<Value>::forEachField(value, [&](const auto& field, const auto&) {
+        names.push_back(field.name);
+    });
+    EXPECT_EQ((std::vector<std::string>{"text"}), names);
+}
+
+TEST(GeneratedTypesTest, EnumTypeInfo) {
+    using Info = hidl_type_info<Mode>;
+    EXPECT_EQ(hidl_type_kind::ENUM, Info::kind);
+    ASSERT_EQ(2u, Info::enumerators.size());
+    EXPECT_EQ(Mode::ON, Info::enumerators[1].value);
+    EXPECT_STREQ("ON", Info::enumerators[1].name);
+}
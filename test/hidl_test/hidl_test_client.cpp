@@ -629,6 +629,16 @@ TEST_F(HidlTest, EnumToStringTest) {
     EXPECT_EQ(toString(EmptyChild::A), "A"s);
     EXPECT_EQ(toString(Grandchild::A), "A"s);
     EXPECT_EQ(toString(Grandchild::B), "B"s);
+
+    // append to an existing buffer
+    using ::android::hardware::tests::foo::V1_0::appendToString;
+    std::string buffer = "flags: ";
+    appendToString<IFoo::BitField>((uint8_t)0 | IFoo::BitField::V0 | IFoo::BitField::V2, &buffer);
+    buffer += ", value: ";
+    appendToString(IFoo::BitField::V1, &buffer);
+    buffer += ", invalid: ";
+    appendToString(static_cast<IFoo::BitField>(0), &buffer);
+    EXPECT_EQ(buffer, "flags: V0 | V2 (0x5), value: V1, invalid: 0"s);
 }
 
 TEST_F(HidlTest, PingTest) {
@@ -1351,6 +1361,22 @@ TEST_F(HidlTest, FooHaveAStringVecTest) {
     ALOGI("CLIENT haveAStringVec returned.");
 }
 
+TEST_F(HidlTest, FooHaveAStringVecResultsTest) {
+    hidl_vec<hidl_string> stringVecParam;
+    stringVecParam.resize(3);
+    stringVecParam[0] = "What";
+    stringVecParam[1] = "a";
+    stringVecParam[2] = "disaster";
+
+    IFoo::haveAStringVec_results results;
+    EXPECT_OK(foo->haveAStringVec_toResults(stringVecParam, results));
+    EXPECT_EQ(to_string(results.result), "['Hello', 'World']");
+
+    // The same results object can be reused across calls.
+    EXPECT_OK(foo->haveAStringVec_toResults(stringVecParam, results));
+    EXPECT_EQ(to_string(results.result), "['Hello', 'World']");
+}
+
 TEST_F(HidlTest, FooTransposeMeTest) {
     hidl_array<float, 3, 5> in;
     float k = 1.0f;
@@ -1821,6 +1847,35 @@ TEST_F(HidlTest, InheritLocalChildTest) {
     expectGoodChild(ret);
 }
 
+TEST_F(HidlTest, FooHaveAVectorOfDuplicateInterfacesTest) {
+    // In binderized mode, the child is hosted by another process and comes back
+    // as a remote binder, while Simple comes back as the client's own object.
+    sp<IChild> child = fetcher->getChild(true /* sendRemote */);
+    ASSERT_NE(child.get(), nullptr);
+    sp<ISimple> simple = new Simple(7);
+
+    hidl_vec<sp<IBase>> in = {child, simple, child, simple, child};
+
+    EXPECT_OK(foo->haveAVectorOfGenericInterfaces(in, [&](const auto& out) {
+        ASSERT_EQ(in.size(), out.size());
+
+        // Copies of one binder share a proxy.
+        EXPECT_EQ(out[0].get(), out[2].get());
+        EXPECT_EQ(out[0].get(), out[4].get());
+        EXPECT_EQ(child->isRemote(), out[0]->isRemote());
+        EXPECT_EQ(static_cast<IBase*>(simple.get()), out[1].get());
+        EXPECT_EQ(static_cast<IBase*>(simple.get()), out[3].get());
+
+        for (const auto& element : out) {
+            EXPECT_OK(element->ping());
+        }
+        expectGoodChild(IChild::castFrom(out[4]));
+        sp<ISimple> outSimple = ISimple::castFrom(out[3]);
+        ASSERT_NE(outSimple.get(), nullptr);
+        EXPECT_EQ(7, static_cast<int32_t>(outSimple->getCookie()));
+    }));
+}
+
 TEST_F(HidlTest, TestArrayDimensionality) {
     hidl_array<int, 2> oneDim;
     hidl_array<int, 2, 3> twoDim;
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Awaits hidl.tests.async@1.0 calls from C++20 coroutines, through the
+// generated proxy and stub joined in-process by a LoopbackBinder.
+
+#define LOG_TAG "hidl_coroutine_host_test"
+
+#include <gtest/gtest.h>
+#include <hidl-loopback/Loopback.h>
+#include <hidl/tests/async/1.0/BnHwAsync.h>
+#include <hidl/tests/async/1.0/BpHwAsync.h>
+#include <hidl/tests/async/1.0/IAsync.h>
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+using ::android::sp;
+using ::android::hardware::hidl_string;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::LoopbackBinder;
+using ::android::hardware::makeLoopback;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::hidl::tests::async::V1_0::BnHwAsync;
+using ::hidl::tests::async::V1_0::BpHwAsync;
+using ::hidl::tests::async::V1_0::IAsync;
+
+using Executor = std::function<void(std::function<void(void)>)>;
+
+struct Async : public IAsync {
+    Return<int32_t> add(int32_t a, int32_t b) override { return a + b; }
+
+    Return<void> divide(int32_t a, int32_t b, divide_cb _hidl_cb) override {
+        _hidl_cb(a / b, a % b);
+        return Void();
+    }
+
+    Return<void> join(const hidl_vec<hidl_string>& parts, join_cb _hidl_cb) override {
+        std::string joined;
+        for (const auto& part : parts) {
+            joined += part;
+        }
+        _hidl_cb(joined);
+        return Void();
+    }
+
+    Return<int32_t> subtract(int32_t a, int32_t b) override { return a - b; }
+};
+
+// A coroutine which starts straight away and destroys itself when it returns.
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+struct Outcome {
+    int32_t sum = 0;
+    int32_t quotient = 0;
+    int32_t remainder = 0;
+    std::string joined;
+    std::thread::id resumedOn;
+};
+
+Task awaitCalls(sp<IAsync> async, Executor executor, std::shared_ptr<std::promise<Outcome>> done) {
+    Outcome outcome;
+
+    Return<int32_t> sum = co_await async->add_async(2, 3, executor);
+    outcome.sum = sum.isOk() ? static_cast<int32_t>(sum) : -1;
+
+    IAsync::divide_results divided;
+    Return<void> divideRet = co_await async->divide_async(7, 2, divided, executor);
+    if (divideRet.isOk()) {
+        outcome.quotient = divided.quotient;
+        outcome.remainder = divided.remainder;
+    }
+
+    IAsync::join_results joined;
+    Return<void> joinRet =
+            co_await async->join_async(hidl_vec<hidl_string>{"a", "b", "c"}, joined, executor);
+    if (joinRet.isOk()) {
+        outcome.joined = joined.joined;
+    }
+
+    outcome.resumedOn = std::this_thread::get_id();
+    done->set_value(std::move(outcome));
+}
+
+static void expectResults(const Outcome& outcome) {
+    EXPECT_EQ(5, outcome.sum);
+    EXPECT_EQ(3, outcome.quotient);
+    EXPECT_EQ(1, outcome.remainder);
+    EXPECT_EQ("abc", outcome.joined);
+}
+
+class CoroutineTest : public ::testing::Test {
+  public:
+    void SetUp() override {
+        async = makeLoopback<BpHwAsync, BnHwAsync>(new Async(), &binder);
+        ASSERT_NE(nullptr, async.get());
+    }
+
+    sp<IAsync> async;
+    sp<LoopbackBinder> binder;
+};
+
+TEST_F(CoroutineTest, InlineExecutor) {
+    auto done = std::make_shared<std::promise<Outcome>>();
+    std::future<Outcome> future = done->get_future();
+    awaitCalls(async, [](std::function<void(void)> task) { task(); }, done);
+
+    // Each call completes inside await_suspend, so the coroutine never suspends
+    // and has finished by the time it returns.
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(0)));
+    const Outcome outcome = future.get();
+    expectResults(outcome);
+    EXPECT_EQ(std::this_thread::get_id(), outcome.resumedOn);
+    EXPECT_EQ(3u, binder->transactions());
+}
+
+TEST_F(CoroutineTest, ResumesOnExecutorThread) {
+    auto done = std::make_shared<std::promise<Outcome>>();
+    std::future<Outcome> future = done->get_future();
+    awaitCalls(async, [](std::function<void(void)> task) { std::thread(task).detach(); }, done);
+
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(5)));
+    const Outcome outcome = future.get();
+    expectResults(outcome);
+    EXPECT_NE(std::this_thread::get_id(), outcome.resumedOn);
+    EXPECT_EQ(3u, binder->transactions());
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Round-trips hidl.tests.flatten@1.0 through its generated proxy and stub,
+// joined in-process by a LoopbackBinder, with and without a peer that
+// understands the @flatten encoding.
+
+#define LOG_TAG "hidl_flatten_host_test"
+
+#include <gtest/gtest.h>
+#include <hidl-loopback/Loopback.h>
+#include <hidl/tests/flatten/1.0/BnHwFlatten.h>
+#include <hidl/tests/flatten/1.0/BpHwFlatten.h>
+#include <hidl/tests/flatten/1.0/IFlatten.h>
+
+#include <atomic>
+#include <limits>
+#include <string>
+#include <vector>
+
+using ::android::sp;
+using ::android::status_t;
+using ::android::hardware::BHwBinder;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::IBinder;
+using ::android::hardware::LoopbackBinder;
+using ::android::hardware::Parcel;
+using ::android::hardware::Return;
+using ::hidl::tests::flatten::V1_0::BnHwFlatten;
+using ::hidl::tests::flatten::V1_0::BpHwFlatten;
+using ::hidl::tests::flatten::V1_0::Entry;
+using ::hidl::tests::flatten::V1_0::IFlatten;
+
+// Matches FIRST_FLATTEN_TRANSACTION in hidl-gen's Interface.cpp.
+static constexpr uint32_t kFirstFlattenTransaction = 0x20000000;
+
+struct Flatten : public IFlatten {
+    Return<uint32_t> put(const hidl_vec<Entry>& entries) override {
+        mEntries = entries;
+        return entries.size();
+    }
+
+    Return<uint32_t> putFlat(const hidl_vec<Entry>& entries) override {
+        mEntries = entries;
+        return entries.size();
+    }
+
+    Return<void> get(get_cb _hidl_cb) override {
+        _hidl_cb(mEntries);
+        return Return<void>();
+    }
+
+    Return<void> getFlat(getFlat_cb _hidl_cb) override {
+        _hidl_cb(mEntries);
+        return Return<void>();
+    }
+
+    hidl_vec<Entry> mEntries;
+};
+
+// Fails the first rejections @flatten transactions with error, the way a stub
+// generated without @flatten support fails all of them with
+// UNKNOWN_TRANSACTION.
+class FlattenRejectingBinder : public LoopbackBinder {
+  public:
+    FlattenRejectingBinder(const sp<BHwBinder>& stub, status_t error, size_t rejections)
+        : LoopbackBinder(stub), mError(error), mRejections(rejections) {}
+
+    // Number of @flatten transactions seen, probes and rejected ones included.
+    size_t flattenTransactions() const { return mFlattenTransactions; }
+
+  protected:
+    status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags,
+                        TransactCallback callback) override {
+        if (code >= kFirstFlattenTransaction) {
+            mFlattenTransactions++;
+            if (mRejections > 0) {
+                mRejections--;
+                return mError;
+            }
+        }
+        return LoopbackBinder::onTransact(code, data, reply, flags, callback);
+    }
+
+  private:
+    const status_t mError;
+    std::atomic<size_t> mRejections;
+    std::atomic<size_t> mFlattenTransactions{0};
+};
+
+// Counts calls to the callback overload of get.
+struct CountingProxy : public BpHwFlatten {
+    explicit CountingProxy(const sp<IBinder>& binder) : BpHwFlatten(binder) {}
+
+    Return<void> get(get_cb _hidl_cb) override {
+        callbackCalls++;
+        return BpHwFlatten::get(_hidl_cb);
+    }
+
+    size_t callbackCalls = 0;
+};
+
+static hidl_vec<Entry> makeEntries() {
+    hidl_vec<Entry> entries(8);
+    for (size_t i = 0; i < entries.size(); i++) {
+        // Includes an empty string and an empty vec.
+        entries[i].key = i == 3 ? "" : "key" + std::to_string(i);
+        entries[i].value = std::vector<uint8_t>(i * 5, static_cast<uint8_t>(i + 1));
+        entries[i].flags = 0x80000000u | i;
+    }
+    return entries;
+}
+
+class FlattenTest : public ::testing::Test {
+  public:
+    void connect(status_t error, size_t rejections) {
+        impl = new Flatten();
+        binder = new FlattenRejectingBinder(new BnHwFlatten(impl), error, rejections);
+        flatten = new BpHwFlatten(binder);
+    }
+
+    void expectRoundTrip() {
+        const hidl_vec<Entry> entries = makeEntries();
+        EXPECT_EQ(entries.size(), static_cast<uint32_t>(flatten->putFlat(entries)));
+        EXPECT_EQ(entries, impl->mEntries);
+
+        EXPECT_TRUE(flatten->getFlat([&](const auto& out) { EXPECT_EQ(entries, out); }).isOk());
+        EXPECT_TRUE(flatten->get([&](const auto& out) { EXPECT_EQ(entries, out); }).isOk());
+    }
+
+    sp<Flatten> impl;
+    sp<FlattenRejectingBinder> binder;
+    sp<IFlatten> flatten;
+};
+
+TEST_F(FlattenTest, RoundTrip) {
+    connect(::android::OK, 0 /* rejections */);
+    expectRoundTrip();
+    // A probe and a call for each of putFlat and getFlat.
+    EXPECT_EQ(4u, binder->flattenTransactions());
+}
+
+TEST_F(FlattenTest, FallsBackForPeerWithoutFlatten) {
+    connect(::android::UNKNOWN_TRANSACTION, std::numeric_limits<size_t>::max());
+    expectRoundTrip();
+    // One probe each for putFlat and getFlat.
+    EXPECT_EQ(2u, binder->flattenTransactions());
+
+    // The answer is cached.
+    expectRoundTrip();
+    EXPECT_EQ(2u, binder->flattenTransactions());
+}
+
+TEST_F(FlattenTest, ProbesAgainAfterOtherErrors) {
+    connect(::android::FAILED_TRANSACTION, 1 /* rejections */);
+    const hidl_vec<Entry> entries = makeEntries();
+
+    // The probe fails, so the call goes out in the classic encoding.
+    EXPECT_EQ(entries.size(), static_cast<uint32_t>(flatten->putFlat(entries)));
+    EXPECT_EQ(entries, impl->mEntries);
+    EXPECT_EQ(1u, binder->flattenTransactions());
+
+    // The failure is not cached, so this probes again and then sends the call.
+    impl->mEntries = {};
+    EXPECT_EQ(entries.size(), static_cast<uint32_t>(flatten->putFlat(entries)));
+    EXPECT_EQ(entries, impl->mEntries);
+    EXPECT_EQ(3u, binder->flattenTransactions());
+}
+
+TEST_F(FlattenTest, ToResults) {
+    connect(::android::OK, 0 /* rejections */);
+    impl->mEntries = makeEntries();
+
+    // Flatten overrides get, which must not hide get_toResults.
+    IFlatten::get_results results;
+    EXPECT_TRUE(impl->get_toResults(results).isOk());
+    EXPECT_EQ(impl->mEntries, results.entries);
+
+    // Proxies read the reply straight into the results, without the callback.
+    sp<CountingProxy> proxy = new CountingProxy(binder);
+    results = {};
+    EXPECT_TRUE(proxy->get_toResults(results).isOk());
+    EXPECT_EQ(impl->mEntries, results.entries);
+    EXPECT_EQ(0u, proxy->callbackCalls);
+
+    // @flatten methods go through the callback overload to pick the encoding.
+    IFlatten::getFlat_results flatResults;
+    EXPECT_TRUE(flatten->getFlat_toResults(flatResults).isOk());
+    EXPECT_EQ(impl->mEntries, flatResults.entries);
+}
@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs hidl_test interfaces through their generated proxies and stubs, joined
+// in-process by a LoopbackBinder, so the binderized marshalling path can be
+// exercised on a host without hwbinder.
+
+#define LOG_TAG "hidl_loopback_host_test"
+
+#include <android/hardware/tests/bar/1.0/BnHwBar.h>
+#include <android/hardware/tests/bar/1.0/BpHwBar.h>
+#include <android/hardware/tests/bar/1.0/IBar.h>
+#include <android/hardware/tests/foo/1.0/BnHwFoo.h>
+#include <android/hardware/tests/foo/1.0/BpHwFoo.h>
+#include <android/hardware/tests/foo/1.0/IFoo.h>
+#include <gtest/gtest.h>
+#include <hidl-loopback/Loopback.h>
+#include <hidl/tests/async/1.0/BnHwAsync.h>
+#include <hidl/tests/async/1.0/BpHwAsync.h>
+#include <hidl/tests/async/1.0/IAsync.h>
+#include <hidl/tests/batch/1.0/BnHwBatch.h>
+#include <hidl/tests/batch/1.0/BpHwBatch.h>
+#include <hidl/tests/batch/1.0/IBatch.h>
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using ::android::sp;
+using ::android::hardware::hidl_array;
+using ::android::hardware::hidl_string;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::LoopbackBinder;
+using ::android::hardware::makeLoopback;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::android::hardware::tests::bar::V1_0::BnHwBar;
+using ::android::hardware::tests::bar::V1_0::BpHwBar;
+using ::android::hardware::tests::bar::V1_0::IBar;
+using ::android::hardware::tests::foo::V1_0::BnHwFoo;
+using ::android::hardware::tests::foo::V1_0::BpHwFoo;
+using ::android::hardware::tests::foo::V1_0::IFoo;
+using ::hidl::tests::async::V1_0::BnHwAsync;
+using ::hidl::tests::async::V1_0::BpHwAsync;
+using ::hidl::tests::async::V1_0::IAsync;
+using ::hidl::tests::batch::V1_0::BnHwBatch;
+using ::hidl::tests::batch::V1_0::BpHwBatch;
+using ::hidl::tests::batch::V1_0::IBatch;
+
+// Exported by the statically linked passthrough implementations.
+extern "C" IFoo* HIDL_FETCH_IFoo(const char* name);
+extern "C" IBar* HIDL_FETCH_IBar(const char* name);
+
+class LoopbackTest : public ::testing::Test {
+  public:
+    void SetUp() override {
+        foo = makeLoopback<BpHwFoo, BnHwFoo>(HIDL_FETCH_IFoo("foo"), &fooBinder);
+        ASSERT_NE(nullptr, foo.get());
+        bar = makeLoopback<BpHwBar, BnHwBar>(HIDL_FETCH_IBar("foo"), &barBinder);
+        ASSERT_NE(nullptr, bar.get());
+    }
+
+    sp<IFoo> foo;
+    sp<LoopbackBinder> fooBinder;
+    sp<IBar> bar;
+    sp<LoopbackBinder> barBinder;
+};
+
+TEST_F(LoopbackTest, IsRemote) {
+    EXPECT_TRUE(foo->isRemote());
+    EXPECT_TRUE(bar->isRemote());
+}
+
+TEST_F(LoopbackTest, Descriptor) {
+    EXPECT_TRUE(foo->interfaceDescriptor([&](const auto& desc) {
+                       EXPECT_EQ(desc, IFoo::descriptor);
+                   }).isOk());
+    EXPECT_TRUE(bar->interfaceDescriptor([&](const auto& desc) {
+                       EXPECT_EQ(desc, IBar::descriptor);
+                   }).isOk());
+}
+
+TEST_F(LoopbackTest, Scalars) {
+    EXPECT_EQ(666, static_cast<int32_t>(foo->doThatAndReturnSomething(2.0f)));
+    EXPECT_DOUBLE_EQ(666.5, static_cast<double>(foo->doQuiteABit(1, 2, 3.0f, 4.0)));
+}
+
+TEST_F(LoopbackTest, Arrays) {
+    hidl_array<int32_t, 15> param;
+    for (size_t i = 0; i < 15; ++i) {
+        param[i] = i;
+    }
+    EXPECT_TRUE(foo->doSomethingElse(param, [&](const auto& something) {
+                       const int32_t expect[] = {0,  2,  4,  6,  8,  10, 12, 14, 16, 18, 20,
+                                                 22, 24, 26, 28, 0,  1,  2,  3,  4,  5,  6,
+                                                 7,  8,  9,  10, 11, 12, 13, 14, 1,  2};
+                       for (size_t i = 0; i < 32; ++i) {
+                           EXPECT_EQ(expect[i], something[i]);
+                       }
+                   }).isOk());
+
+    hidl_array<float, 3, 5> in;
+    float k = 1.0f;
+    for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 5; ++j, ++k) {
+            in[i][j] = k;
+        }
+    }
+    EXPECT_TRUE(foo->transposeMe(in, [&](const auto& out) {
+                       for (size_t i = 0; i < 3; ++i) {
+                           for (size_t j = 0; j < 5; ++j) {
+                               EXPECT_EQ(out[j][i], in[i][j]);
+                           }
+                       }
+                   }).isOk());
+}
+
+TEST_F(LoopbackTest, StringsAndVectors) {
+    EXPECT_TRUE(foo->doStuffAndReturnAString([&](const auto& something) {
+                       EXPECT_EQ("Hello, world", something);
+                   }).isOk());
+
+    hidl_array<hidl_string, 3> strings;
+    strings[0] = "What";
+    strings[1] = "a";
+    strings[2] = "disaster";
+    EXPECT_TRUE(foo->haveSomeStrings(strings, [&](const auto& out) {
+                       EXPECT_EQ("Hello", out[0]);
+                       EXPECT_EQ("World", out[1]);
+                   }).isOk());
+
+    hidl_vec<int32_t> values(10);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = i;
+    }
+    EXPECT_TRUE(foo->mapThisVector(values, [&](const auto& out) {
+                       ASSERT_EQ(values.size(), out.size());
+                       for (size_t i = 0; i < out.size(); ++i) {
+                           EXPECT_EQ(values[i] * 2, out[i]);
+                       }
+                   }).isOk());
+}
+
+TEST_F(LoopbackTest, Unions) {
+    hidl_vec<IFoo::Union> u = {
+            {.intValue = 7},
+            {.intValue = 0},
+    };
+    EXPECT_TRUE(foo->convertToBoolIfSmall(IFoo::Discriminator::INT, u, [&](const auto& res) {
+                       ASSERT_EQ(2u, res.size());
+                       EXPECT_EQ(IFoo::Discriminator::INT, res[0].discriminator);
+                       EXPECT_EQ(7, res[0].value.intValue);
+                       EXPECT_EQ(IFoo::Discriminator::BOOL, res[1].discriminator);
+                       EXPECT_FALSE(res[1].value.boolValue);
+                   }).isOk());
+}
+
+TEST_F(LoopbackTest, DerivedInterface) {
+    EXPECT_TRUE(bar->thisIsNew().isOk());
+    EXPECT_EQ(666, static_cast<int32_t>(bar->doThatAndReturnSomething(2.0f)));
+}
+
+TEST_F(LoopbackTest, Counters) {
+    fooBinder->resetCounters();
+    EXPECT_EQ(0u, fooBinder->transactions());
+
+    hidl_vec<int32_t> values(1024);
+    EXPECT_TRUE(foo->mapThisVector(values, [](const auto&) {}).isOk());
+
+    EXPECT_EQ(1u, fooBinder->transactions());
+    // Both directions carry the vector in a separate buffer.
+    EXPECT_GE(fooBinder->bytesSent(), values.size() * sizeof(int32_t));
+    EXPECT_GE(fooBinder->bytesReceived(), values.size() * sizeof(int32_t));
+}
+
+// Records event ids in the order the stub delivers them.
+struct RecordingBatch : public IBatch {
+    Return<void> onEvent(int32_t id, int64_t /* timestampNs */) override { return record(id); }
+
+    Return<void> onEventUnbatched(int32_t id, int64_t /* timestampNs */) override {
+        return record(id);
+    }
+
+    Return<void> onNamedEvent(const hidl_string& name, const hidl_vec<int32_t>& ids) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNames.push_back(name);
+        mNamedIds.insert(mNamedIds.end(), ids.begin(), ids.end());
+        return Void();
+    }
+
+    Return<uint64_t> getCount() override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mIds.size();
+    }
+
+    Return<void> getEvents(getEvents_cb _hidl_cb) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        _hidl_cb(hidl_vec<int32_t>(mIds), mIds.size());
+        return Void();
+    }
+
+    Return<void> getNamedEvents(getNamedEvents_cb _hidl_cb) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        _hidl_cb(hidl_vec<hidl_string>(mNames), hidl_vec<int32_t>(mNamedIds));
+        return Void();
+    }
+
+  private:
+    Return<void> record(int32_t id) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIds.push_back(id);
+        return Void();
+    }
+
+    std::mutex mMutex;
+    std::vector<int32_t> mIds;
+    std::vector<hidl_string> mNames;
+    std::vector<int32_t> mNamedIds;
+};
+
+class LoopbackBatchTest : public ::testing::Test {
+  public:
+    void SetUp() override {
+        impl = new RecordingBatch();
+        batch = makeLoopback<BpHwBatch, BnHwBatch>(impl, &batchBinder);
+        ASSERT_NE(nullptr, batch.get());
+    }
+
+    sp<RecordingBatch> impl;
+    sp<IBatch> batch;
+    sp<LoopbackBinder> batchBinder;
+};
+
+TEST_F(LoopbackBatchTest, UnbatchedCallsFlushFirst) {
+    EXPECT_TRUE(batch->onEvent(1, 0).isOk());
+    EXPECT_TRUE(batch->onEvent(2, 0).isOk());
+    EXPECT_TRUE(batch->onEventUnbatched(3, 0).isOk());
+    EXPECT_TRUE(batch->onEvent(4, 0).isOk());
+    EXPECT_EQ(4u, static_cast<uint64_t>(batch->getCount()));
+
+    EXPECT_TRUE(batch->onEvent(5, 0).isOk());
+    EXPECT_TRUE(batch->getEvents([&](const auto& ids, uint64_t count) {
+                         EXPECT_EQ(hidl_vec<int32_t>({1, 2, 3, 4, 5}), ids);
+                         EXPECT_EQ(5u, count);
+                     }).isOk());
+}
+
+TEST_F(LoopbackBatchTest, ResultsOverloadFlushesFirst) {
+    EXPECT_TRUE(batch->onEvent(1, 0).isOk());
+    EXPECT_TRUE(batch->onEvent(2, 0).isOk());
+
+    IBatch::getEvents_results results;
+    EXPECT_TRUE(batch->getEvents_toResults(results).isOk());
+    EXPECT_EQ(hidl_vec<int32_t>({1, 2}), results.ids);
+    EXPECT_EQ(2u, results.count);
+}
+
+TEST_F(LoopbackBatchTest, DeadlineFlushes) {
+    // Negotiate first, so the call below is queued rather than sent directly.
+    EXPECT_TRUE(batch->onEvent(1, 0).isOk());
+    EXPECT_EQ(1u, static_cast<uint64_t>(batch->getCount()));
+    batchBinder->resetCounters();
+
+    EXPECT_TRUE(batch->onEvent(2, 0).isOk());
+    EXPECT_EQ(0u, batchBinder->transactions());
+
+    // Nothing else is called, so only the flushUs deadline can send the batch.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (batchBinder->transactions() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(1u, batchBinder->transactions());
+    EXPECT_EQ(2u, static_cast<uint64_t>(impl->getCount()));
+}
+
+TEST_F(LoopbackBatchTest, CopiesArguments) {
+    // Negotiate first, so the calls below are queued rather than sent directly.
+    EXPECT_TRUE(batch->onEvent(1, 0).isOk());
+    EXPECT_EQ(1u, static_cast<uint64_t>(batch->getCount()));
+    batchBinder->resetCounters();
+
+    {
+        hidl_string name("first");
+        hidl_vec<int32_t> ids({10, 11});
+        EXPECT_TRUE(batch->onNamedEvent(name, ids).isOk());
+
+        name = "overwritten";
+        ids[0] = -1;
+    }
+    EXPECT_TRUE(batch->onNamedEvent(hidl_string("second"), hidl_vec<int32_t>({12})).isOk());
+    EXPECT_EQ(0u, batchBinder->transactions());
+
+    // Sends the batch long after the arguments above were destroyed.
+    EXPECT_TRUE(batch->getNamedEvents([&](const auto& names, const auto& ids) {
+                         EXPECT_EQ(hidl_vec<hidl_string>({"first", "second"}), names);
+                         EXPECT_EQ(hidl_vec<int32_t>({10, 11, 12}), ids);
+                     }).isOk());
+}
+
+struct Async : public IAsync {
+    Return<int32_t> add(int32_t a, int32_t b) override { return a + b; }
+
+    Return<void> divide(int32_t a, int32_t b, divide_cb _hidl_cb) override {
+        _hidl_cb(a / b, a % b);
+        return Void();
+    }
+
+    Return<void> join(const hidl_vec<hidl_string>& parts, join_cb _hidl_cb) override {
+        std::string joined;
+        for (const auto& part : parts) {
+            joined += part;
+        }
+        _hidl_cb(joined);
+        return Void();
+    }
+
+    Return<int32_t> subtract(int32_t a, int32_t b) override { return a - b; }
+};
+
+template <typename T, typename = void>
+struct HasSubtractAsync : std::false_type {};
+template <typename T>
+struct HasSubtractAsync<T, std::void_t<decltype(&T::subtract_async)>> : std::true_type {};
+static_assert(!HasSubtractAsync<IAsync>::value, "only @async methods get _async overloads");
+
+// Holds posted tasks until run(), so tests decide when calls are made.
+class ManualExecutor {
+  public:
+    std::function<void(std::function<void(void)>)> get() {
+        return [this](std::function<void(void)> task) { mTasks.push_back(std::move(task)); };
+    }
+
+    size_t run() {
+        std::vector<std::function<void(void)>> tasks = std::move(mTasks);
+        mTasks.clear();
+        for (const auto& task : tasks) {
+            task();
+        }
+        return tasks.size();
+    }
+
+  private:
+    std::vector<std::function<void(void)>> mTasks;
+};
+
+class LoopbackAsyncTest : public ::testing::Test {
+  public:
+    void SetUp() override {
+        async = makeLoopback<BpHwAsync, BnHwAsync>(new Async(), &asyncBinder);
+        ASSERT_NE(nullptr, async.get());
+    }
+
+    sp<IAsync> async;
+    sp<LoopbackBinder> asyncBinder;
+    ManualExecutor executor;
+};
+
+TEST_F(LoopbackAsyncTest, RunsOnExecutor) {
+    bool called = false;
+    async->add_async(2, 3, executor.get(), [&](Return<int32_t> ret) {
+        ASSERT_TRUE(ret.isOk());
+        EXPECT_EQ(5, static_cast<int32_t>(ret));
+        called = true;
+    });
+
+    // Nothing is sent until the executor runs the task.
+    EXPECT_EQ(0u, asyncBinder->transactions());
+    EXPECT_EQ(1u, executor.run());
+    EXPECT_TRUE(called);
+    EXPECT_EQ(1u, asyncBinder->transactions());
+}
+
+TEST_F(LoopbackAsyncTest, ResultsStruct) {
+    bool called = false;
+    async->divide_async(7, 2, executor.get(),
+                        [&](Return<void> ret, IAsync::divide_results results) {
+                            EXPECT_TRUE(ret.isOk());
+                            EXPECT_EQ(3, results.quotient);
+                            EXPECT_EQ(1, results.remainder);
+                            called = true;
+                        });
+    executor.run();
+    EXPECT_TRUE(called);
+}
+
+TEST_F(LoopbackAsyncTest, CopiesArguments) {
+    hidl_vec<hidl_string> parts = {"a", "b", "c"};
+    std::string joined;
+    async->join_async(parts, executor.get(), [&](Return<void> ret, IAsync::join_results results) {
+        EXPECT_TRUE(ret.isOk());
+        joined = results.joined;
+    });
+
+    // The call has not been made yet, but the caller may already reuse its arguments.
+    parts = {"x"};
+    executor.run();
+    EXPECT_EQ("abc", joined);
+}
+
+TEST_F(LoopbackAsyncTest, ThreadPerCall) {
+    // Each outstanding call occupies the thread that makes it.
+    std::vector<std::future<int32_t>> sums;
+    for (int32_t i = 0; i < 4; i++) {
+        auto promise = std::make_shared<std::promise<int32_t>>();
+        sums.push_back(promise->get_future());
+        async->add_async(
+                i, 10, [](std::function<void(void)> task) { std::thread(task).detach(); },
+                [promise](Return<int32_t> ret) {
+                    promise->set_value(ret.isOk() ? static_cast<int32_t>(ret) : -1);
+                });
+    }
+    for (int32_t i = 0; i < 4; i++) {
+        ASSERT_EQ(std::future_status::ready, sums[i].wait_for(std::chrono::seconds(5)));
+        EXPECT_EQ(i + 10, sums[i].get());
+    }
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs hidl.tests.passthrough_oneway@1.0 through its generated Bs wrapper to
+// check how @passthroughOneway(mode="pool") dispatches oneway calls.
+
+#define LOG_TAG "hidl_passthrough_oneway_host_test"
+
+#include <gtest/gtest.h>
+#include <hidl/tests/passthrough_oneway/1.0/BsPassthroughOneway.h>
+#include <hidl/tests/passthrough_oneway/1.0/IPassthroughOneway.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using ::android::sp;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::hidl::tests::passthrough_oneway::V1_0::BsPassthroughOneway;
+using ::hidl::tests::passthrough_oneway::V1_0::IPassthroughOneway;
+
+// Matches IPassthroughOneway.hal.
+static constexpr size_t kWorkers = 4;
+static constexpr size_t kQueueSize = 16;
+
+struct PassthroughOneway : public IPassthroughOneway {
+    PassthroughOneway() : gate(release.get_future().share()) {}
+
+    // -1 blocks its worker until release is set, -2 calls forward on it.
+    Return<void> onSample(uint32_t sensor, int64_t value) override {
+        if (value == -1) {
+            blocked.set_value();
+            gate.wait();
+        } else if (value == -2) {
+            forward();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        samples[sensor].push_back(value);
+        threads[sensor].insert(std::this_thread::get_id());
+        count++;
+        received.notify_all();
+        return Void();
+    }
+
+    Return<void> onFlush() override { return Void(); }
+
+    Return<void> onPing() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        pingThread = std::this_thread::get_id();
+        return Void();
+    }
+
+    bool waitForCount(size_t expected) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return received.wait_for(lock, std::chrono::seconds(5),
+                                 [&] { return count >= expected; });
+    }
+
+    std::promise<void> blocked;
+    std::promise<void> release;
+    std::shared_future<void> gate;
+    std::function<void()> forward;
+
+    std::mutex mutex;
+    std::condition_variable received;
+    size_t count = 0;
+    std::map<uint32_t, std::vector<int64_t>> samples;
+    std::map<uint32_t, std::set<std::thread::id>> threads;
+    std::thread::id pingThread;
+};
+
+class PassthroughOnewayTest : public ::testing::Test {
+  public:
+    void SetUp() override {
+        impl = new PassthroughOneway();
+        bs = new BsPassthroughOneway(impl);
+    }
+
+    sp<PassthroughOneway> impl;
+    sp<BsPassthroughOneway> bs;
+};
+
+TEST_F(PassthroughOnewayTest, KeysRunInOrderOnTheirWorker) {
+    constexpr uint32_t kSensors = 2 * kWorkers;
+    constexpr int64_t kSamples = 100;
+    for (int64_t i = 0; i < kSamples; i++) {
+        for (uint32_t sensor = 0; sensor < kSensors; sensor++) {
+            EXPECT_TRUE(bs->onSample(sensor, i).isOk());
+        }
+    }
+    ASSERT_TRUE(impl->waitForCount(kSensors * kSamples));
+
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    std::set<std::thread::id> workers;
+    for (uint32_t sensor = 0; sensor < kSensors; sensor++) {
+        const std::vector<int64_t>& samples = impl->samples[sensor];
+        ASSERT_EQ(static_cast<size_t>(kSamples), samples.size());
+        for (int64_t i = 0; i < kSamples; i++) {
+            EXPECT_EQ(i, samples[i]) << "sensor " << sensor;
+        }
+
+        ASSERT_EQ(1u, impl->threads[sensor].size()) << "sensor " << sensor;
+        workers.insert(*impl->threads[sensor].begin());
+        // The key picks the worker.
+        EXPECT_EQ(impl->threads[sensor % kWorkers], impl->threads[sensor]);
+    }
+    EXPECT_EQ(kWorkers, workers.size());
+
+    BsPassthroughOneway::OnewayQueueStats stats;
+    ASSERT_TRUE(BsPassthroughOneway::getOnewayQueueStats(bs, &stats));
+    EXPECT_EQ(kSensors * kSamples, stats.tasks);
+}
+
+TEST_F(PassthroughOnewayTest, StatsNeedTheWrapper) {
+    BsPassthroughOneway::OnewayQueueStats stats;
+    EXPECT_FALSE(BsPassthroughOneway::getOnewayQueueStats(impl, &stats));
+    EXPECT_FALSE(BsPassthroughOneway::getOnewayQueueStats(sp<IPassthroughOneway>(), &stats));
+}
+
+TEST_F(PassthroughOnewayTest, FullQueueBlocksCaller) {
+    EXPECT_TRUE(bs->onSample(0, -1).isOk());
+    impl->blocked.get_future().wait();
+
+    // The running call is no longer queued, so the queue takes kQueueSize more.
+    for (size_t i = 0; i < kQueueSize; i++) {
+        EXPECT_TRUE(bs->onSample(0, i).isOk());
+    }
+    BsPassthroughOneway::OnewayQueueStats stats;
+    ASSERT_TRUE(BsPassthroughOneway::getOnewayQueueStats(bs, &stats));
+    EXPECT_EQ(kQueueSize, stats.depth);
+
+    auto full = std::async(std::launch::async,
+                           [&] { return bs->onSample(0, kQueueSize).isOk(); });
+    EXPECT_EQ(std::future_status::timeout, full.wait_for(std::chrono::milliseconds(100)));
+    ASSERT_TRUE(BsPassthroughOneway::getOnewayQueueStats(bs, &stats));
+    EXPECT_EQ(kQueueSize, stats.maxDepth);
+
+    // Other workers have queues of their own.
+    EXPECT_TRUE(bs->onSample(1, 0).isOk());
+
+    impl->release.set_value();
+    EXPECT_TRUE(full.get());
+    ASSERT_TRUE(impl->waitForCount(kQueueSize + 3));
+
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    const std::vector<int64_t>& samples = impl->samples[0];
+    ASSERT_EQ(kQueueSize + 2, samples.size());
+    EXPECT_EQ(-1, samples[0]);
+    for (size_t i = 0; i <= kQueueSize; i++) {
+        EXPECT_EQ(static_cast<int64_t>(i), samples[i + 1]);
+    }
+}
+
+TEST_F(PassthroughOnewayTest, WorkersDoNotWaitOnFullQueues) {
+    // Sensor 0 runs on a worker, which queues one more call for sensor 1.
+    IPassthroughOneway* peer = bs.get();
+    impl->forward = [peer] { EXPECT_TRUE(peer->onSample(1, kQueueSize).isOk()); };
+
+    EXPECT_TRUE(bs->onSample(1, -1).isOk());
+    impl->blocked.get_future().wait();
+    for (size_t i = 0; i < kQueueSize; i++) {
+        EXPECT_TRUE(bs->onSample(1, i).isOk());
+    }
+
+    // The queue of sensor 1 is full, yet the worker of sensor 0 goes on.
+    EXPECT_TRUE(bs->onSample(0, -2).isOk());
+    ASSERT_TRUE(impl->waitForCount(1));
+
+    impl->release.set_value();
+    ASSERT_TRUE(impl->waitForCount(kQueueSize + 3));
+
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    const std::vector<int64_t>& samples = impl->samples[1];
+    ASSERT_EQ(kQueueSize + 2, samples.size());
+    EXPECT_EQ(-1, samples[0]);
+    for (size_t i = 0; i <= kQueueSize; i++) {
+        EXPECT_EQ(static_cast<int64_t>(i), samples[i + 1]);
+    }
+}
+
+TEST_F(PassthroughOnewayTest, InlineMethodRunsOnCaller) {
+    EXPECT_TRUE(bs->onPing().isOk());
+
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    EXPECT_EQ(std::this_thread::get_id(), impl->pingThread);
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that BsRegistry reuses the wrapper it makes for a local callback, and
+// never hands out a wrapper for an implementation that has gone away.
+
+#define LOG_TAG "hidl_passthrough_wrapper_host_test"
+
+#include <gtest/gtest.h>
+#include <hidl/tests/callback_registry/1.0/BsRegistry.h>
+#include <hidl/tests/callback_registry/1.0/ICallback.h>
+#include <hidl/tests/callback_registry/1.0/IRegistry.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+using ::android::sp;
+using ::android::wp;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+using ::hidl::tests::callback_registry::V1_0::BsRegistry;
+using ::hidl::tests::callback_registry::V1_0::ICallback;
+using ::hidl::tests::callback_registry::V1_0::IRegistry;
+
+struct Callback : public ICallback {
+    Return<void> onEvent(int32_t id) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        ids.push_back(id);
+        received.notify_all();
+        return Void();
+    }
+
+    bool waitForEvent(int32_t id) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return received.wait_for(lock, std::chrono::seconds(5), [&] {
+            return std::find(ids.begin(), ids.end(), id) != ids.end();
+        });
+    }
+
+    std::mutex mutex;
+    std::condition_variable received;
+    std::vector<int32_t> ids;
+};
+
+// Keeps the last callback it was given, as passed in by BsRegistry.
+struct Registry : public IRegistry {
+    Return<void> setCallbacks(const hidl_vec<sp<ICallback>>& /* callbacks */) override {
+        return Void();
+    }
+
+    Return<void> getCallbacks(getCallbacks_cb _hidl_cb) override {
+        _hidl_cb({});
+        return Void();
+    }
+
+    Return<void> addCallback(const sp<ICallback>& callback) override {
+        last = callback;
+        return Void();
+    }
+
+    sp<ICallback> last;
+};
+
+class PassthroughWrapperTest : public ::testing::Test {
+  public:
+    void SetUp() override {
+        impl = new Registry();
+        registry = new BsRegistry(impl);
+    }
+
+    sp<Registry> impl;
+    sp<IRegistry> registry;
+};
+
+TEST_F(PassthroughWrapperTest, SameCallbackSameWrapper) {
+    sp<Callback> callback = new Callback();
+    const auto before = BsRegistry::getPassthroughWrapperStats();
+
+    EXPECT_TRUE(registry->addCallback(callback).isOk());
+    sp<ICallback> first = impl->last;
+    ASSERT_NE(nullptr, first);
+    EXPECT_NE(callback, first);
+
+    EXPECT_TRUE(registry->addCallback(callback).isOk());
+    EXPECT_EQ(first, impl->last);
+
+    // A wrapper passed back in is not wrapped again.
+    EXPECT_TRUE(registry->addCallback(first).isOk());
+    EXPECT_EQ(first, impl->last);
+
+    const auto after = BsRegistry::getPassthroughWrapperStats();
+    EXPECT_EQ(before.misses + 1, after.misses);
+    EXPECT_EQ(before.hits + 1, after.hits);
+    EXPECT_EQ(before.alreadyWrapped + 1, after.alreadyWrapped);
+}
+
+TEST_F(PassthroughWrapperTest, DroppedCallbackIsNotReused) {
+    sp<Callback> callback = new Callback();
+    EXPECT_TRUE(registry->addCallback(callback).isOk());
+    wp<ICallback> wrapper = impl->last;
+
+    // The wrapper is the only owner of the callback, so both go away here.
+    impl->last.clear();
+    callback.clear();
+    ASSERT_EQ(nullptr, wrapper.promote());
+
+    // Possibly allocated where the first one was.
+    sp<Callback> other = new Callback();
+    const auto before = BsRegistry::getPassthroughWrapperStats();
+    EXPECT_TRUE(registry->addCallback(other).isOk());
+    ASSERT_NE(nullptr, impl->last);
+    EXPECT_EQ(before.misses + 1, BsRegistry::getPassthroughWrapperStats().misses);
+
+    EXPECT_TRUE(impl->last->onEvent(7).isOk());
+    EXPECT_TRUE(other->waitForEvent(7));
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.commands.hidl_test_java;
+
+import android.os.Debug;
+import android.os.RemoteException;
+
+import hidl.tests.java_arrays.V1_0.Channel;
+import hidl.tests.java_arrays.V1_0.Frame;
+import hidl.tests.java_arrays.V1_0.ISamples;
+import hidl.tests.java_arrays.V1_0.Point;
+
+import java.util.ArrayList;
+import java.util.Collections;
+
+/**
+ * Compares calls per second and bytes allocated when passing vec<float> as an
+ * ArrayList<Float> with passing it as a float[] through the @javaArrays
+ * overload.
+ *
+ * The proxy wraps a stub in this process, so calls go through the generated
+ * code and the native parcels but not through the kernel. The stub always
+ * dispatches to scaleArrays, so only the client side differs. echoFrame
+ * measures vectors embedded in a struct, which are always copied in bulk.
+ * track compares decoding every Point in a vector with reading one field
+ * through the @javaView Point.View. Run with:
+ *
+ *   app_process /data/framework com.android.commands.hidl_test_java.ArraysBenchmark
+ */
+public final class ArraysBenchmark {
+    private static final int WARMUP_CALLS = 1_000;
+    private static final int CALLS = 20_000;
+    private static final int SAMPLES = 1024;
+
+    private static final class Samples extends ISamples.Stub {
+        @Override
+        public ArrayList<Float> scale(ArrayList<Float> samples, float factor) {
+            ArrayList<Float> scaled = new ArrayList<Float>(samples.size());
+            for (float sample : samples) {
+                scaled.add(sample * factor);
+            }
+            return scaled;
+        }
+
+        @Override
+        public float[] scaleArrays(float[] samples, float factor) {
+            float[] scaled = new float[samples.length];
+            for (int i = 0; i < samples.length; i++) {
+                scaled[i] = samples[i] * factor;
+            }
+            return scaled;
+        }
+
+        @Override
+        public void summarize(ArrayList<Integer> values, summarizeCallback cb) {
+            ArrayList<Integer> sorted = new ArrayList<Integer>(values);
+            Collections.sort(sorted);
+            long sum = 0;
+            for (int value : values) {
+                sum += value;
+            }
+            cb.onValues(sum, sorted);
+        }
+
+        @Override
+        public void record(ArrayList<Byte> data) {}
+
+        @Override
+        public Frame echoFrame(Frame frame) {
+            return frame;
+        }
+
+        @Override
+        public ArrayList<Point> track(int count) {
+            ArrayList<Point> points = new ArrayList<Point>(count);
+            for (int i = 0; i < count; i++) {
+                Point point = new Point();
+                point.timestamp = i;
+                point.x = i;
+                point.y = -i;
+                point.valid = (i % 2 == 0);
+                point.channels = Channel.LEFT;
+                points.add(point);
+            }
+            return points;
+        }
+    }
+
+    public static void main(String[] args) throws RemoteException {
+        ISamples proxy = new ISamples.Proxy(new Samples());
+
+        for (int round = 0; round < 3; round++) {
+            measure("ArrayList<Float>", proxy, false /* arrays */);
+            measure("float[]", proxy, true /* arrays */);
+            measureFrames(proxy);
+            measureTrack("ArrayList<Point>", proxy, false /* view */);
+            measureTrack("Point.View", proxy, true /* view */);
+        }
+    }
+
+    private static Frame makeFrame(int size) {
+        Frame frame = new Frame();
+        for (int i = 0; i < size; i++) {
+            frame.samples.add((float) i);
+            frame.channels.add((i % 2 == 0) ? Channel.LEFT : Channel.RIGHT);
+            frame.masks.add((byte) (Channel.LEFT | Channel.CENTER));
+            frame.timestamps.add(1_000_000_000L * i);
+        }
+        return frame;
+    }
+
+    private static void measureTrack(String mode, ISamples proxy, boolean view)
+            throws RemoteException {
+        for (int i = 0; i < WARMUP_CALLS; i++) {
+            lastTimestamp(proxy, view);
+        }
+
+        final long bytesBefore = bytesAllocated();
+        final long start = System.nanoTime();
+        for (int i = 0; i < CALLS; i++) {
+            if (lastTimestamp(proxy, view) != SAMPLES - 1) {
+                throw new IllegalStateException("track returned another timestamp");
+            }
+        }
+        final long elapsedNs = System.nanoTime() - start;
+        final long bytes = bytesAllocated() - bytesBefore;
+
+        System.out.printf("%-18s %10.0f calls/s %10d bytes/call%n", mode,
+                CALLS * 1e9 / elapsedNs, bytes / CALLS);
+    }
+
+    private static long lastTimestamp(ISamples proxy, boolean view) throws RemoteException {
+        if (view) {
+            Point.View points = proxy.trackArrays(SAMPLES);
+            return points.getTimestamp(points.size() - 1);
+        }
+        ArrayList<Point> points = proxy.track(SAMPLES);
+        return points.get(points.size() - 1).timestamp;
+    }
+
+    private static void measureFrames(ISamples proxy) throws RemoteException {
+        Frame frame = makeFrame(SAMPLES);
+
+        for (int i = 0; i < WARMUP_CALLS; i++) {
+            proxy.echoFrame(frame);
+        }
+
+        final long bytesBefore = bytesAllocated();
+        final long start = System.nanoTime();
+        for (int i = 0; i < CALLS; i++) {
+            proxy.echoFrame(frame);
+        }
+        final long elapsedNs = System.nanoTime() - start;
+        final long bytes = bytesAllocated() - bytesBefore;
+
+        System.out.printf("%-18s %10.0f calls/s %10d bytes/call%n", "Frame",
+                CALLS * 1e9 / elapsedNs, bytes / CALLS);
+    }
+
+    private static void measure(String mode, ISamples proxy, boolean arrays)
+            throws RemoteException {
+        float[] array = new float[SAMPLES];
+        ArrayList<Float> list = new ArrayList<Float>(SAMPLES);
+        for (int i = 0; i < SAMPLES; i++) {
+            array[i] = i;
+            list.add((float) i);
+        }
+
+        for (int i = 0; i < WARMUP_CALLS; i++) {
+            call(proxy, arrays, array, list);
+        }
+
+        final long bytesBefore = bytesAllocated();
+        final long start = System.nanoTime();
+        for (int i = 0; i < CALLS; i++) {
+            call(proxy, arrays, array, list);
+        }
+        final long elapsedNs = System.nanoTime() - start;
+        final long bytes = bytesAllocated() - bytesBefore;
+
+        System.out.printf("%-18s %10.0f calls/s %10d bytes/call%n", mode,
+                CALLS * 1e9 / elapsedNs, bytes / CALLS);
+    }
+
+    private static void call(ISamples proxy, boolean arrays, float[] array,
+            ArrayList<Float> list) throws RemoteException {
+        final float last;
+        if (arrays) {
+            float[] scaled = proxy.scaleArrays(array, 2.0f);
+            last = scaled[scaled.length - 1];
+        } else {
+            ArrayList<Float> scaled = proxy.scale(list, 2.0f);
+            last = scaled.get(scaled.size() - 1);
+        }
+        if (last != 2.0f * (SAMPLES - 1)) {
+            throw new IllegalStateException("scale returned " + last);
+        }
+    }
+
+    private static long bytesAllocated() {
+        return Long.parseLong(Debug.getRuntimeStat("art.gc.bytes-allocated"));
+    }
+}
@@ -21,6 +21,17 @@ import static android.system.OsConstants.PROT_READ;
 import static android.system.OsConstants.PROT_WRITE;
 
 import android.hidl.manager.V1_0.IServiceManager;
+import hidl.tests.java_arrays.V1_0.Channel;
+import hidl.tests.java_arrays.V1_0.Frame;
+import hidl.tests.java_arrays.V1_0.ISamples;
+import hidl.tests.java_arrays.V1_0.Point;
+import hidl.tests.java_async.V1_0.IAsync;
+import hidl.tests.java_parcels.V1_0.IEcho;
+import hidl.tests.java_parcels.V1_0.IEchoReuse;
+import hidl.tests.java_structs.V1_0.Code;
+import hidl.tests.java_structs.V1_0.Flag;
+import hidl.tests.java_structs.V1_0.Inner;
+import hidl.tests.java_structs.V1_0.Outer;
 import android.hardware.tests.baz.V1_0.IBase;
 import android.hardware.tests.baz.V1_0.IBaz;
 import android.hardware.tests.baz.V1_0.IQuux;
@@ -60,6 +71,10 @@ import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.NoSuchElementException;
 import java.util.Objects;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
 
 public final class HidlTestJava {
     private static final String TAG = "HidlTestJava";
@@ -283,6 +298,424 @@ public final class HidlTestJava {
         }
     }
 
+    static final class Async extends IAsync.Stub {
+        final ArrayList<Integer> mPosted = new ArrayList<Integer>();
+        int mResets = 0;
+
+        @Override
+        public int add(int a, int b) {
+            return a + b;
+        }
+
+        @Override
+        public void divide(int a, int b, IAsync.divideCallback cb) throws RemoteException {
+            if (b == 0) {
+                throw new RemoteException("division by zero");
+            }
+            cb.onValues(a / b, a % b);
+        }
+
+        @Override
+        public synchronized void reset() {
+            mResets++;
+        }
+
+        @Override
+        public synchronized void post(int value) {
+            mPosted.add(value);
+        }
+    }
+
+    private static Inner makeInner(int a, float b) {
+        Inner inner = new Inner();
+        inner.a = a;
+        inner.b = b;
+        return inner;
+    }
+
+    private static Outer makeOuter() {
+        Outer outer = new Outer();
+        outer.inner = makeInner(1, 2.5f);
+        outer.inners.add(makeInner(3, 4.0f));
+        outer.inners.add(makeInner(5, 6.0f));
+        outer.values = new int[] {1, 2, 3, 4};
+        outer.samples.add(0.5f);
+        outer.name = "outer";
+        outer.flags = Flag.A | Flag.B;
+        return outer;
+    }
+
+    private void runClientStructMethodTests() {
+        Outer l = makeOuter();
+        Outer r = makeOuter();
+        ExpectTrue(l.equals(r));
+        ExpectTrue(l.hashCode() == r.hashCode());
+        ExpectDeepEq(l, r);
+
+        Outer other = makeOuter();
+        other.values[3] = 5;
+        ExpectFalse(l.equals(other));
+        other = makeOuter();
+        other.inners.get(1).b = 7.0f;
+        ExpectFalse(l.equals(other));
+        other = makeOuter();
+        other.flags = Flag.A;
+        ExpectFalse(l.equals(other));
+        other = makeOuter();
+        other.name = null;
+        ExpectFalse(l.equals(other));
+        ExpectFalse(other.equals(l));
+
+        // Outer is @javaImmutable, so its hash is cached.
+        int hash = l.hashCode();
+        ExpectTrue(l.hashCode() == hash);
+
+        Expect(l.toString(), "{.inner = {.a = 1, .b = 2.5}, "
+                + ".inners = [{.a = 3, .b = 4.0}, {.a = 5, .b = 6.0}], "
+                + ".values = [1, 2, 3, 4], .samples = [0.5], .name = outer, .flags = A | B}");
+
+        StringBuilder builder = new StringBuilder("outer: ");
+        l.appendTo(builder);
+        Expect(builder.toString(), "outer: " + l.toString());
+
+        other = makeOuter();
+        other.inner = null;
+        other.inners.set(0, null);
+        Expect(other.toString(), "{.inner = null, .inners = [null, {.a = 5, .b = 6.0}], "
+                + ".values = [1, 2, 3, 4], .samples = [0.5], .name = outer, .flags = A | B}");
+    }
+
+    private void runClientEnumLookupTests() {
+        Expect(Code.toString(Code.NONE), "NONE");
+        Expect(Code.toString(Code.FIRST), "LOW");
+        Expect(Code.toString(Code.HIGH), "HIGH");
+        Expect(Code.toString(Code.MAX), "MAX");
+        Expect(Code.toString((byte) 2), "0x2");
+        Expect(Code.toString((byte) 201), "0xc9");
+        Expect(Flag.toString(Flag.B), "B");
+        Expect(Flag.toString(0), "0x0");
+
+        StringBuilder builder = new StringBuilder("code: ");
+        Code.appendTo(builder, Code.HIGH);
+        builder.append(", ");
+        Code.appendTo(builder, (byte) 3);
+        Expect(builder.toString(), "code: HIGH, 0x3");
+
+        Expect(Flag.dumpBitfield(0), "");
+        Expect(Flag.dumpBitfield(Flag.A | 8), "A | 0x8");
+        Expect(Code.dumpBitfield(Code.HIGH), "NONE | HIGH");
+
+        builder = new StringBuilder("flags: ");
+        Flag.appendBitfield(builder, Flag.A | Flag.B);
+        Expect(builder.toString(), "flags: A | B");
+    }
+
+    static final class ResultsAsync extends IAsync.ResultsStub {
+        final ArrayList<IAsync.divideResults> mHolders = new ArrayList<IAsync.divideResults>();
+
+        @Override
+        public int add(int a, int b) {
+            return a + b;
+        }
+
+        @Override
+        public IAsync.divideResults divide(int a, int b, IAsync.divideResults results) {
+            mHolders.add(results);
+            results.quotient = a / b;
+            results.remainder = a % b;
+            return results;
+        }
+
+        @Override
+        public void reset() {}
+
+        @Override
+        public void post(int value) {}
+    }
+
+    private void runClientResultsStubTests() throws RemoteException {
+        ResultsAsync stub = new ResultsAsync();
+
+        for (IAsync async : new IAsync[] {stub, new IAsync.Proxy(stub)}) {
+            for (int i = 1; i <= 3; i++) {
+                final int divisor = i;
+                async.divide(10, divisor, (quotient, remainder) -> {
+                    ExpectTrue(quotient == 10 / divisor);
+                    ExpectTrue(remainder == 10 % divisor);
+                });
+            }
+        }
+
+        // Calls made directly on this thread reuse the same holder.
+        ExpectTrue(stub.mHolders.get(0) == stub.mHolders.get(1));
+        ExpectTrue(stub.mHolders.get(1) == stub.mHolders.get(2));
+
+        // A reentrant call gets a holder of its own.
+        final IAsync.divideResults[] inner = new IAsync.divideResults[1];
+        stub.divide(10, 1, (quotient, remainder) -> {
+            try {
+                stub.divide(10, 2, (q, r) -> {});
+            } catch (RemoteException e) {
+                throw new RuntimeException(e);
+            }
+            inner[0] = stub.mHolders.get(stub.mHolders.size() - 1);
+        });
+        ExpectTrue(inner[0] != stub.mHolders.get(stub.mHolders.size() - 2));
+    }
+
+    static final class Echo extends IEchoReuse.Stub {
+        @Override
+        public int echo(int value) {
+            return value;
+        }
+
+        @Override
+        public void post(int value) {}
+    }
+
+    private void runClientParcelReuseTests() throws RemoteException {
+        IEcho proxy = new IEchoReuse.Proxy(new Echo());
+
+        // Each call on this thread reads its own reply, not the one before it,
+        // whether a oneway call came in between or not.
+        for (int i = 0; i < 3; i++) {
+            ExpectTrue(proxy.echo(100 + i) == 100 + i);
+            ExpectTrue(proxy.echo(200 + i) == 200 + i);
+            proxy.post(i);
+            proxy.post(-i);
+            ExpectTrue(proxy.echo(300 + i) == 300 + i);
+        }
+    }
+
+    // Implements only the ArrayList methods, so calls through the stub go
+    // through the default <method>Arrays overloads.
+    static final class Samples extends ISamples.Stub {
+        final ArrayList<Byte> mRecorded = new ArrayList<Byte>();
+
+        @Override
+        public ArrayList<Float> scale(ArrayList<Float> samples, float factor) {
+            ArrayList<Float> scaled = new ArrayList<Float>(samples.size());
+            for (float sample : samples) {
+                scaled.add(sample * factor);
+            }
+            return scaled;
+        }
+
+        @Override
+        public void summarize(ArrayList<Integer> values, summarizeCallback cb) {
+            ArrayList<Integer> sorted = new ArrayList<Integer>(values);
+            sorted.sort(null);
+            long sum = 0;
+            for (int value : values) {
+                sum += value;
+            }
+            cb.onValues(sum, sorted);
+        }
+
+        @Override
+        public void record(ArrayList<Byte> data) {
+            mRecorded.addAll(data);
+        }
+
+        @Override
+        public Frame echoFrame(Frame frame) {
+            return frame;
+        }
+
+        @Override
+        public ArrayList<Point> track(int count) {
+            ArrayList<Point> points = new ArrayList<Point>(count);
+            for (int i = 0; i < count; i++) {
+                Point point = new Point();
+                point.timestamp = 1_000_000_000L * i - 1;
+                point.x = i * 0.5f;
+                point.y = -i;
+                point.valid = (i % 3 == 0);
+                point.channels = (byte) (Channel.LEFT | ((i % 2 == 0) ? 0 : Channel.RIGHT));
+                points.add(point);
+            }
+            return points;
+        }
+    }
+
+    private void runClientArraysTests() throws RemoteException {
+        Samples stub = new Samples();
+        ISamples proxy = new ISamples.Proxy(stub);
+
+        for (int size : new int[] {0, 1, 1024}) {
+            float[] array = new float[size];
+            ArrayList<Float> list = new ArrayList<Float>(size);
+            for (int i = 0; i < size; i++) {
+                array[i] = i - 0.5f;
+                list.add(i - 0.5f);
+            }
+
+            float[] scaled = proxy.scaleArrays(array, 2.0f);
+            ArrayList<Float> scaledList = proxy.scale(list, 2.0f);
+            ExpectTrue(scaled.length == size);
+            ExpectTrue(scaledList.size() == size);
+            for (int i = 0; i < size; i++) {
+                ExpectTrue(scaled[i] == 2.0f * (i - 0.5f));
+                ExpectTrue(scaledList.get(i) == scaled[i]);
+            }
+        }
+
+        final boolean[] called = new boolean[] {false};
+        proxy.summarizeArrays(new int[] {3, -1, 2}, (sum, sorted) -> {
+            ExpectTrue(sum == 4);
+            ExpectTrue(Arrays.equals(sorted, new int[] {-1, 2, 3}));
+            called[0] = true;
+        });
+        ExpectTrue(called[0]);
+
+        called[0] = false;
+        proxy.summarize(new ArrayList<Integer>(Arrays.asList(3, -1, 2)), (sum, sorted) -> {
+            ExpectTrue(sum == 4);
+            ExpectTrue(sorted.equals(Arrays.asList(-1, 2, 3)));
+            called[0] = true;
+        });
+        ExpectTrue(called[0]);
+
+        proxy.recordArrays(new byte[] {1, 2, (byte) 0xff});
+        proxy.record(new ArrayList<Byte>(Arrays.asList((byte) 4)));
+        ExpectTrue(stub.mRecorded.equals(Arrays.asList((byte) 1, (byte) 2, (byte) 0xff, (byte) 4)));
+    }
+
+    private static Frame makeFrame(int size) {
+        Frame frame = new Frame();
+        for (int i = 0; i < size; i++) {
+            frame.samples.add(i * 0.25f);
+            frame.channels.add((i % 2 == 0) ? Channel.LEFT : Channel.RIGHT);
+            frame.masks.add((byte) (Channel.LEFT | Channel.CENTER));
+            frame.timestamps.add(1_000_000_000L * i - 1);
+        }
+        return frame;
+    }
+
+    private void runClientStructVectorTests() throws RemoteException {
+        ISamples proxy = new ISamples.Proxy(new Samples());
+
+        // Vectors embedded in a struct are written and read with one call
+        // each, for every scalar type, including an empty and a single
+        // element vector.
+        for (int size : new int[] {0, 1, 1024}) {
+            Frame frame = makeFrame(size);
+            Frame echoed = proxy.echoFrame(frame);
+            ExpectTrue(frame.equals(echoed));
+            ExpectTrue(echoed.samples.size() == size);
+            ExpectTrue(echoed.timestamps.size() == size);
+            if (size > 0) {
+                ExpectTrue(echoed.samples.get(size - 1) == (size - 1) * 0.25f);
+                ExpectTrue(echoed.channels.get(size - 1)
+                        == ((size % 2 == 0) ? Channel.RIGHT : Channel.LEFT));
+                ExpectTrue(echoed.masks.get(0) == (byte) (Channel.LEFT | Channel.CENTER));
+                ExpectTrue(echoed.timestamps.get(0) == -1L);
+            }
+        }
+
+        // Vectors of different sizes in the same struct.
+        Frame frame = makeFrame(3);
+        frame.samples.clear();
+        frame.timestamps.add(42L);
+        ExpectTrue(frame.equals(proxy.echoFrame(frame)));
+    }
+
+    private void ExpectViewEquals(Point.View view, ArrayList<Point> points) {
+        ExpectTrue(view.size() == points.size());
+        ExpectTrue(view.toList().equals(points));
+        for (int i = 0; i < points.size(); i++) {
+            Point point = points.get(i);
+            ExpectTrue(view.getTimestamp(i) == point.timestamp);
+            ExpectTrue(view.getX(i) == point.x);
+            ExpectTrue(view.getY(i) == point.y);
+            ExpectTrue(view.getValid(i) == point.valid);
+            ExpectTrue(view.getChannels(i) == point.channels);
+            ExpectTrue(view.get(i).equals(point));
+        }
+    }
+
+    private void runClientJavaViewTests() throws RemoteException {
+        ISamples proxy = new ISamples.Proxy(new Samples());
+
+        for (int count : new int[] {0, 1, 1024}) {
+            ExpectViewEquals(proxy.trackArrays(count), proxy.track(count));
+        }
+
+        // The proxy releases the reply before trackArrays returns, so the
+        // views must not read the reply parcels. Read them only after more
+        // calls have allocated and released other replies.
+        Point.View first = proxy.trackArrays(1024);
+        Point.View second = proxy.trackArrays(7);
+        for (int i = 0; i < 16; i++) {
+            proxy.trackArrays(512);
+            proxy.track(512);
+        }
+        System.gc();
+        System.runFinalization();
+        ExpectViewEquals(first, new Samples().track(1024));
+        ExpectViewEquals(second, new Samples().track(7));
+
+        boolean threw = false;
+        try {
+            first.getTimestamp(1024);
+        } catch (IndexOutOfBoundsException e) {
+            threw = true;
+        }
+        ExpectTrue(threw);
+    }
+
+    private void runClientAsyncTests() throws RemoteException {
+        ExecutorService executor = Executors.newSingleThreadExecutor();
+        try {
+            Async stub = new Async();
+
+            // Async variants are default methods, so they work on the stub
+            // itself as well as on a proxy in front of it.
+            for (IAsync async : new IAsync[] {stub, new IAsync.Proxy(stub)}) {
+                ExpectTrue(async.addAsync(2, 3, executor).get() == 5);
+
+                IAsync.divideResults results = async.divideAsync(7, 2, executor).get();
+                ExpectTrue(results.quotient == 3);
+                ExpectTrue(results.remainder == 1);
+
+                async.resetAsync(executor).get();
+            }
+            ExpectTrue(stub.mResets == 2);
+
+            CompletableFuture<IAsync.divideResults> failed = stub.divideAsync(1, 0, executor);
+            try {
+                failed.get();
+                ExpectTrue(false);
+            } catch (ExecutionException e) {
+                ExpectTrue(e.getCause() instanceof RemoteException);
+            }
+
+            IAsync.OnewaySender sender = new IAsync.OnewaySender(stub, executor);
+            for (int i = 0; i < 100; i++) {
+                sender.post(i);
+            }
+            sender.flush().get();
+            synchronized (stub) {
+                ExpectTrue(stub.mPosted.size() == 100);
+                for (int i = 0; i < 100; i++) {
+                    ExpectTrue(stub.mPosted.get(i) == i);
+                }
+            }
+
+            // Interfaces without @javaAsync get none of the async API.
+            for (java.lang.reflect.Method method : IEcho.class.getMethods()) {
+                ExpectFalse(method.getName().endsWith("Async"));
+            }
+            for (Class<?> nested : IEcho.class.getClasses()) {
+                ExpectFalse(nested.getSimpleName().equals("OnewaySender"));
+            }
+        } catch (InterruptedException | ExecutionException e) {
+            throw new RuntimeException(e);
+        } finally {
+            executor.shutdown();
+        }
+    }
+
     private void runClientSafeUnionTests() throws RemoteException, IOException {
         ISafeUnion safeunionInterface = ISafeUnion.getService();
 
@@ -1207,6 +1640,14 @@ public final class HidlTestJava {
 
         runClientSafeUnionTests();
         runClientMemoryTests();
+        runClientAsyncTests();
+        runClientParcelReuseTests();
+        runClientArraysTests();
+        runClientStructVectorTests();
+        runClientJavaViewTests();
+        runClientResultsStubTests();
+        runClientStructMethodTests();
+        runClientEnumLookupTests();
 
         // --- DEATH RECIPIENT TESTING ---
         // This must always be done last, since it will kill the native server process
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.commands.hidl_test_java;
+
+import android.os.Debug;
+import android.os.RemoteException;
+
+import hidl.tests.java_parcels.V1_0.IEcho;
+import hidl.tests.java_parcels.V1_0.IEchoReuse;
+
+/**
+ * Compares calls per second and garbage collections of a Java proxy that
+ * allocates its reply parcels with one that reuses them for oneway calls
+ * (@javaReuseParcels).
+ *
+ * The proxies wrap a stub in this process, so calls go through the generated
+ * code and the native parcels but not through the kernel. Run with:
+ *
+ *   app_process /data/framework com.android.commands.hidl_test_java.ParcelReuseBenchmark
+ */
+public final class ParcelReuseBenchmark {
+    private static final int WARMUP_CALLS = 10_000;
+    private static final int CALLS = 200_000;
+
+    private static final class Echo extends IEchoReuse.Stub {
+        @Override
+        public int echo(int value) {
+            return value;
+        }
+
+        @Override
+        public void post(int value) {}
+    }
+
+    public static void main(String[] args) throws RemoteException {
+        Echo echo = new Echo();
+        IEcho allocating = new IEcho.Proxy(echo);
+        IEcho reusing = new IEchoReuse.Proxy(echo);
+
+        for (int round = 0; round < 3; round++) {
+            measure("new replies", allocating);
+            measure("reused replies", reusing);
+        }
+    }
+
+    private static void measure(String mode, IEcho proxy) throws RemoteException {
+        for (int i = 0; i < WARMUP_CALLS; i++) {
+            proxy.echo(i);
+        }
+
+        final long gcsBefore = gcCount();
+        final long start = System.nanoTime();
+        for (int i = 0; i < CALLS; i++) {
+            if (proxy.echo(i) != i) {
+                throw new IllegalStateException("echo(" + i + ") returned another value");
+            }
+            proxy.post(i);
+        }
+        final long elapsedNs = System.nanoTime() - start;
+        final long gcs = gcCount() - gcsBefore;
+
+        System.out.printf("%-16s %10.0f calls/s %6d GCs%n", mode,
+                2.0 * CALLS * 1e9 / elapsedNs, gcs);
+    }
+
+    private static long gcCount() {
+        return Long.parseLong(Debug.getRuntimeStat("art.gc.gc-count"));
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <hidl-loopback/Loopback.h>
+
+namespace android {
+namespace hardware {
+
+// Sums the Parcel data and the length of every buffer object it holds, which
+// is what the driver copies into the receiving process.
+static size_t transferSize(const Parcel& parcel) {
+    size_t size = parcel.ipcDataSize();
+    // ipcData() and ipcObjects() return the addresses as uintptr_t.
+    const auto* objects = reinterpret_cast<const binder_size_t*>(parcel.ipcObjects());
+    for (size_t i = 0; i < parcel.ipcObjectsCount(); i++) {
+        const auto* header =
+                reinterpret_cast<const binder_object_header*>(parcel.ipcData() + objects[i]);
+        if (header->type == BINDER_TYPE_PTR) {
+            size += reinterpret_cast<const binder_buffer_object*>(header)->length;
+        }
+    }
+    return size;
+}
+
+LoopbackBinder::LoopbackBinder(const sp<BHwBinder>& stub) : mStub(stub) {}
+
+void LoopbackBinder::resetCounters() {
+    mTransactions = 0;
+    mBytesSent = 0;
+    mBytesReceived = 0;
+}
+
+status_t LoopbackBinder::onTransact(uint32_t code, const Parcel& data, Parcel* reply,
+                                    uint32_t flags, TransactCallback callback) {
+    mTransactions++;
+    mBytesSent += transferSize(data);
+
+    // The stub's transact rewinds the data and hands back the reply rewound,
+    // just as the driver would.
+    return mStub->transact(code, data, reply, flags, [&](Parcel& replyParcel) {
+        mBytesReceived += transferSize(replyParcel);
+        if (callback != nullptr) {
+            callback(replyParcel);
+        }
+    });
+}
+
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <hwbinder/Binder.h>
+#include <hwbinder/Parcel.h>
+#include <utils/StrongPointer.h>
+
+#include <atomic>
+
+namespace android {
+namespace hardware {
+
+/**
+ * Stands in for the remote end of a generated proxy inside one process.
+ * Transactions are handed to a local stub's onTransact using the Parcels the
+ * proxy wrote, so the whole generated marshalling path runs without hwbinder.
+ *
+ * The driver is not involved: buffers are read in place rather than copied,
+ * and interfaces passed as arguments resolve to their local implementations.
+ */
+class LoopbackBinder : public BHwBinder {
+  public:
+    explicit LoopbackBinder(const sp<BHwBinder>& stub);
+
+    /** Number of transactions handed to the stub. */
+    size_t transactions() const { return mTransactions; }
+
+    /**
+     * Bytes the kernel would have copied: the Parcel data plus every buffer
+     * it references.
+     */
+    size_t bytesSent() const { return mBytesSent; }
+    size_t bytesReceived() const { return mBytesReceived; }
+
+    void resetCounters();
+
+  protected:
+    status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags,
+                        TransactCallback callback) override;
+
+  private:
+    const sp<BHwBinder> mStub;
+
+    std::atomic<size_t> mTransactions{0};
+    std::atomic<size_t> mBytesSent{0};
+    std::atomic<size_t> mBytesReceived{0};
+};
+
+/**
+ * Returns a proxy for impl whose transactions go through a LoopbackBinder to a
+ * new stub, for instance makeLoopback<BpHwFoo, BnHwFoo>(new Foo()). If binder
+ * is not null, it is set to the LoopbackBinder so its counters can be read.
+ */
+template <typename Proxy, typename Stub>
+sp<typename Stub::Pure> makeLoopback(const sp<typename Stub::Pure>& impl,
+                                     sp<LoopbackBinder>* binder = nullptr) {
+    sp<LoopbackBinder> loopback = new LoopbackBinder(new Stub(impl));
+    if (binder != nullptr) {
+        *binder = loopback;
+    }
+    return new Proxy(loopback);
+}
+
+}  // namespace hardware
+}  // namespace android
@@ -20,10 +20,22 @@ function run() {
         libhidl-gen-host-utils_test \
         hidl-gen-host_test \
         hidl-lint_test \
+        hidl_shm_test \
+        hidl_loopback_host_test \
+        hidl_passthrough_oneway_host_test \
+        hidl_move_host_test \
+        hidl_passthrough_wrapper_host_test \
+        hidl_flatten_host_test \
+        hidl_coroutine_host_test \
+    )
+
+    # Run only long enough to check that every benchmark completes.
+    local RUN_TIME_BENCHMARKS=(\
+        hidl_cpp_benchmark_test \
     )
 
     $ANDROID_BUILD_TOP/build/soong/soong_ui.bash --make-mode -j \
-        ${COMPILE_TIME_TESTS[*]} ${RUN_TIME_TESTS[*]} || return
+        ${COMPILE_TIME_TESTS[*]} ${RUN_TIME_TESTS[*]} ${RUN_TIME_BENCHMARKS[*]} || return
 
     local BITNESS=("nativetest" "nativetest64")
 
@@ -35,6 +47,16 @@ function run() {
         done
     done
 
+    local BENCHMARK_BITNESS=("benchmarktest" "benchmarktest64")
+
+    for bits in ${BENCHMARK_BITNESS[@]}; do
+        for test in ${RUN_TIME_BENCHMARKS[@]}; do
+            echo $bits $test
+            $ANDROID_BUILD_TOP/out/host/linux-x86/$bits/$test/$test --benchmark_min_time=0.001 ||
+                FAILED_TESTS+=("$bits:$test")
+        done
+    done
+
     echo
     echo ===== ALL HOST TESTS SUMMARY =====
     echo
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Calls an @shm method through a proxy wrapping the stub directly. memfd is
+// plain Linux, so this runs on host as well as on device. On device, it also
+// calls a service in another process.
+//
+// Without the kernel in between, the stub reads the classic encoding in
+// place: the vector it is handed points at the caller's bytes. A shared
+// vector instead points into the stub's mapping of the region.
+
+#include <gtest/gtest.h>
+#include <hidl/HidlTransportSupport.h>
+#include <hidl/ServiceManagement.h>
+#include <hidl/tests/shm/1.0/BnHwShm.h>
+#include <hidl/tests/shm/1.0/BpHwShm.h>
+#include <hidl/tests/shm/1.0/IShm.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+using ::android::sp;
+using ::android::hardware::configureRpcThreadpool;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::joinRpcThreadpool;
+using ::android::hardware::Return;
+using ::android::hardware::details::waitForHwService;
+using ::hidl::tests::shm::V1_0::BnHwShm;
+using ::hidl::tests::shm::V1_0::BpHwShm;
+using ::hidl::tests::shm::V1_0::IShm;
+
+// Paths in /proc/self/fd of the shared memory regions this process has open.
+static std::vector<std::string> openRegionPaths() {
+    std::vector<std::string> paths;
+    DIR* dir = opendir("/proc/self/fd");
+    if (dir == nullptr) {
+        ADD_FAILURE() << "Cannot list /proc/self/fd";
+        return paths;
+    }
+    while (const dirent* entry = readdir(dir)) {
+        const std::string path = std::string("/proc/self/fd/") + entry->d_name;
+        char target[PATH_MAX];
+        const ssize_t length = readlink(path.c_str(), target, sizeof(target) - 1);
+        if (length < 0) continue;
+        target[length] = '\0';
+        if (std::string(target).find("memfd:hidl_shm") != std::string::npos) {
+            paths.push_back(path);
+        }
+    }
+    closedir(dir);
+    return paths;
+}
+
+// Whether every open region refuses to be written, and there is at least one.
+static bool openRegionsAreSealed() {
+    const std::vector<std::string> paths = openRegionPaths();
+    for (const std::string& path : paths) {
+        const int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) return false;
+        const int seals = fcntl(fd, F_GET_SEALS);
+        void* data = mmap(nullptr, 1, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data != MAP_FAILED) {
+            munmap(data, 1);
+            return false;
+        }
+        if (seals < 0 || (seals & F_SEAL_WRITE) == 0) return false;
+    }
+    return !paths.empty();
+}
+
+struct Shm : public IShm {
+    // Reads payload again after replying, once delayAfterReply has passed,
+    // as a service that keeps working on a request after answering it would.
+    Return<void> send(uint32_t /* tag */, const hidl_vec<uint8_t>& payload,
+                      send_cb _hidl_cb) override {
+        mData = payload.data();
+        _hidl_cb(payload.size(), sum(payload));
+
+        std::this_thread::sleep_for(delayAfterReply);
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSumsAfterReply.push_back(sum(payload));
+        mSealedAfterReply = payload.size() > 4096 && openRegionsAreSealed();
+        return Return<void>();
+    }
+
+    Return<void> post(const hidl_vec<uint8_t>& payload) override {
+        mData = payload.data();
+        mSum = sum(payload);
+        return Return<void>();
+    }
+
+    Return<void> getSumsAfterReply(getSumsAfterReply_cb _hidl_cb) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        _hidl_cb(hidl_vec<uint32_t>(mSumsAfterReply));
+        return Return<void>();
+    }
+
+    static uint32_t sum(const hidl_vec<uint8_t>& payload) {
+        return std::accumulate(payload.begin(), payload.end(), 0u);
+    }
+
+    std::chrono::milliseconds delayAfterReply{0};
+
+    const uint8_t* mData = nullptr;
+    uint32_t mSum = 0;
+
+    std::mutex mMutex;
+    std::vector<uint32_t> mSumsAfterReply;
+    bool mSealedAfterReply = false;
+};
+
+static hidl_vec<uint8_t> makePayload(size_t size, uint8_t seed = 0) {
+    hidl_vec<uint8_t> payload(size);
+    for (size_t i = 0; i < size; ++i) {
+        payload[i] = static_cast<uint8_t>(i * 7 + seed);
+    }
+    return payload;
+}
+
+class ShmTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        mImpl = new Shm();
+        mProxy = new BpHwShm(new BnHwShm(mImpl));
+    }
+
+    void expectSend(const hidl_vec<uint8_t>& payload, bool shared) {
+        bool called = false;
+        ASSERT_TRUE(mProxy->send(1, payload, [&](uint32_t size, uint32_t sum) {
+                              called = true;
+                              EXPECT_EQ(payload.size(), size);
+                              EXPECT_EQ(Shm::sum(payload), sum);
+                          }).isOk());
+        EXPECT_TRUE(called);
+        EXPECT_EQ(shared, mImpl->mData != payload.data());
+    }
+
+    sp<Shm> mImpl;
+    sp<IShm> mProxy;
+};
+
+TEST_F(ShmTest, SmallPayloadIsInParcel) {
+    expectSend(makePayload(1000), false /* shared */);
+}
+
+TEST_F(ShmTest, ThresholdIsInclusive) {
+    expectSend(makePayload(4096), false /* shared */);
+}
+
+TEST_F(ShmTest, LargePayloadIsShared) {
+    expectSend(makePayload(4097), true /* shared */);
+    expectSend(makePayload(1 << 20), true /* shared */);
+}
+
+TEST_F(ShmTest, RegionIsSealedWhileServerReads) {
+    const hidl_vec<uint8_t> payload = makePayload(300000);
+    expectSend(payload, true /* shared */);
+    EXPECT_TRUE(mImpl->mSealedAfterReply);
+    EXPECT_EQ(std::vector<uint32_t>{Shm::sum(payload)}, mImpl->mSumsAfterReply);
+}
+
+TEST_F(ShmTest, RegionsAreNotKept) {
+    expectSend(makePayload(300000), true /* shared */);
+    expectSend(makePayload(1 << 20), true /* shared */);
+    EXPECT_TRUE(openRegionPaths().empty());
+}
+
+TEST_F(ShmTest, OnewayPayloadIsShared) {
+    hidl_vec<uint8_t> payload = makePayload(1 << 17);
+    ASSERT_TRUE(mProxy->post(payload).isOk());
+    EXPECT_NE(payload.data(), mImpl->mData);
+    EXPECT_EQ(Shm::sum(payload), mImpl->mSum);
+}
+
+#ifdef __ANDROID__
+// The caller sends a second payload while the service still reads the first
+// one after replying. Each region must keep the bytes it was sent with.
+TEST(ShmRemoteTest, ServerReadsAfterReply) {
+    static constexpr char kInstance[] = "hidl_shm_test";
+
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        configureRpcThreadpool(1, true /* callerWillJoin */);
+        sp<Shm> service = new Shm();
+        service->delayAfterReply = std::chrono::milliseconds(100);
+        if (service->registerAsService(kInstance) != ::android::OK) _exit(EXIT_FAILURE);
+        joinRpcThreadpool();
+        _exit(EXIT_FAILURE);
+    }
+
+    waitForHwService(IShm::descriptor, kInstance);
+    sp<IShm> service = IShm::getService(kInstance);
+    ASSERT_NE(nullptr, service.get());
+    ASSERT_TRUE(service->isRemote());
+
+    std::vector<uint32_t> sums;
+    for (uint8_t seed : {1, 2}) {
+        const hidl_vec<uint8_t> payload = makePayload(300000, seed);
+        sums.push_back(Shm::sum(payload));
+        EXPECT_TRUE(service->send(seed, payload, [&](uint32_t size, uint32_t sum) {
+                               EXPECT_EQ(payload.size(), size);
+                               EXPECT_EQ(sums.back(), sum);
+                           }).isOk());
+    }
+    // Also returns once the service is done with the second payload.
+    EXPECT_TRUE(service->getSumsAfterReply([&](const hidl_vec<uint32_t>& sumsAfterReply) {
+                           EXPECT_EQ(hidl_vec<uint32_t>(sums), sumsAfterReply);
+                       }).isOk());
+
+    service.clear();
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+}
+#endif  // __ANDROID__